@@ -0,0 +1,201 @@
+// 推流性能基准：在子进程中运行回环 RTMP 接收端，本进程用 SessionManager 推送
+// 合成（或指定）的 FLV，统计吞吐、每路 CPU、每 Tag 系统调用数与发送节奏误差
+#include "SessionManager.h"
+#include "RtmpSink.h"
+#include "SyntheticFlv.h"
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace {
+// 基准参数
+struct BenchOptions {
+    int streams; // 推流路数
+    int kbps; // 合成 FLV 的视频码率
+    double seconds; // 合成 FLV 的时长
+    size_t maxChunkSize; // 输出 Chunk 大小上限，0 为默认
+    int threads; // 事件循环线程数，0 为 CPU 核数
+    std::string file; // 指定 FLV 文件，为空时生成合成文件
+    BenchOptions() : streams(100), kbps(2000), seconds(10), maxChunkSize(0), threads(0) {}
+};
+
+void usage(const char* prog) {
+    fprintf(stderr,
+            "usage: %s [-n streams] [-b kbps] [-d seconds] [-c max_chunk_size] [-t threads] [-f file.flv]\n"
+            "  -n  number of concurrent pushes (default 100)\n"
+            "  -b  video bitrate of the synthetic FLV in kbit/s (default 2000)\n"
+            "  -d  duration of the synthetic FLV in seconds (default 10)\n"
+            "  -c  maximum outbound chunk size (default: client default)\n"
+            "  -t  event loop threads (default: CPU count)\n"
+            "  -f  push this FLV instead of a synthetic one\n",
+            prog);
+}
+
+// 子进程：运行接收端直到 ctlFd 关闭，然后把统计写回 resultFd
+class ControlHandler : public IoHandler {
+public:
+    explicit ControlHandler(EventLoop* loop) : loop_(loop) {}
+    void handleIoEvent(uint32_t /*events*/) override { loop_->stop(); }
+
+private:
+    EventLoop* loop_;
+};
+
+void runSink(int listenFd, int ctlFd, int resultFd) {
+    EventLoop loop;
+    RtmpSink sink(&loop);
+    ControlHandler control(&loop);
+    sink.start(listenFd);
+    loop.addFd(ctlFd, &control, EPOLLIN | EPOLLRDHUP);
+    loop.run();
+    SinkStats stats = sink.stats();
+    ssize_t n = write(resultFd, &stats, sizeof(stats));
+    (void)n;
+}
+
+double cpuSeconds(const rusage& ru) {
+    return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+}
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:b:d:c:t:f:h")) != -1) {
+        switch (opt) {
+        case 'n': options.streams = atoi(optarg); break;
+        case 'b': options.kbps = atoi(optarg); break;
+        case 'd': options.seconds = atof(optarg); break;
+        case 'c': options.maxChunkSize = strtoul(optarg, NULL, 10); break;
+        case 't': options.threads = atoi(optarg); break;
+        case 'f': options.file = optarg; break;
+        default: usage(argv[0]); return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (options.streams <= 0 || options.kbps <= 0 || options.seconds <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // 每路推流与接收端各占一个 fd
+    rlimit nofile;
+    if (getrlimit(RLIMIT_NOFILE, &nofile) == 0 && nofile.rlim_cur < nofile.rlim_max) {
+        nofile.rlim_cur = nofile.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &nofile);
+    }
+
+    int listenFd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    socklen_t addrLen = sizeof(addr);
+    if (listenFd < 0 || bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+        listen(listenFd, 4096) < 0 || getsockname(listenFd, reinterpret_cast<sockaddr*>(&addr), &addrLen) < 0) {
+        perror("listen");
+        return 1;
+    }
+    int port = ntohs(addr.sin_port);
+
+    // 接收端放在子进程，CPU 统计只包含推流端；需在创建任何线程和日志实例之前 fork
+    int ctlPipe[2], resultPipe[2];
+    if (pipe(ctlPipe) < 0 || pipe(resultPipe) < 0) {
+        perror("pipe");
+        return 1;
+    }
+    pid_t child = fork();
+    if (child < 0) {
+        perror("fork");
+        return 1;
+    }
+    if (child == 0) {
+        ::close(ctlPipe[1]);
+        ::close(resultPipe[0]);
+        runSink(listenFd, ctlPipe[0], resultPipe[1]);
+        _exit(0);
+    }
+    ::close(listenFd);
+    ::close(ctlPipe[0]);
+    ::close(resultPipe[1]);
+
+    std::string filePath = options.file;
+    bool synthetic = filePath.empty();
+    if (synthetic) {
+        filePath = "/tmp/xrtc_rtmpbench_" + std::to_string(getpid()) + ".flv";
+        if (!writeSyntheticFlv(filePath, options.seconds, options.kbps)) {
+            fprintf(stderr, "failed to write %s\n", filePath.c_str());
+            return 1;
+        }
+    }
+    Vnsp_WriteLog::GetInstance();
+
+    SessionManager manager(options.threads);
+    rusage usageBefore, usageAfter;
+    getrusage(RUSAGE_SELF, &usageBefore);
+    auto wallBefore = std::chrono::steady_clock::now();
+    if (!manager.start()) {
+        fprintf(stderr, "failed to start session manager\n");
+        return 1;
+    }
+    for (int i = 0; i < options.streams; ++i) {
+        PushTask task;
+        task.server = "127.0.0.1";
+        task.port = port;
+        task.app = "live";
+        task.stream = "bench_" + std::to_string(i);
+        task.filePath = filePath;
+        task.maxChunkSize = options.maxChunkSize;
+        manager.addSession(task);
+    }
+    manager.waitAll();
+    int failed = manager.failedSessions();
+    manager.stop();
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallBefore).count();
+    getrusage(RUSAGE_SELF, &usageAfter);
+
+    ::close(ctlPipe[1]);
+    SinkStats sinkStats;
+    if (read(resultPipe[0], &sinkStats, sizeof(sinkStats)) != static_cast<ssize_t>(sizeof(sinkStats))) {
+        fprintf(stderr, "failed to read sink stats\n");
+    }
+    waitpid(child, NULL, 0);
+    if (synthetic) {
+        unlink(filePath.c_str());
+    }
+
+    const RtmpClient::PushStats& stats = manager.totalStats();
+    double cpu = cpuSeconds(usageAfter) - cpuSeconds(usageBefore);
+    double tags = static_cast<double>(stats.tags);
+    printf("streams            %d (%d failed)\n", options.streams, failed);
+    printf("file               %s%s\n", options.file.empty() ? "synthetic " : "", options.file.c_str());
+    if (synthetic) {
+        printf("bitrate            %d kbit/s, %.1f s\n", options.kbps, options.seconds);
+    }
+    if (options.maxChunkSize > 0) {
+        printf("max chunk size     %zu\n", options.maxChunkSize);
+    } else {
+        printf("max chunk size     default\n");
+    }
+    printf("wall time          %.3f s\n", wall);
+    printf("tags               %" PRIu64 " (%.0f tags/s)\n", stats.tags, tags / wall);
+    printf("payload            %" PRIu64 " bytes (%.2f MB/s)\n", stats.payloadBytes, stats.payloadBytes / wall / 1e6);
+    printf("sink received      %" PRIu64 " bytes, %" PRIu64 " media messages, %" PRIu64 " publishes\n",
+           sinkStats.bytes, sinkStats.mediaMessages, sinkStats.publishes);
+    printf("cpu                %.3f s (%.3f%% of one core per stream)\n", cpu, cpu / wall / options.streams * 100);
+    printf("syscalls per tag   %.3f\n", tags > 0 ? stats.syscalls / tags : 0.0);
+    printf("pacing error       avg %.1f us, max %" PRId64 " us\n", tags > 0 ? stats.lateSumUs / tags : 0.0,
+           stats.lateMaxUs);
+    return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,314 @@
+#include "RtmpSink.h"
+#include "ChunkReader.h"
+#include "ChunkWriter.h"
+#include <sys/socket.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+const size_t kHandshakeSize = 1536; // C1/C2 长度
+const uint32_t kWindowAckSize = 2500000; // 声明给推流端的确认窗口
+
+void writeUint32(std::vector<uint8_t>& out, uint32_t v) {
+    out.push_back((v >> 24) & 0xFF);
+    out.push_back((v >> 16) & 0xFF);
+    out.push_back((v >> 8) & 0xFF);
+    out.push_back(v & 0xFF);
+}
+
+void amfString(std::vector<uint8_t>& out, const std::string& s) {
+    out.push_back(0x02);
+    out.push_back((s.size() >> 8) & 0xFF);
+    out.push_back(s.size() & 0xFF);
+    out.insert(out.end(), s.begin(), s.end());
+}
+
+void amfNumber(std::vector<uint8_t>& out, double v) {
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    out.push_back(0x00);
+    for (int i = 7; i >= 0; --i) out.push_back((bits >> (i * 8)) & 0xFF);
+}
+
+void amfKey(std::vector<uint8_t>& out, const std::string& key) {
+    out.push_back((key.size() >> 8) & 0xFF);
+    out.push_back(key.size() & 0xFF);
+    out.insert(out.end(), key.begin(), key.end());
+}
+
+void amfObjectEnd(std::vector<uint8_t>& out) {
+    out.push_back(0x00);
+    out.push_back(0x00);
+    out.push_back(0x09);
+}
+
+// 读取命令名与事务 ID
+bool parseCommand(const std::vector<uint8_t>& p, std::string& name, double& transactionId) {
+    if (p.size() < 3 || p[0] != 0x02) return false;
+    size_t len = (p[1] << 8) | p[2];
+    if (p.size() < 3 + len + 9 || p[3 + len] != 0x00) return false;
+    name.assign(reinterpret_cast<const char*>(&p[3]), len);
+    uint64_t bits = 0;
+    for (int i = 0; i < 8; ++i) bits = (bits << 8) | p[4 + len + i];
+    memcpy(&transactionId, &bits, sizeof(transactionId));
+    return true;
+}
+}
+
+// 单个推流连接
+class SinkConnection : public IoHandler {
+public:
+    SinkConnection(RtmpSink* sink, int fd)
+        : sink_(sink), fd_(fd), handshakeDone_(false), c2Pending_(false), writable_(true),
+          received_(0), lastAcked_(0), resumeTimer_(0) {}
+    ~SinkConnection() {
+        if (resumeTimer_ != 0) {
+            sink_->loop_->cancelTimer(resumeTimer_);
+        }
+        if (fd_ >= 0) {
+            sink_->loop_->removeFd(fd_);
+            ::close(fd_);
+        }
+    }
+    int fd() const { return fd_; }
+
+    void handleIoEvent(uint32_t events) override {
+        if (events & EPOLLOUT) {
+            writable_ = true;
+            if (!flush()) return close();
+        }
+        if (events & (EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP)) {
+            onReadable();
+        }
+    }
+
+private:
+    void close() {
+        sink_->onConnectionClosed(this);
+    }
+
+    bool flush() {
+        if (!writable_ || writer_.empty()) return true;
+        ChunkWriter::FlushResult result = writer_.flush(fd_);
+        if (result == ChunkWriter::FLUSH_BLOCKED) writable_ = false;
+        return result != ChunkWriter::FLUSH_ERROR;
+    }
+
+    void onReadable() {
+        if (resumeTimer_ != 0) return;
+        uint8_t buf[65536];
+        size_t limit = sink_->throttleBytes_ > 0 ? std::min(sink_->throttleBytes_, sizeof(buf)) : sizeof(buf);
+        while (true) {
+            ssize_t n = recv(fd_, buf, limit, 0);
+            if (n > 0) {
+                sink_->stats_.bytes += n;
+                if (!onData(buf, n) || !flush()) return close();
+                if (sink_->throttleBytes_ > 0) {
+                    // 限速：暂停后由定时器继续读，期间数据留在内核缓冲中
+                    resumeTimer_ = sink_->loop_->addTimer(sink_->throttlePauseMs_, [this] {
+                        resumeTimer_ = 0;
+                        onReadable();
+                    });
+                    return;
+                }
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+            return close();
+        }
+    }
+
+    bool onData(const uint8_t* data, size_t size) {
+        if (!handshakeDone_) {
+            handshake_.insert(handshake_.end(), data, data + size);
+            if (!c2Pending_) {
+                if (handshake_.size() < 1 + kHandshakeSize) return true;
+                // S0 + S1 + S2（S2 回显 C1）
+                std::vector<uint8_t> reply(1 + 2 * kHandshakeSize, 0);
+                reply[0] = 0x03;
+                memcpy(&reply[1 + kHandshakeSize], &handshake_[1], kHandshakeSize);
+                writer_.appendRaw(reply.data(), reply.size());
+                handshake_.erase(handshake_.begin(), handshake_.begin() + 1 + kHandshakeSize);
+                c2Pending_ = true;
+            }
+            if (handshake_.size() < kHandshakeSize) return true;
+            handshakeDone_ = true;
+            received_ = handshake_.size() - kHandshakeSize;
+            reader_.feed(handshake_.data() + kHandshakeSize, handshake_.size() - kHandshakeSize);
+            std::vector<uint8_t>().swap(handshake_);
+        } else {
+            received_ += size;
+            reader_.feed(data, size);
+        }
+        while (true) {
+            ChunkReader::ReadResult result = reader_.next(message_);
+            if (result == ChunkReader::READ_NEED_MORE) break;
+            if (result == ChunkReader::READ_ERROR) return false;
+            onMessage(message_);
+            if (sink_->dropAfterMessages_ != 0 && sink_->stats_.mediaMessages >= sink_->dropAfterMessages_) {
+                // 只断开一次，重连后的发布照常接收
+                sink_->dropAfterMessages_ = 0;
+                return false;
+            }
+        }
+        if (received_ - lastAcked_ >= kWindowAckSize) {
+            lastAcked_ = received_;
+            std::vector<uint8_t> ack;
+            writeUint32(ack, static_cast<uint32_t>(received_));
+            writer_.appendMessage(CSID_CONTROL, 0, 0x03, 0, std::move(ack));
+        }
+        return true;
+    }
+
+    void onMessage(const RtmpMessage& msg) {
+        switch (msg.type) {
+        case 0x01:
+            if (msg.payload.size() >= 4) {
+                uint32_t size = (msg.payload[0] << 24) | (msg.payload[1] << 16) | (msg.payload[2] << 8) | msg.payload[3];
+                reader_.setChunkSize(size & 0x7FFFFFFF);
+            }
+            break;
+        case 0x08:
+        case 0x09:
+            ++sink_->stats_.mediaMessages;
+            sink_->stats_.mediaBytes += msg.payload.size();
+            break;
+        case 0x12:
+            ++sink_->stats_.dataMessages;
+            sink_->stats_.dataChecksum = SinkStats::checksum(sink_->stats_.dataChecksum, msg.payload.data(),
+                                                             msg.payload.size());
+            break;
+        case 0x14:
+            onCommand(msg);
+            break;
+        default:
+            break;
+        }
+    }
+
+    void onCommand(const RtmpMessage& msg) {
+        std::string name;
+        double transactionId = 0;
+        if (!parseCommand(msg.payload, name, transactionId)) return;
+        std::vector<uint8_t> body;
+        if (name == "connect") {
+            std::vector<uint8_t> control;
+            writeUint32(control, kWindowAckSize);
+            writer_.appendMessage(CSID_CONTROL, 0, 0x05, 0, std::move(control));
+            writeUint32(control, kWindowAckSize);
+            control.push_back(0x02); // Dynamic
+            writer_.appendMessage(CSID_CONTROL, 0, 0x06, 0, std::move(control));
+
+            amfString(body, "_result");
+            amfNumber(body, transactionId);
+            body.push_back(0x03);
+            amfKey(body, "fmsVer");
+            amfString(body, "FMS/3,0,1,123");
+            amfObjectEnd(body);
+            body.push_back(0x03);
+            amfKey(body, "level");
+            amfString(body, "status");
+            amfKey(body, "code");
+            amfString(body, "NetConnection.Connect.Success");
+            amfObjectEnd(body);
+            writer_.appendMessage(CSID_COMMAND, 0, 0x14, 0, std::move(body));
+        } else if (name == "createStream") {
+            amfString(body, "_result");
+            amfNumber(body, transactionId);
+            body.push_back(0x05);
+            amfNumber(body, 1);
+            writer_.appendMessage(CSID_COMMAND, 0, 0x14, 0, std::move(body));
+        } else if (name == "publish") {
+            ++sink_->stats_.publishes;
+            amfString(body, "onStatus");
+            amfNumber(body, 0);
+            body.push_back(0x05);
+            body.push_back(0x03);
+            amfKey(body, "level");
+            amfString(body, "status");
+            amfKey(body, "code");
+            amfString(body, "NetStream.Publish.Start");
+            amfObjectEnd(body);
+            writer_.appendMessage(CSID_COMMAND, 0, 0x14, msg.streamId, std::move(body));
+        } else if (transactionId > 0) {
+            // releaseStream/FCPublish 等只需空应答
+            amfString(body, "_result");
+            amfNumber(body, transactionId);
+            body.push_back(0x05);
+            body.push_back(0x06);
+            writer_.appendMessage(CSID_COMMAND, 0, 0x14, 0, std::move(body));
+        }
+    }
+
+    RtmpSink* sink_; // 所属接收端
+    int fd_; // 连接套接字
+    bool handshakeDone_; // 握手是否完成
+    bool c2Pending_; // 已回 S0+S1+S2，等待 C2
+    bool writable_; // 套接字是否可写
+    std::vector<uint8_t> handshake_; // 握手数据
+    ChunkReader reader_; // 输入解复用
+    ChunkWriter writer_; // 输出
+    RtmpMessage message_; // 复用的输入消息
+    uint64_t received_; // 握手后接收的字节数
+    uint64_t lastAcked_; // 上次确认时的字节数
+    uint64_t resumeTimer_; // 限速暂停后继续读取的定时器
+};
+
+uint64_t SinkStats::checksum(uint64_t sum, const uint8_t* data, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        sum = (sum ^ data[i]) * 1099511628211ULL;
+    }
+    return sum;
+}
+
+RtmpSink::RtmpSink(EventLoop* loop)
+    : loop_(loop), listenFd_(-1), dropAfterMessages_(0), throttleBytes_(0), throttlePauseMs_(0) {}
+
+RtmpSink::~RtmpSink() {
+    for (std::set<SinkConnection*>::iterator it = connections_.begin(); it != connections_.end(); ++it) {
+        delete *it;
+    }
+    if (listenFd_ >= 0) {
+        loop_->removeFd(listenFd_);
+    }
+}
+
+bool RtmpSink::start(int listenFd) {
+    listenFd_ = listenFd;
+    fcntl(listenFd_, F_SETFL, fcntl(listenFd_, F_GETFL, 0) | O_NONBLOCK);
+    return loop_->addFd(listenFd_, this, EPOLLIN | EPOLLET);
+}
+
+void RtmpSink::handleIoEvent(uint32_t /*events*/) {
+    // 边沿触发：接受到 EAGAIN 为止
+    while (true) {
+        int fd = accept4(listenFd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            return;
+        }
+        if (throttleBytes_ > 0) {
+            int rcvbuf = static_cast<int>(throttleBytes_);
+            setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+        }
+        SinkConnection* conn = new SinkConnection(this, fd);
+        if (!loop_->addFd(fd, conn)) {
+            ::close(fd);
+            continue;
+        }
+        connections_.insert(conn);
+        ++stats_.connections;
+    }
+}
+
+void RtmpSink::onConnectionClosed(SinkConnection* conn) {
+    if (connections_.erase(conn) == 0) return;
+    // 回调仍在连接自身的调用栈上，延后释放
+    loop_->runInLoop([conn] { delete conn; });
+}
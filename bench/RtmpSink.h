@@ -0,0 +1,60 @@
+#ifndef RTMP_SINK_H
+#define RTMP_SINK_H
+
+#include <cstdint>
+#include <cstddef>
+#include <set>
+#include "EventLoop.h"
+
+// 接收端统计
+struct SinkStats {
+    uint64_t connections; // 接受的连接数
+    uint64_t publishes; // 收到的 publish 数
+    uint64_t bytes; // 接收的总字节数
+    uint64_t mediaMessages; // 收到的音视频消息数
+    uint64_t mediaBytes; // 音视频消息体字节数
+    uint64_t dataMessages; // 收到的脚本数据消息数
+    uint64_t dataChecksum; // 脚本数据消息体按到达顺序的 FNV-1a 校验和
+    SinkStats()
+        : connections(0), publishes(0), bytes(0), mediaMessages(0), mediaBytes(0), dataMessages(0),
+          dataChecksum(kChecksumBasis) {}
+    // 校验和初值，以及把一段数据累加进校验和
+    static const uint64_t kChecksumBasis = 14695981039346656037ULL;
+    static uint64_t checksum(uint64_t sum, const uint8_t* data, size_t size);
+};
+
+class SinkConnection;
+
+// 基准测试用的最小 RTMP 接收端：完成握手，应答 connect/createStream/publish，
+// 按窗口回 Acknowledgement，其余消息只计数后丢弃
+class RtmpSink : public IoHandler {
+public:
+    explicit RtmpSink(EventLoop* loop);
+    ~RtmpSink();
+
+    // 在已监听的套接字上接受连接
+    bool start(int listenFd);
+    // 收到第 messages 条音视频消息后断开该连接一次，用于测试推流端的重连；0 表示不断开
+    void setDropAfterMessages(uint64_t messages) { dropAfterMessages_ = messages; }
+    // 模拟慢速接收端：每读 bytesPerRead 字节暂停 pauseMs，并缩小接收缓冲，推流端很快积压；0 表示不限速
+    void setThrottle(size_t bytesPerRead, int pauseMs) {
+        throttleBytes_ = bytesPerRead;
+        throttlePauseMs_ = pauseMs;
+    }
+    const SinkStats& stats() const { return stats_; }
+    void handleIoEvent(uint32_t events) override;
+
+private:
+    friend class SinkConnection;
+    void onConnectionClosed(SinkConnection* conn);
+
+    EventLoop* loop_; // 事件循环
+    int listenFd_; // 监听套接字
+    std::set<SinkConnection*> connections_; // 活动连接
+    SinkStats stats_; // 统计
+    uint64_t dropAfterMessages_; // 断开连接前接收的音视频消息数，0 表示不断开
+    size_t throttleBytes_; // 限速时每次连续读取的字节数，0 表示不限速
+    int throttlePauseMs_; // 限速时每次读取后的暂停
+};
+
+#endif // RTMP_SINK_H
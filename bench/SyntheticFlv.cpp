@@ -0,0 +1,67 @@
+#include "SyntheticFlv.h"
+#include <cstdint>
+#include <cstdio>
+#include <algorithm>
+#include <vector>
+
+namespace {
+void putTag(FILE* fp, uint8_t type, uint32_t timestamp, const std::vector<uint8_t>& body) {
+    uint8_t header[11] = {type,
+                          static_cast<uint8_t>(body.size() >> 16), static_cast<uint8_t>(body.size() >> 8),
+                          static_cast<uint8_t>(body.size()),
+                          static_cast<uint8_t>(timestamp >> 16), static_cast<uint8_t>(timestamp >> 8),
+                          static_cast<uint8_t>(timestamp), static_cast<uint8_t>(timestamp >> 24), 0, 0, 0};
+    uint32_t tagSize = 11 + body.size();
+    uint8_t prev[4] = {static_cast<uint8_t>(tagSize >> 24), static_cast<uint8_t>(tagSize >> 16),
+                       static_cast<uint8_t>(tagSize >> 8), static_cast<uint8_t>(tagSize)};
+    fwrite(header, 1, sizeof(header), fp);
+    fwrite(body.data(), 1, body.size(), fp);
+    fwrite(prev, 1, sizeof(prev), fp);
+}
+}
+
+bool writeSyntheticFlv(const std::string& path, double seconds, int kbps) {
+    FILE* fp = fopen(path.c_str(), "wb");
+    if (fp == NULL) return false;
+    static const uint8_t kFlvHeader[13] = {'F', 'L', 'V', 0x01, 0x05, 0, 0, 0, 0x09, 0, 0, 0, 0};
+    fwrite(kFlvHeader, 1, sizeof(kFlvHeader), fp);
+
+    static const uint8_t kAvcSequenceHeader[] = {0x17, 0x00, 0, 0, 0, 0x01, 0x64, 0x00, 0x1F, 0xFF, 0xE1, 0x00, 0x07,
+                                                 0x67, 0x64, 0x00, 0x1F, 0xAC, 0xD9, 0x40, 0x01, 0x00, 0x04,
+                                                 0x68, 0xEB, 0xE3, 0xCB};
+    static const uint8_t kAacSequenceHeader[] = {0xAF, 0x00, 0x12, 0x10};
+    putTag(fp, 9, 0, std::vector<uint8_t>(kAvcSequenceHeader, kAvcSequenceHeader + sizeof(kAvcSequenceHeader)));
+    putTag(fp, 8, 0, std::vector<uint8_t>(kAacSequenceHeader, kAacSequenceHeader + sizeof(kAacSequenceHeader)));
+
+    int videoFrames = static_cast<int>(seconds * 25);
+    int audioFrames = static_cast<int>(seconds * 44100 / 1024);
+    size_t frameBytes = static_cast<size_t>(kbps) * 1000 / 8 / 25;
+    std::vector<uint8_t> body;
+    int v = 0, a = 0;
+    while (v < videoFrames || a < audioFrames) {
+        uint32_t vts = v * 40;
+        uint32_t ats = static_cast<uint32_t>(static_cast<uint64_t>(a) * 1024 * 1000 / 44100);
+        if (v < videoFrames && (a >= audioFrames || vts <= ats)) {
+            bool key = v % 50 == 0;
+            size_t nalSize = key ? frameBytes * 8 : std::max<size_t>(200, frameBytes * 42 / 49);
+            body.assign(9 + nalSize, static_cast<uint8_t>(v));
+            body[0] = key ? 0x17 : 0x27;
+            body[1] = 0x01;
+            body[2] = body[3] = body[4] = 0;
+            body[5] = nalSize >> 24;
+            body[6] = nalSize >> 16;
+            body[7] = nalSize >> 8;
+            body[8] = nalSize;
+            putTag(fp, 9, vts, body);
+            ++v;
+        } else {
+            body.assign(302, static_cast<uint8_t>(a));
+            body[0] = 0xAF;
+            body[1] = 0x01;
+            putTag(fp, 8, ats, body);
+            ++a;
+        }
+    }
+    fclose(fp);
+    return true;
+}
@@ -0,0 +1,10 @@
+#ifndef SYNTHETIC_FLV_H
+#define SYNTHETIC_FLV_H
+
+#include <string>
+
+// 生成合成 FLV：25fps H.264（每 2 秒一个 8 倍大小的关键帧）与 AAC 44.1kHz 音频，
+// 供基准程序与回环测试推送
+bool writeSyntheticFlv(const std::string& path, double seconds, int kbps);
+
+#endif // SYNTHETIC_FLV_H
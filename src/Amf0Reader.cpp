@@ -0,0 +1,192 @@
+#include "Amf0Reader.h"
+
+namespace {
+const int kMaxDepth = 64; // 嵌套深度上限，防止恶意数据耗尽栈
+}
+
+bool Amf0Reader::parse(const uint8_t* data, size_t size, Amf0Visitor& visitor) {
+    Amf0Reader reader(data, size, visitor);
+    while (reader.pos_ < reader.size_) {
+        if (!reader.parseValue(0, Amf0String())) return false;
+    }
+    return true;
+}
+
+bool Amf0Reader::readUint16(uint16_t& value) {
+    if (size_ - pos_ < 2) return false;
+    value = (data_[pos_] << 8) | data_[pos_ + 1];
+    pos_ += 2;
+    return true;
+}
+
+bool Amf0Reader::readUint32(uint32_t& value) {
+    if (size_ - pos_ < 4) return false;
+    value = (static_cast<uint32_t>(data_[pos_]) << 24) | (data_[pos_ + 1] << 16) | (data_[pos_ + 2] << 8) | data_[pos_ + 3];
+    pos_ += 4;
+    return true;
+}
+
+bool Amf0Reader::readDouble(double& value) {
+    if (size_ - pos_ < 8) return false;
+    // 大端 IEEE-754 双精度
+    uint64_t bits = 0;
+    for (int i = 0; i < 8; ++i) {
+        bits = (bits << 8) | data_[pos_ + i];
+    }
+    memcpy(&value, &bits, sizeof(value));
+    pos_ += 8;
+    return true;
+}
+
+bool Amf0Reader::readString(uint32_t length, Amf0String& out) {
+    if (size_ - pos_ < length) return false;
+    out.data = reinterpret_cast<const char*>(data_ + pos_);
+    out.size = length;
+    pos_ += length;
+    return true;
+}
+
+bool Amf0Reader::parseProperties(int depth) {
+    while (true) {
+        uint16_t keyLength;
+        if (!readUint16(keyLength)) return false;
+        if (keyLength == 0) {
+            // 空属性名后跟 Object End 标记结束属性表
+            if (pos_ >= size_ || data_[pos_] != 0x09) return false;
+            ++pos_;
+            return visitor_.onEnd(depth);
+        }
+        Amf0String key;
+        if (!readString(keyLength, key)) return false;
+        if (!parseValue(depth + 1, key)) return false;
+    }
+}
+
+bool Amf0Reader::parseValue(int depth, const Amf0String& key) {
+    if (pos_ >= size_ || depth > kMaxDepth) return false;
+    uint8_t marker = data_[pos_++];
+    Amf0Item item;
+    item.key = key;
+    switch (marker) {
+        case 0x00: // Number
+            item.type = Amf0Item::NUMBER;
+            if (!readDouble(item.number)) return false;
+            return visitor_.onValue(depth, item);
+        case 0x01: // Boolean
+            if (pos_ >= size_) return false;
+            item.type = Amf0Item::BOOLEAN;
+            item.boolean = data_[pos_++] != 0;
+            return visitor_.onValue(depth, item);
+        case 0x02: { // String
+            uint16_t length;
+            item.type = Amf0Item::STRING;
+            if (!readUint16(length) || !readString(length, item.string)) return false;
+            return visitor_.onValue(depth, item);
+        }
+        case 0x0C: // Long String
+        case 0x0F: { // XML Document
+            uint32_t length;
+            item.type = marker == 0x0C ? Amf0Item::STRING : Amf0Item::XML_DOCUMENT;
+            if (!readUint32(length) || !readString(length, item.string)) return false;
+            return visitor_.onValue(depth, item);
+        }
+        case 0x03: // Object
+            item.type = Amf0Item::OBJECT;
+            return visitor_.onValue(depth, item) && parseProperties(depth);
+        case 0x10: { // Typed Object：类名 + 属性表，按 Object 处理
+            uint16_t length;
+            item.type = Amf0Item::OBJECT;
+            if (!readUint16(length) || !readString(length, item.string)) return false;
+            return visitor_.onValue(depth, item) && parseProperties(depth);
+        }
+        case 0x08: { // ECMA Array：计数仅供参考，以 Object End 结束
+            uint32_t count;
+            item.type = Amf0Item::ECMA_ARRAY;
+            if (!readUint32(count)) return false;
+            return visitor_.onValue(depth, item) && parseProperties(depth);
+        }
+        case 0x0A: { // Strict Array
+            uint32_t count;
+            item.type = Amf0Item::STRICT_ARRAY;
+            if (!readUint32(count) || !visitor_.onValue(depth, item)) return false;
+            for (uint32_t i = 0; i < count; ++i) {
+                if (!parseValue(depth + 1, Amf0String())) return false;
+            }
+            return visitor_.onEnd(depth);
+        }
+        case 0x0B: { // Date：毫秒 + 2 字节时区（保留）
+            uint16_t timezone;
+            item.type = Amf0Item::DATE;
+            if (!readDouble(item.number) || !readUint16(timezone)) return false;
+            return visitor_.onValue(depth, item);
+        }
+        case 0x05: // Null
+            item.type = Amf0Item::NULL_TYPE;
+            return visitor_.onValue(depth, item);
+        case 0x06: // Undefined
+        case 0x0D: // Unsupported
+            item.type = Amf0Item::UNDEFINED;
+            return visitor_.onValue(depth, item);
+        case 0x07: { // Reference：不跟踪引用表，按 Undefined 处理
+            uint16_t index;
+            item.type = Amf0Item::UNDEFINED;
+            if (!readUint16(index)) return false;
+            return visitor_.onValue(depth, item);
+        }
+        default:
+            return false;
+    }
+}
+
+bool Amf0Document::parse(const uint8_t* data, size_t size) {
+    nodes_.clear();
+    open_.clear();
+    return Amf0Reader::parse(data, size, *this) && open_.empty();
+}
+
+bool Amf0Document::onValue(int /*depth*/, const Amf0Item& item) {
+    Node node;
+    node.item = item;
+    node.end = static_cast<uint32_t>(nodes_.size() + 1);
+    nodes_.push_back(node);
+    // 容器的 end 在 onEnd 时回填
+    if (item.isContainer()) {
+        open_.push_back(static_cast<uint32_t>(nodes_.size() - 1));
+    }
+    return true;
+}
+
+bool Amf0Document::onEnd(int /*depth*/) {
+    if (open_.empty()) return false;
+    uint32_t index = open_.back();
+    open_.pop_back();
+    nodes_[index].end = static_cast<uint32_t>(nodes_.size());
+    return true;
+}
+
+uint32_t Amf0Document::root(size_t n) const {
+    uint32_t index = 0;
+    while (index < nodes_.size()) {
+        if (n-- == 0) return index;
+        index = nodes_[index].end;
+    }
+    return npos;
+}
+
+uint32_t Amf0Document::firstChild(uint32_t index) const {
+    if (index >= nodes_.size() || !nodes_[index].item.isContainer()) return npos;
+    return index + 1 < nodes_[index].end ? index + 1 : npos;
+}
+
+uint32_t Amf0Document::nextSibling(uint32_t container, uint32_t child) const {
+    if (container >= nodes_.size() || child >= nodes_.size()) return npos;
+    uint32_t next = nodes_[child].end;
+    return next < nodes_[container].end ? next : npos;
+}
+
+uint32_t Amf0Document::find(uint32_t index, const char* key) const {
+    for (uint32_t child = firstChild(index); child != npos; child = nextSibling(index, child)) {
+        if (nodes_[child].item.key.equals(key)) return child;
+    }
+    return npos;
+}
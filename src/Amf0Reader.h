@@ -0,0 +1,96 @@
+#ifndef AMF0_READER_H
+#define AMF0_READER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// 指向输入缓冲的字符串视图，输入缓冲释放后失效
+struct Amf0String {
+    const char* data;
+    uint32_t size;
+    Amf0String() : data(""), size(0) {}
+    bool equals(const char* s) const { return strlen(s) == size && memcmp(data, s, size) == 0; }
+    std::string str() const { return std::string(data, size); }
+};
+
+// 解码出的一个 AMF0 值（容器只有类型，成员随后单独给出）
+struct Amf0Item {
+    enum Type {
+        NUMBER, BOOLEAN, STRING, OBJECT, NULL_TYPE, UNDEFINED, ECMA_ARRAY, STRICT_ARRAY, DATE, XML_DOCUMENT
+    };
+    Type type;
+    Amf0String key; // 在所属 Object/ECMA Array 中的属性名，其他位置为空
+    double number; // NUMBER 与 DATE（毫秒）
+    bool boolean; // BOOLEAN
+    Amf0String string; // STRING / XML_DOCUMENT，Typed Object 为类名
+    Amf0Item() : type(NULL_TYPE), number(0), boolean(false) {}
+    bool isContainer() const { return type == OBJECT || type == ECMA_ARRAY || type == STRICT_ARRAY; }
+};
+
+// SAX 方式的回调：每个值一次 onValue，容器的成员之后再有一次 onEnd；返回 false 中止解析
+class Amf0Visitor {
+public:
+    virtual ~Amf0Visitor() {}
+    // depth 为嵌套深度，顶层值为 0
+    virtual bool onValue(int depth, const Amf0Item& item) = 0;
+    virtual bool onEnd(int /*depth*/) { return true; }
+};
+
+// 零拷贝 AMF0 解码器：字符串只记录指向输入的视图，数字按 IEEE-754 双精度解码
+class Amf0Reader {
+public:
+    // 依次解码 data 中的全部顶层值，逐个回调 visitor
+    static bool parse(const uint8_t* data, size_t size, Amf0Visitor& visitor);
+
+private:
+    Amf0Reader(const uint8_t* data, size_t size, Amf0Visitor& visitor)
+        : data_(data), size_(size), pos_(0), visitor_(visitor) {}
+    bool parseValue(int depth, const Amf0String& key);
+    // 解析属性表直到 0x00 0x00 0x09
+    bool parseProperties(int depth);
+    bool readString(uint32_t length, Amf0String& out);
+    bool readUint16(uint16_t& value);
+    bool readUint32(uint32_t& value);
+    bool readDouble(double& value);
+
+    const uint8_t* data_; // 输入
+    size_t size_; // 输入长度
+    size_t pos_; // 当前位置
+    Amf0Visitor& visitor_; // 回调
+};
+
+// 扁平的 AMF0 文档：所有值按先序存放在复用的节点数组中，容器的子树紧跟其后。
+// 同一个文档对象反复 parse 时节点数组的容量被复用，字符串仍指向输入缓冲
+class Amf0Document : private Amf0Visitor {
+public:
+    struct Node {
+        Amf0Item item; // 值
+        uint32_t end; // 子树之后的第一个节点下标
+    };
+
+    // 解析一条消息，之前的结果被丢弃
+    bool parse(const uint8_t* data, size_t size);
+    size_t size() const { return nodes_.size(); }
+    const Node& node(uint32_t index) const { return nodes_[index]; }
+    // 第 n 个顶层值的下标，不存在返回 npos
+    uint32_t root(size_t n) const;
+    // 容器 index 中名为 key 的成员下标，不存在返回 npos
+    uint32_t find(uint32_t index, const char* key) const;
+    // 容器 index 的第一个成员、成员 child 的下一个兄弟，不存在返回 npos
+    uint32_t firstChild(uint32_t index) const;
+    uint32_t nextSibling(uint32_t container, uint32_t child) const;
+
+    static const uint32_t npos = 0xFFFFFFFF;
+
+private:
+    bool onValue(int depth, const Amf0Item& item) override;
+    bool onEnd(int depth) override;
+
+    std::vector<Node> nodes_; // 先序节点
+    std::vector<uint32_t> open_; // 尚未结束的容器
+};
+
+#endif // AMF0_READER_H
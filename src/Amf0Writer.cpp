@@ -0,0 +1,112 @@
+#include "Amf0Writer.h"
+
+namespace {
+// AMF0 类型标记
+const uint8_t kAmf0Number = 0x00;
+const uint8_t kAmf0Boolean = 0x01;
+const uint8_t kAmf0String = 0x02;
+const uint8_t kAmf0Object = 0x03;
+const uint8_t kAmf0Null = 0x05;
+const uint8_t kAmf0Undefined = 0x06;
+const uint8_t kAmf0EcmaArray = 0x08;
+const uint8_t kAmf0ObjectEnd = 0x09;
+const uint8_t kAmf0StrictArray = 0x0A;
+const uint8_t kAmf0LongString = 0x0C;
+}
+
+void Amf0Writer::putByte(uint8_t value) {
+    if (size_ < capacity_) buffer_[size_] = value;
+    ++size_;
+}
+
+void Amf0Writer::putUint16(uint16_t value) {
+    if (size_ + 2 <= capacity_) {
+        buffer_[size_] = value >> 8;
+        buffer_[size_ + 1] = value & 0xFF;
+    }
+    size_ += 2;
+}
+
+void Amf0Writer::putUint32(uint32_t value) {
+    if (size_ + 4 <= capacity_) {
+        buffer_[size_] = value >> 24;
+        buffer_[size_ + 1] = (value >> 16) & 0xFF;
+        buffer_[size_ + 2] = (value >> 8) & 0xFF;
+        buffer_[size_ + 3] = value & 0xFF;
+    }
+    size_ += 4;
+}
+
+void Amf0Writer::putBytes(const void* data, size_t length) {
+    if (size_ + length <= capacity_) memcpy(buffer_ + size_, data, length);
+    size_ += length;
+}
+
+Amf0Writer& Amf0Writer::number(double value) {
+    // IEEE-754 双精度，大端
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    putByte(kAmf0Number);
+    putUint32(static_cast<uint32_t>(bits >> 32));
+    putUint32(static_cast<uint32_t>(bits));
+    return *this;
+}
+
+Amf0Writer& Amf0Writer::boolean(bool value) {
+    putByte(kAmf0Boolean);
+    putByte(value ? 1 : 0);
+    return *this;
+}
+
+Amf0Writer& Amf0Writer::string(const char* value, size_t length) {
+    if (length > 0xFFFF) {
+        putByte(kAmf0LongString);
+        putUint32(static_cast<uint32_t>(length));
+    } else {
+        putByte(kAmf0String);
+        putUint16(static_cast<uint16_t>(length));
+    }
+    putBytes(value, length);
+    return *this;
+}
+
+Amf0Writer& Amf0Writer::null() {
+    putByte(kAmf0Null);
+    return *this;
+}
+
+Amf0Writer& Amf0Writer::undefined() {
+    putByte(kAmf0Undefined);
+    return *this;
+}
+
+Amf0Writer& Amf0Writer::beginObject() {
+    putByte(kAmf0Object);
+    return *this;
+}
+
+Amf0Writer& Amf0Writer::beginEcmaArray(uint32_t count) {
+    putByte(kAmf0EcmaArray);
+    putUint32(count);
+    return *this;
+}
+
+Amf0Writer& Amf0Writer::beginStrictArray(uint32_t count) {
+    putByte(kAmf0StrictArray);
+    putUint32(count);
+    return *this;
+}
+
+Amf0Writer& Amf0Writer::key(const char* name, size_t length) {
+    // 属性名没有类型标记，长度不能超过 16 位
+    if (length > 0xFFFF) length = 0xFFFF;
+    putUint16(static_cast<uint16_t>(length));
+    putBytes(name, length);
+    return *this;
+}
+
+Amf0Writer& Amf0Writer::endObject() {
+    putUint16(0);
+    putByte(kAmf0ObjectEnd);
+    return *this;
+}
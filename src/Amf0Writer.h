@@ -0,0 +1,57 @@
+#ifndef AMF0_WRITER_H
+#define AMF0_WRITER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+// AMF0 序列化器：直接写入调用方提供的缓冲，不做任何堆分配。
+// 缓冲不足时停止写入但继续累计所需长度，调用方可按 size() 准备更大的缓冲后重新编码
+class Amf0Writer {
+public:
+    Amf0Writer(uint8_t* buffer, size_t capacity) : buffer_(buffer), capacity_(capacity), size_(0) {}
+
+    // 已写入（缓冲不足时为所需）的字节数
+    size_t size() const { return size_; }
+    // 是否全部写入了缓冲
+    bool ok() const { return size_ <= capacity_; }
+    const uint8_t* data() const { return buffer_; }
+
+    Amf0Writer& number(double value);
+    Amf0Writer& boolean(bool value);
+    // 长度超过 0xFFFF 时自动使用 Long String
+    Amf0Writer& string(const char* value, size_t length);
+    Amf0Writer& string(const char* value) { return string(value, strlen(value)); }
+    Amf0Writer& string(const std::string& value) { return string(value.data(), value.size()); }
+    Amf0Writer& null();
+    Amf0Writer& undefined();
+
+    // Object / ECMA Array：begin 之后交替写 key 与值，最后 end
+    Amf0Writer& beginObject();
+    Amf0Writer& beginEcmaArray(uint32_t count);
+    Amf0Writer& key(const char* name, size_t length);
+    Amf0Writer& key(const char* name) { return key(name, strlen(name)); }
+    Amf0Writer& endObject();
+    Amf0Writer& endEcmaArray() { return endObject(); }
+    // Strict Array：begin 之后依次写 count 个值，没有结束标记
+    Amf0Writer& beginStrictArray(uint32_t count);
+
+    // 常用的属性写法
+    Amf0Writer& property(const char* name, double value) { return key(name).number(value); }
+    Amf0Writer& property(const char* name, bool value) { return key(name).boolean(value); }
+    Amf0Writer& property(const char* name, const char* value) { return key(name).string(value); }
+    Amf0Writer& property(const char* name, const std::string& value) { return key(name).string(value); }
+
+private:
+    void putByte(uint8_t value);
+    void putUint16(uint16_t value);
+    void putUint32(uint32_t value);
+    void putBytes(const void* data, size_t length);
+
+    uint8_t* buffer_; // 输出缓冲
+    size_t capacity_; // 缓冲容量
+    size_t size_; // 已写入或所需的字节数
+};
+
+#endif // AMF0_WRITER_H
@@ -0,0 +1,119 @@
+#include "AnnexB.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define ANNEXB_HAVE_SIMD 1
+#endif
+
+namespace {
+typedef const uint8_t* (*ScanFunc)(const uint8_t* begin, const uint8_t* end);
+
+const uint8_t* scanPortable(const uint8_t* p, const uint8_t* end) {
+    // 第三个字节不是 0/1 时可以一次跳过 3 个字节
+    while (end - p >= 3) {
+        if (p[2] > 1) {
+            p += 3;
+        } else if (p[2] == 0) {
+            ++p;
+        } else {
+            if (p[0] == 0 && p[1] == 0) return p;
+            p += 3;
+        }
+    }
+    return end;
+}
+
+#ifdef ANNEXB_HAVE_SIMD
+// 每轮比较 16 个起点：三路错位加载，分别与 0、0、1 比较后相与，掩码最低位即第一个起始码
+__attribute__((target("sse2")))
+const uint8_t* scanSse2(const uint8_t* p, const uint8_t* end) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi8(1);
+    while (end - p >= 18) {
+        __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1));
+        __m128i b2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 2));
+        __m128i hit = _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(b0, zero), _mm_cmpeq_epi8(b1, zero)),
+                                    _mm_cmpeq_epi8(b2, one));
+        int mask = _mm_movemask_epi8(hit);
+        if (mask != 0) return p + __builtin_ctz(mask);
+        p += 16;
+    }
+    return scanPortable(p, end);
+}
+
+__attribute__((target("avx2")))
+const uint8_t* scanAvx2(const uint8_t* p, const uint8_t* end) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi8(1);
+    while (end - p >= 34) {
+        __m256i b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1));
+        __m256i b2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 2));
+        __m256i hit = _mm256_and_si256(_mm256_and_si256(_mm256_cmpeq_epi8(b0, zero), _mm256_cmpeq_epi8(b1, zero)),
+                                       _mm256_cmpeq_epi8(b2, one));
+        unsigned int mask = static_cast<unsigned int>(_mm256_movemask_epi8(hit));
+        if (mask != 0) return p + __builtin_ctz(mask);
+        p += 32;
+    }
+    return scanSse2(p, end);
+}
+
+bool cpuHasAvx2() {
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+    // 还需操作系统保存 YMM 状态
+    if ((ecx & bit_OSXSAVE) == 0 || (ecx & bit_AVX) == 0) return false;
+    unsigned int xcr0Low, xcr0High;
+    __asm__("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+    if ((xcr0Low & 0x6) != 0x6) return false;
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) return false;
+    return (ebx & bit_AVX2) != 0;
+}
+
+bool cpuHasSse2() {
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+    return (edx & bit_SSE2) != 0;
+}
+#endif
+
+ScanFunc selectScan() {
+#ifdef ANNEXB_HAVE_SIMD
+    if (cpuHasAvx2()) return scanAvx2;
+    if (cpuHasSse2()) return scanSse2;
+#endif
+    return scanPortable;
+}
+
+// 进程内只检测一次 CPU 特性
+ScanFunc scanFunc() {
+    static const ScanFunc func = selectScan();
+    return func;
+}
+}
+
+const uint8_t* AnnexB::findStartCode(const uint8_t* begin, const uint8_t* end) {
+    return scanFunc()(begin, end);
+}
+
+bool AnnexB::nextNalu(const uint8_t** pos, const uint8_t* end, Nalu& nalu) {
+    const uint8_t* start = findStartCode(*pos, end);
+    while (start != end) {
+        const uint8_t* data = start + 3;
+        const uint8_t* next = findStartCode(data, end);
+        // 下一个起始码之前的零字节属于 4 字节起始码或 trailing_zero_8bits
+        const uint8_t* last = next;
+        while (last > data && last[-1] == 0) --last;
+        if (last > data) {
+            nalu.data = data;
+            nalu.size = last - data;
+            *pos = next;
+            return true;
+        }
+        start = next;
+    }
+    *pos = end;
+    return false;
+}
@@ -0,0 +1,24 @@
+#ifndef ANNEX_B_H
+#define ANNEX_B_H
+
+#include <cstdint>
+#include <cstddef>
+
+// Annex-B 码流中的一个 NALU，不含起始码与尾随的零字节
+struct Nalu {
+    const uint8_t* data; // NALU 头部起始
+    size_t size; // 长度
+};
+
+// H.264/HEVC Annex-B 码流工具
+class AnnexB {
+public:
+    // 查找 [begin, end) 中第一个 00 00 01，返回其位置，没有时返回 end。
+    // 按 CPU 特性选用 AVX2/SSE2 一次比较 32/16 个位置，其余平台逐字节查找
+    static const uint8_t* findStartCode(const uint8_t* begin, const uint8_t* end);
+    // 从 *pos 起取出下一个 NALU 并把 *pos 移到其后；没有更多 NALU 时返回 false。
+    // NALU 到下一个起始码（或 end）为止，4 字节起始码的前导零与 trailing_zero_8bits 不计入
+    static bool nextNalu(const uint8_t** pos, const uint8_t* end, Nalu& nalu);
+};
+
+#endif // ANNEX_B_H
@@ -0,0 +1,134 @@
+#include "ChunkReader.h"
+#include <algorithm>
+
+namespace {
+const size_t kDefaultChunkSize = 128; // 协议默认 Chunk 大小
+
+uint32_t readUint24(const uint8_t* p) {
+    return (p[0] << 16) | (p[1] << 8) | p[2];
+}
+
+uint32_t readUint32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+}
+
+ChunkReader::ChunkReader() : chunkSize_(kDefaultChunkSize), offset_(0) {}
+
+void ChunkReader::feed(const uint8_t* data, size_t size) {
+    // 已消费部分超过一半时再压缩，避免每次 feed 都搬移数据
+    if (offset_ > 0 && offset_ >= buffer_.size() / 2) {
+        buffer_.erase(buffer_.begin(), buffer_.begin() + offset_);
+        offset_ = 0;
+    }
+    buffer_.insert(buffer_.end(), data, data + size);
+}
+
+ChunkReader::ChunkStreamState& ChunkReader::streamState(uint32_t csid) {
+    if (csid >= streams_.size()) {
+        streams_.resize(csid + 1);
+    }
+    return streams_[csid];
+}
+
+ChunkReader::ReadResult ChunkReader::next(RtmpMessage& msg) {
+    while (true) {
+        const uint8_t* p = buffer_.data() + offset_;
+        size_t avail = buffer_.size() - offset_;
+        if (avail < 1) return READ_NEED_MORE;
+
+        // Basic Header
+        uint8_t fmt = p[0] >> 6;
+        uint32_t csid = p[0] & 0x3F;
+        size_t pos = 1;
+        if (csid == 0) {
+            if (avail < 2) return READ_NEED_MORE;
+            csid = 64 + p[1];
+            pos = 2;
+        } else if (csid == 1) {
+            if (avail < 3) return READ_NEED_MORE;
+            csid = 64 + p[1] + (p[2] << 8);
+            pos = 3;
+        }
+
+        // Message Header，先只读不改状态，整块 chunk 到齐后再提交
+        static const size_t kMessageHeaderSize[4] = {11, 7, 3, 0};
+        if (avail < pos + kMessageHeaderSize[fmt]) return READ_NEED_MORE;
+        ChunkStreamState& cs = streamState(csid);
+        // 压缩头部必须建立在该 chunk stream 已出现过的 Type 0 头部之上
+        if (fmt != 0 && !cs.valid) return READ_ERROR;
+        bool newMessage = cs.payload.empty() || fmt != 3;
+        uint32_t tsField = 0;
+        uint32_t length = cs.length;
+        uint8_t type = cs.type;
+        uint32_t streamId = cs.streamId;
+        if (fmt <= 2) tsField = readUint24(p + pos);
+        if (fmt <= 1) {
+            length = readUint24(p + pos + 3);
+            type = p[pos + 6];
+        }
+        if (fmt == 0) {
+            streamId = p[pos + 7] | (p[pos + 8] << 8) | (p[pos + 9] << 16) | (static_cast<uint32_t>(p[pos + 10]) << 24);
+        }
+        pos += kMessageHeaderSize[fmt];
+
+        // 扩展时间戳：Type 0/1/2 由 0xFFFFFF 标记，Type 3 沿用该 chunk stream 最近的头部
+        bool extended = fmt == 3 ? cs.extended : tsField == 0xFFFFFF;
+        if (extended) {
+            if (avail < pos + 4) return READ_NEED_MORE;
+            uint32_t ext = readUint32(p + pos);
+            pos += 4;
+            if (fmt != 3) tsField = ext;
+        }
+
+        size_t received = newMessage ? 0 : cs.payload.size();
+        size_t part = std::min(chunkSize_, static_cast<size_t>(length) - received);
+        if (avail < pos + part) return READ_NEED_MORE;
+
+        // 整个 chunk 已到齐，提交头部状态
+        if (newMessage) {
+            // 上一条消息未收完就出现新头部时，按对端已丢弃处理
+            cs.payload.clear();
+            if (fmt == 0) {
+                cs.timestamp = tsField;
+                cs.delta = tsField;
+            } else if (fmt == 1 || fmt == 2) {
+                cs.delta = tsField;
+                cs.timestamp += tsField;
+            } else {
+                cs.timestamp += cs.delta;
+            }
+            cs.length = length;
+            cs.type = type;
+            cs.streamId = streamId;
+            cs.extended = extended;
+            cs.valid = true;
+            cs.payload.reserve(length);
+        }
+        cs.payload.insert(cs.payload.end(), p + pos, p + pos + part);
+        offset_ += pos + part;
+
+        if (cs.payload.size() < cs.length) continue;
+
+        msg.csid = csid;
+        msg.timestamp = cs.timestamp;
+        msg.type = cs.type;
+        msg.streamId = cs.streamId;
+        msg.payload.swap(cs.payload);
+        cs.payload.clear();
+        return READ_MESSAGE;
+    }
+}
+
+void ChunkReader::abort(uint32_t csid) {
+    if (csid < streams_.size()) {
+        streams_[csid].payload.clear();
+    }
+}
+
+void ChunkReader::reset() {
+    chunkSize_ = kDefaultChunkSize;
+    buffer_.clear();
+    offset_ = 0;
+    streams_.clear();
+}
@@ -0,0 +1,63 @@
+#ifndef CHUNK_READER_H
+#define CHUNK_READER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// 一条完整的 RTMP 消息
+struct RtmpMessage {
+    uint32_t csid; // Chunk Stream ID
+    uint32_t timestamp; // 绝对时间戳
+    uint8_t type; // Message Type ID
+    uint32_t streamId; // Message Stream ID
+    std::vector<uint8_t> payload; // 消息体
+};
+
+// RTMP 输入解复用器：增量解析 chunk 并按 chunk stream 组装消息。
+// 收到多少喂多少，只有完整的 chunk 才会被消费，不足的部分留待下次 feed
+class ChunkReader {
+public:
+    enum ReadResult {
+        READ_MESSAGE, // 输出了一条完整消息
+        READ_NEED_MORE, // 数据不足，等待更多输入
+        READ_ERROR // 数据格式错误
+    };
+
+    ChunkReader();
+
+    // 追加收到的数据
+    void feed(const uint8_t* data, size_t size);
+    // 尝试解析出下一条完整消息，msg 的 payload 缓冲会被复用
+    ReadResult next(RtmpMessage& msg);
+    // 对端的 Set Chunk Size
+    void setChunkSize(size_t chunkSize) { chunkSize_ = chunkSize; }
+    size_t chunkSize() const { return chunkSize_; }
+    // 对端的 Abort Message：丢弃该 chunk stream 上未组装完的消息
+    void abort(uint32_t csid);
+    // 清空所有状态（断线时调用）
+    void reset();
+
+private:
+    // 单个 chunk stream 的接收状态
+    struct ChunkStreamState {
+        bool valid; // 是否收到过 Type 0 头部
+        uint32_t timestamp; // 当前消息的绝对时间戳
+        uint32_t delta; // 最近一次的时间增量
+        uint32_t length; // 当前消息长度
+        uint8_t type; // 当前消息类型
+        uint32_t streamId; // 当前消息流 ID
+        bool extended; // 最近的头部是否携带扩展时间戳
+        std::vector<uint8_t> payload; // 组装中的消息体
+        ChunkStreamState() : valid(false), timestamp(0), delta(0), length(0), type(0), streamId(0), extended(false) {}
+    };
+
+    ChunkStreamState& streamState(uint32_t csid);
+
+    size_t chunkSize_; // 输入 chunk 大小
+    std::vector<uint8_t> buffer_; // 未消费的输入
+    size_t offset_; // buffer_ 中已消费的字节数
+    std::vector<ChunkStreamState> streams_; // 按 csid 索引的接收状态
+};
+
+#endif // CHUNK_READER_H
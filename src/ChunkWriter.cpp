@@ -0,0 +1,310 @@
+#include "ChunkWriter.h"
+#include <sys/socket.h>
+#include <sys/sendfile.h>
+#include <algorithm>
+#include <climits>
+#include <cerrno>
+#include <cstring>
+
+namespace {
+// 单次 sendmsg 最多携带的 iovec 数
+const size_t kMaxIovPerSend = IOV_MAX;
+// 负载不小于该值才走 sendfile，小消息合并进 sendmsg 更省系统调用
+const size_t kMinSendfileBytes = 16 * 1024;
+// 空闲消息池上限
+const size_t kMaxFreeMessages = 64;
+// 空闲消息保留的负载缓冲上限
+const size_t kMaxRecycledOwnedBytes = 4096;
+
+// 写入 basic header，返回写入的字节数
+size_t writeBasicHeader(uint8_t* p, uint8_t fmt, uint32_t csid) {
+    if (csid < 64) {
+        p[0] = (fmt << 6) | csid;
+        return 1;
+    }
+    if (csid < 320) {
+        p[0] = fmt << 6;
+        p[1] = csid - 64;
+        return 2;
+    }
+    p[0] = (fmt << 6) | 1;
+    p[1] = (csid - 64) & 0xFF;
+    p[2] = ((csid - 64) >> 8) & 0xFF;
+    return 3;
+}
+
+size_t basicHeaderSize(uint32_t csid) {
+    return csid < 64 ? 1 : (csid < 320 ? 2 : 3);
+}
+}
+
+ChunkWriter::ChunkWriter()
+    : chunkSize_(128), iovHead_(0), iovBase_(0), pendingBytes_(0), syscalls_(0) {}
+
+ChunkWriter::PendingMessage& ChunkWriter::allocMessage() {
+    if (freeMessages_.empty()) {
+        messages_.push_back(PendingMessage());
+    } else {
+        messages_.push_back(std::move(freeMessages_.back()));
+        freeMessages_.pop_back();
+    }
+    PendingMessage& msg = messages_.back();
+    msg.headers.clear();
+    msg.owned.clear();
+    msg.iovEnd = 0;
+    return msg;
+}
+
+void ChunkWriter::pushIov(const uint8_t* base, size_t len) {
+    if (len == 0) return;
+    iovec v;
+    v.iov_base = const_cast<uint8_t*>(base);
+    v.iov_len = len;
+    iov_.push_back(v);
+    pendingBytes_ += len;
+}
+
+void ChunkWriter::appendRaw(const uint8_t* data, size_t size) {
+    if (size == 0) return;
+    PendingMessage& msg = allocMessage();
+    msg.owned.assign(data, data + size);
+    pushIov(msg.owned.data(), size);
+    msg.iovEnd = iovBase_ + iov_.size();
+}
+
+void ChunkWriter::appendMessage(uint32_t csid, uint32_t timestamp, uint8_t type, uint32_t streamId,
+                                const uint8_t* payload, size_t size) {
+    PendingMessage& msg = allocMessage();
+    buildChunks(msg, csid, timestamp, type, streamId, payload, size);
+}
+
+void ChunkWriter::appendMessage(uint32_t csid, uint32_t timestamp, uint8_t type, uint32_t streamId,
+                                const uint8_t* payload, size_t size, int fileFd, off_t fileOffset) {
+    PendingMessage& msg = allocMessage();
+    buildChunks(msg, csid, timestamp, type, streamId, payload, size);
+    // 多个 chunk 时负载须与续传头部交错，只能走内存视图
+    if (fileFd < 0 || size < kMinSendfileBytes || size > chunkSize_) return;
+    // 单 chunk 消息的负载是最后一个 iovec
+    FileSegment seg;
+    seg.seq = msg.iovEnd - 1;
+    seg.fd = fileFd;
+    seg.offset = fileOffset;
+    fileSegments_.push_back(seg);
+}
+
+void ChunkWriter::appendMessage(uint32_t csid, uint32_t timestamp, uint8_t type, uint32_t streamId,
+                                std::vector<uint8_t>&& payload) {
+    PendingMessage& msg = allocMessage();
+    msg.owned.swap(payload);
+    buildChunks(msg, csid, timestamp, type, streamId, msg.owned.data(), msg.owned.size());
+}
+
+void ChunkWriter::appendMessageCopy(uint32_t csid, uint32_t timestamp, uint8_t type, uint32_t streamId,
+                                    const uint8_t* head, size_t headSize, const uint8_t* tail, size_t tailSize) {
+    PendingMessage& msg = allocMessage();
+    msg.owned.assign(head, head + headSize);
+    if (tailSize > 0) {
+        msg.owned.insert(msg.owned.end(), tail, tail + tailSize);
+    }
+    buildChunks(msg, csid, timestamp, type, streamId, msg.owned.data(), msg.owned.size());
+}
+
+ChunkWriter::ChunkStreamState& ChunkWriter::streamState(uint32_t csid) {
+    if (csid >= streams_.size()) {
+        streams_.resize(csid + 1);
+    }
+    return streams_[csid];
+}
+
+void ChunkWriter::buildChunks(PendingMessage& msg, uint32_t csid, uint32_t timestamp, uint8_t type, uint32_t streamId,
+                              const uint8_t* payload, size_t size) {
+    ChunkStreamState& cs = streamState(csid);
+
+    // 选择头部格式：流 ID 变化或时间回退只能用 Type 0；长度/类型变化用 Type 1；
+    // 仅时间增量变化用 Type 2；增量与上一条相同用 Type 3（要求上一条显式给出过增量）
+    uint8_t fmt = 0;
+    uint32_t delta = timestamp - cs.timestamp;
+    if (cs.valid && cs.streamId == streamId && timestamp >= cs.timestamp) {
+        if (cs.length != size || cs.type != type) {
+            fmt = 1;
+        } else if (!cs.hasDelta || cs.delta != delta || delta >= 0xFFFFFF) {
+            fmt = 2;
+        } else {
+            fmt = 3;
+        }
+    }
+
+    // Type 0 写绝对时间戳，Type 1/2 写增量，超过 24 位时使用扩展时间戳
+    uint32_t tsField = fmt == 0 ? timestamp : delta;
+    bool extended = fmt != 3 && tsField >= 0xFFFFFF;
+    size_t basicSize = basicHeaderSize(csid);
+    static const size_t kMessageHeaderSize[4] = {11, 7, 3, 0};
+    size_t firstSize = basicSize + kMessageHeaderSize[fmt] + (extended ? 4 : 0);
+    size_t contSize = basicSize + (extended ? 4 : 0);
+    size_t chunks = size == 0 ? 1 : (size + chunkSize_ - 1) / chunkSize_;
+
+    // 先一次性确定头部槽大小，后续 iovec 指针不会失效
+    msg.headers.resize(firstSize + (chunks - 1) * contSize);
+    uint8_t* h = msg.headers.data();
+
+    size_t n = writeBasicHeader(h, fmt, csid);
+    if (fmt <= 2) {
+        uint32_t ts = extended ? 0xFFFFFF : tsField;
+        h[n++] = (ts >> 16) & 0xFF;
+        h[n++] = (ts >> 8) & 0xFF;
+        h[n++] = ts & 0xFF;
+    }
+    if (fmt <= 1) {
+        h[n++] = (size >> 16) & 0xFF;
+        h[n++] = (size >> 8) & 0xFF;
+        h[n++] = size & 0xFF;
+        h[n++] = type; // Message Type ID
+    }
+    if (fmt == 0) {
+        h[n++] = streamId & 0xFF; // Message Stream ID（小端）
+        h[n++] = (streamId >> 8) & 0xFF;
+        h[n++] = (streamId >> 16) & 0xFF;
+        h[n++] = (streamId >> 24) & 0xFF;
+    }
+    if (extended) {
+        h[n++] = (tsField >> 24) & 0xFF;
+        h[n++] = (tsField >> 16) & 0xFF;
+        h[n++] = (tsField >> 8) & 0xFF;
+        h[n++] = tsField & 0xFF;
+    }
+    pushIov(h, n);
+    h += n;
+
+    size_t sent = 0;
+    while (true) {
+        size_t len = std::min(chunkSize_, size - sent);
+        pushIov(payload + sent, len);
+        sent += len;
+        if (sent >= size) break;
+        // Type 3: 续传头部，扩展时间戳需要重复
+        n = writeBasicHeader(h, 3, csid);
+        if (extended) {
+            h[n++] = (tsField >> 24) & 0xFF;
+            h[n++] = (tsField >> 16) & 0xFF;
+            h[n++] = (tsField >> 8) & 0xFF;
+            h[n++] = tsField & 0xFF;
+        }
+        pushIov(h, n);
+        h += n;
+    }
+    msg.iovEnd = iovBase_ + iov_.size();
+
+    cs.valid = true;
+    cs.hasDelta = fmt != 0;
+    cs.delta = fmt == 0 ? 0 : delta;
+    cs.timestamp = timestamp;
+    cs.length = static_cast<uint32_t>(size);
+    cs.type = type;
+    cs.streamId = streamId;
+}
+
+ChunkWriter::FlushResult ChunkWriter::flush(int fd) {
+    while (iovHead_ < iov_.size()) {
+        uint64_t seq = iovBase_ + iovHead_;
+        if (!fileSegments_.empty() && fileSegments_.front().seq == seq) {
+            // 文件负载：内核直接从页缓存发送，不经过用户态缓冲
+            FileSegment& seg = fileSegments_.front();
+            iovec& v = iov_[iovHead_];
+            ssize_t n = sendfile(fd, seg.fd, &seg.offset, v.iov_len);
+            ++syscalls_;
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                releaseWritten();
+                if (errno == EAGAIN || errno == EWOULDBLOCK) return FLUSH_BLOCKED;
+                return FLUSH_ERROR;
+            }
+            if (n == 0) {
+                // 文件被截断
+                releaseWritten();
+                errno = EIO;
+                return FLUSH_ERROR;
+            }
+            pendingBytes_ -= n;
+            v.iov_base = static_cast<uint8_t*>(v.iov_base) + n;
+            v.iov_len -= n;
+            if (v.iov_len == 0) {
+                ++iovHead_;
+                fileSegments_.pop_front();
+            }
+            continue;
+        }
+
+        // sendmsg 只写到下一个文件负载之前，并用 MSG_MORE 让头部与其后的负载合并成段
+        size_t count = std::min(iov_.size() - iovHead_, kMaxIovPerSend);
+        int flags = MSG_NOSIGNAL;
+        if (!fileSegments_.empty() && fileSegments_.front().seq < seq + count) {
+            count = fileSegments_.front().seq - seq;
+            flags |= MSG_MORE;
+        }
+        msghdr mh;
+        memset(&mh, 0, sizeof(mh));
+        mh.msg_iov = &iov_[iovHead_];
+        mh.msg_iovlen = count;
+        ssize_t n = sendmsg(fd, &mh, flags);
+        ++syscalls_;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            releaseWritten();
+            // EINPROGRESS：TCP Fast Open 没有 cookie 时数据未随 SYN 发出，等连接建立后重写
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINPROGRESS) return FLUSH_BLOCKED;
+            return FLUSH_ERROR;
+        }
+        pendingBytes_ -= n;
+        // 跳过已写完的 iovec，部分写出的 iovec 原地前移
+        size_t left = static_cast<size_t>(n);
+        while (left > 0 && left >= iov_[iovHead_].iov_len) {
+            left -= iov_[iovHead_].iov_len;
+            ++iovHead_;
+        }
+        if (left > 0) {
+            iov_[iovHead_].iov_base = static_cast<uint8_t*>(iov_[iovHead_].iov_base) + left;
+            iov_[iovHead_].iov_len -= left;
+        }
+    }
+    releaseWritten();
+    return FLUSH_DONE;
+}
+
+void ChunkWriter::releaseWritten() {
+    uint64_t written = iovBase_ + iovHead_;
+    while (!messages_.empty() && messages_.front().iovEnd <= written) {
+        recycleMessage(messages_.front());
+        messages_.pop_front();
+    }
+    if (iovHead_ == iov_.size()) {
+        iovBase_ += iov_.size();
+        iov_.clear();
+        iovHead_ = 0;
+    } else if (iovHead_ > 4096 && iovHead_ > iov_.size() / 2) {
+        iov_.erase(iov_.begin(), iov_.begin() + iovHead_);
+        iovBase_ += iovHead_;
+        iovHead_ = 0;
+    }
+}
+
+void ChunkWriter::reset() {
+    iovBase_ += iov_.size();
+    iov_.clear();
+    iovHead_ = 0;
+    pendingBytes_ = 0;
+    streams_.clear();
+    fileSegments_.clear();
+    while (!messages_.empty()) {
+        recycleMessage(messages_.front());
+        messages_.pop_front();
+    }
+}
+
+void ChunkWriter::recycleMessage(PendingMessage& msg) {
+    // 只保留少量空闲消息，被接管的大负载直接释放
+    if (freeMessages_.size() >= kMaxFreeMessages) return;
+    if (msg.owned.capacity() > kMaxRecycledOwnedBytes) {
+        std::vector<uint8_t>().swap(msg.owned);
+    }
+    freeMessages_.push_back(std::move(msg));
+}
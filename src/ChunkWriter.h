@@ -0,0 +1,119 @@
+#ifndef CHUNK_WRITER_H
+#define CHUNK_WRITER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <vector>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+// 各类消息使用的 Chunk Stream ID
+enum ChunkStreamId {
+    CSID_CONTROL = 2, // 协议控制消息
+    CSID_COMMAND = 3, // AMF0 命令
+    CSID_AUDIO = 4,   // 音频
+    CSID_DATA = 5,    // 脚本数据（onMetaData 等）
+    CSID_VIDEO = 6    // 视频
+};
+
+// 按 FLV 标签类型选择媒体消息的 chunk stream：音频、视频各用一路，其余走脚本数据
+inline uint32_t mediaCsid(uint8_t type)
+{
+    return type == 0x08 ? CSID_AUDIO : (type == 0x09 ? CSID_VIDEO : CSID_DATA);
+}
+
+// RTMP 输出分片器：把消息拆成 chunk，头部写入小块头部槽，负载只记录指针，
+// 整个发送队列是一张 iovec 表，由 sendmsg 一次写出尽可能多的数据。
+// 每个 chunk stream 记录上一条消息的头部，能省略的字段用 Type 1/2/3 头部压缩掉
+class ChunkWriter {
+public:
+    enum FlushResult {
+        FLUSH_DONE,    // 队列已全部写出
+        FLUSH_BLOCKED, // 套接字缓冲已满（EAGAIN），等待 EPOLLOUT 后继续
+        FLUSH_ERROR    // 发送出错
+    };
+
+    ChunkWriter();
+
+    // 追加一段原始字节（握手等非 chunk 数据），数据会被复制
+    void appendRaw(const uint8_t* data, size_t size);
+    // 追加一条 RTMP 消息，payload 指向的内存需保持有效直到写出
+    void appendMessage(uint32_t csid, uint32_t timestamp, uint8_t type, uint32_t streamId,
+                       const uint8_t* payload, size_t size);
+    // 追加一条来自文件的 RTMP 消息：payload 是 fileFd 中 fileOffset 处数据的内存视图，
+    // 消息能以单个 chunk 发出且足够大时负载经 sendfile 直接从文件写出，否则按内存视图发送
+    void appendMessage(uint32_t csid, uint32_t timestamp, uint8_t type, uint32_t streamId,
+                       const uint8_t* payload, size_t size, int fileFd, off_t fileOffset);
+    // 追加一条 RTMP 消息并接管 payload 的所有权（不复制）
+    void appendMessage(uint32_t csid, uint32_t timestamp, uint8_t type, uint32_t streamId,
+                       std::vector<uint8_t>&& payload);
+    // 追加一条 RTMP 消息，把 head 与 tail 依次复制到队列自有的负载缓冲；
+    // 缓冲随消息回收复用，稳态下不分配内存，适合命令等小消息
+    void appendMessageCopy(uint32_t csid, uint32_t timestamp, uint8_t type, uint32_t streamId,
+                           const uint8_t* head, size_t headSize, const uint8_t* tail = nullptr, size_t tailSize = 0);
+    // 从上次中断处继续写出
+    FlushResult flush(int fd);
+
+    void setChunkSize(size_t chunkSize) { chunkSize_ = chunkSize; }
+    size_t chunkSize() const { return chunkSize_; }
+    // 尚未写出的字节数
+    size_t pendingBytes() const { return pendingBytes_; }
+    bool empty() const { return pendingBytes_ == 0; }
+    // 累计的发送系统调用次数（sendmsg/sendfile），reset 不清零
+    uint64_t syscalls() const { return syscalls_; }
+    // 当前队列尾的位置标记；writtenThrough(mark) 为真时取标记之前追加的数据已全部写出或被丢弃，
+    // 调用方据此判断负载引用的外部内存（如文件映射）何时可以释放
+    uint64_t mark() const { return iovBase_ + iov_.size(); }
+    bool writtenThrough(uint64_t mark) const { return iovBase_ + iovHead_ >= mark; }
+    // 丢弃所有未写出的数据并清空各 chunk stream 的头部状态（断线时调用）
+    void reset();
+
+private:
+    // 单个 chunk stream 上一条消息的头部，用于选择压缩格式
+    struct ChunkStreamState {
+        bool valid; // 是否已发送过 Type 0 头部
+        bool hasDelta; // 上一条消息是否以 Type 1/2 给出了时间增量
+        uint32_t timestamp; // 上一条消息的绝对时间戳
+        uint32_t delta; // 上一条消息的时间增量
+        uint32_t length; // 上一条消息的长度
+        uint8_t type; // 上一条消息的类型
+        uint32_t streamId; // 上一条消息的 Message Stream ID
+        ChunkStreamState() : valid(false), hasDelta(false), timestamp(0), delta(0), length(0), type(0), streamId(0) {}
+    };
+
+    // 一条排队中的消息：头部槽与可选的负载所有权，全部 iovec 写出后回收复用
+    struct PendingMessage {
+        std::vector<uint8_t> headers; // 本消息所有 chunk 头部，iovec 指向其中
+        std::vector<uint8_t> owned; // 被接管的负载
+        uint64_t iovEnd; // 本消息最后一个 iovec 之后的全局序号
+    };
+
+    // 经 sendfile 发送的负载，对应 iov_ 中的一项（iovec 只用于记录剩余长度）
+    struct FileSegment {
+        uint64_t seq; // 对应 iovec 的全局序号
+        int fd; // 文件描述符
+        off_t offset; // 下一个待发送字节的文件偏移
+    };
+
+    PendingMessage& allocMessage();
+    void buildChunks(PendingMessage& msg, uint32_t csid, uint32_t timestamp, uint8_t type, uint32_t streamId,
+                     const uint8_t* payload, size_t size);
+    void pushIov(const uint8_t* base, size_t len);
+    void releaseWritten();
+    void recycleMessage(PendingMessage& msg);
+    ChunkStreamState& streamState(uint32_t csid);
+
+    size_t chunkSize_; // 输出 chunk 大小
+    std::vector<iovec> iov_; // 发送队列
+    size_t iovHead_; // iov_ 中第一个未写完的位置
+    uint64_t iovBase_; // iov_[0] 的全局序号
+    size_t pendingBytes_; // 未写出的字节数
+    uint64_t syscalls_; // 发送系统调用次数
+    std::deque<FileSegment> fileSegments_; // 排队中的文件负载，按序排列
+    std::deque<PendingMessage> messages_; // 排队中的消息，按序排列
+    std::vector<PendingMessage> freeMessages_; // 已写完待复用的消息（保留缓冲容量）
+    std::vector<ChunkStreamState> streams_; // 按 csid 索引的头部状态
+};
+
+#endif // CHUNK_WRITER_H
@@ -0,0 +1,221 @@
+#include "EsSource.h"
+#include "Vnsp_WriteLog.h"
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+const double kDefaultFrameRate = 25.0; // 既没有 VUI 也没有指定帧率时使用
+
+enum EsKind {
+    ES_NONE,
+    ES_H264,
+    ES_HEVC,
+    ES_AAC
+};
+
+// 按后缀识别路径中的一段，视频可带 "@帧率" 后缀；file 与 fps 返回去掉后缀的路径与帧率（未指定为 0）
+EsKind esKindOf(const std::string& part, std::string& file, double& fps) {
+    file = part;
+    fps = 0;
+    size_t at = part.rfind('@');
+    if (at != std::string::npos && part.find('/', at) == std::string::npos) {
+        char* end = nullptr;
+        double value = strtod(part.c_str() + at + 1, &end);
+        if (end != part.c_str() + at + 1 && *end == '\0' && value > 0) {
+            file = part.substr(0, at);
+            fps = value;
+        }
+    }
+    std::string ext = MediaSource::extensionOf(file);
+    if (ext == "h264" || ext == "264" || ext == "avc") return ES_H264;
+    if (ext == "h265" || ext == "265" || ext == "hevc") return ES_HEVC;
+    if ((ext == "aac" || ext == "adts") && fps == 0) return ES_AAC;
+    return ES_NONE;
+}
+
+// 按 '+' 拆分路径，每一段都是可识别的裸流时返回 true
+bool splitEsPath(const std::string& path, std::vector<std::string>& parts) {
+    parts.clear();
+    size_t start = 0;
+    while (true) {
+        size_t plus = path.find('+', start);
+        parts.push_back(path.substr(start, plus == std::string::npos ? std::string::npos : plus - start));
+        if (plus == std::string::npos) break;
+        start = plus + 1;
+    }
+    for (size_t i = 0; i < parts.size(); ++i) {
+        std::string file;
+        double fps;
+        if (esKindOf(parts[i], file, fps) == ES_NONE) return false;
+    }
+    return true;
+}
+}
+
+EsSource::EsSource()
+    : videoPos_(nullptr), audioPos_(nullptr), lookahead_(), haveLookahead_(false),
+      defaultFrameRate_(kDefaultFrameRate), frameCount_(0), sampleCount_(0), videoHeaderPending_(false),
+      videoFramePending_(false), videoTimestamp_(0), videoOffset_(0), audioHeaderPending_(false),
+      audioFramePending_(false), audioTimestamp_(0), audioOffset_(0), failed_(false) {}
+
+bool EsSource::isEsPath(const std::string& path) {
+    std::vector<std::string> parts;
+    return splitEsPath(path, parts);
+}
+
+bool EsSource::open(const std::string& path) {
+    std::vector<std::string> parts;
+    if (!splitEsPath(path, parts) || parts.size() > 2) {
+        VNSP_LOG(LOG_ERROR, "EsSource", "Unsupported elementary stream input: %s", path.c_str());
+        failed_ = true;
+        return false;
+    }
+    for (size_t i = 0; i < parts.size(); ++i) {
+        std::string file;
+        double fps;
+        EsKind kind = esKindOf(parts[i], file, fps);
+        if (kind == ES_AAC) {
+            if (audioFile_.isOpen() || !audioFile_.open(file)) {
+                failed_ = true;
+                return false;
+            }
+            audioPos_ = audioFile_.data();
+        } else {
+            if (video_ || !videoFile_.open(file)) {
+                failed_ = true;
+                return false;
+            }
+            video_.reset(new VideoPacketizer(kind == ES_HEVC ? VideoPacketizer::CODEC_HEVC
+                                                             : VideoPacketizer::CODEC_H264));
+            video_->setEnhanced(enhancedRtmp_);
+            videoPos_ = videoFile_.data();
+            if (fps > 0) defaultFrameRate_ = fps;
+        }
+    }
+    VNSP_LOG(LOG_INFO, "EsSource", "Opened elementary streams: %s", path.c_str());
+    return true;
+}
+
+bool EsSource::isVcl(const Nalu& nalu) const {
+    if (video_->codec() == VideoPacketizer::CODEC_HEVC) return ((nalu.data[0] >> 1) & 0x3F) < 32;
+    int type = nalu.data[0] & 0x1F;
+    return type >= 1 && type <= 5;
+}
+
+bool EsSource::packNextVideo() {
+    accessUnit_.clear();
+    bool haveVcl = false;
+    while (true) {
+        Nalu nalu;
+        bool more;
+        if (haveLookahead_) {
+            nalu = lookahead_;
+            haveLookahead_ = false;
+            more = true;
+        } else {
+            more = AnnexB::nextNalu(&videoPos_, videoFile_.end(), nalu);
+            videoFile_.advise(videoPos_);
+        }
+        if (more && nalu.size == 0) continue;
+        if (more && !video_->startsAccessUnit(nalu, haveVcl)) {
+            accessUnit_.push_back(nalu);
+            haveVcl = haveVcl || isVcl(nalu);
+            continue;
+        }
+        if (more) {
+            lookahead_ = nalu;
+            haveLookahead_ = true;
+        }
+        if (accessUnit_.empty()) return false;
+
+        // 一个访问单元切分完成
+        double fps = video_->frameRate() > 0 ? video_->frameRate() : defaultFrameRate_;
+        videoTimestamp_ = static_cast<uint32_t>(frameCount_ * 1000 / fps);
+        videoOffset_ = accessUnit_[0].data - videoFile_.data();
+        if (haveVcl) ++frameCount_;
+        // 裸流没有显示时间戳，按解码顺序发送，CompositionTime 为 0
+        videoFramePending_ = video_->packetize(accessUnit_.data(), accessUnit_.size(), 0, videoFrame_);
+        videoHeaderPending_ = video_->takeSequenceHeader(videoHeader_);
+        if (videoFramePending_ || videoHeaderPending_) return true;
+        // 参数集之前的帧无法解码，丢弃
+        if (more) {
+            accessUnit_.clear();
+            haveVcl = false;
+            continue;
+        }
+        return false;
+    }
+}
+
+bool EsSource::packNextAudio() {
+    const uint8_t* end = audioFile_.end();
+    while (audioPos_ < end) {
+        size_t remain = end - audioPos_;
+        size_t frameSize = AudioPacketizer::adtsFrameSize(audioPos_, remain);
+        if (frameSize == 0) {
+            // 不是 ADTS 头部，找下一个同步字
+            const uint8_t* p = audioPos_ + 1;
+            while (p < end && (p = static_cast<const uint8_t*>(memchr(p, 0xFF, end - p))) != nullptr) {
+                if (p + 1 < end && (p[1] & 0xF6) == 0xF0) break;
+                ++p;
+            }
+            VNSP_LOG(LOG_WARN, "EsSource", "Lost ADTS sync at offset %llu",
+                     static_cast<unsigned long long>(audioPos_ - audioFile_.data()));
+            audioPos_ = p != nullptr && p < end ? p : end;
+            continue;
+        }
+        if (frameSize > remain) {
+            VNSP_LOG(LOG_WARN, "EsSource", "Truncated ADTS frame at end of file");
+            audioPos_ = end;
+            break;
+        }
+        const uint8_t* adts = audioPos_;
+        audioPos_ += frameSize;
+        audioFile_.advise(audioPos_);
+        if (!audio_.packetize(adts, frameSize, audioFrame_)) continue;
+        audioTimestamp_ = static_cast<uint32_t>(sampleCount_ * 1000 / audio_.sampleRate());
+        audioOffset_ = adts - audioFile_.data();
+        sampleCount_ += audio_.samplesPerFrame();
+        audioHeaderPending_ = audio_.takeSequenceHeader(audioHeader_);
+        audioFramePending_ = true;
+        return true;
+    }
+    return false;
+}
+
+bool EsSource::readTag(FlvTag& tag, std::vector<uint8_t>& payload) {
+    if (failed_) return false;
+    if (video_ && !videoHeaderPending_ && !videoFramePending_) packNextVideo();
+    if (audioFile_.isOpen() && !audioHeaderPending_ && !audioFramePending_) packNextAudio();
+
+    bool videoReady = videoHeaderPending_ || videoFramePending_;
+    bool audioReady = audioHeaderPending_ || audioFramePending_;
+    if (!videoReady && !audioReady) return false;
+    // 时间戳小的先发，相同时先发视频
+    if (videoReady && (!audioReady || videoTimestamp_ <= audioTimestamp_)) {
+        tag.type = 9;
+        tag.timestamp = videoTimestamp_;
+        tag.offset = videoOffset_;
+        if (videoHeaderPending_) {
+            payload.assign(videoHeader_.begin(), videoHeader_.end());
+            videoHeaderPending_ = false;
+        } else {
+            payload.swap(videoFrame_);
+            videoFramePending_ = false;
+        }
+    } else {
+        tag.type = 8;
+        tag.timestamp = audioTimestamp_;
+        tag.offset = audioOffset_;
+        if (audioHeaderPending_) {
+            payload.assign(audioHeader_.begin(), audioHeader_.end());
+            audioHeaderPending_ = false;
+        } else {
+            payload.swap(audioFrame_);
+            audioFramePending_ = false;
+        }
+    }
+    tag.data = payload.data();
+    tag.size = static_cast<uint32_t>(payload.size());
+    return true;
+}
@@ -0,0 +1,60 @@
+#ifndef ES_SOURCE_H
+#define ES_SOURCE_H
+
+#include <memory>
+#include "MediaSource.h"
+#include "MediaPacketizer.h"
+#include "MappedFile.h"
+
+// Annex-B 视频（H.264/HEVC）与 ADTS 音频（AAC）裸流输入。路径写作 "视频文件+音频文件"，
+// 也可只有其中一个，按后缀识别：.h264/.264/.avc、.h265/.265/.hevc、.aac/.adts。
+// 两个文件各自映射，视频按访问单元、音频按 ADTS 帧切分打包，按时间戳交错输出。
+// 裸流没有时间戳：视频按 SPS 中 VUI 的帧率推算（没有时按视频路径后的 "@帧率"，默认 25），
+// 音频按采样率推算。帧按解码顺序给出，CompositionTime 为 0，码流不应含 B 帧
+class EsSource : public MediaSource {
+public:
+    EsSource();
+
+    // 路径是否为裸流输入
+    static bool isEsPath(const std::string& path);
+
+    bool open(const std::string& path) override;
+    bool readTag(FlvTag& tag, std::vector<uint8_t>& payload) override;
+    bool failed() const override { return failed_; }
+
+private:
+    // 切出并打包下一个可发送的视频访问单元（可能只有序列头），没有更多时返回 false
+    bool packNextVideo();
+    // 打包下一个 ADTS 帧，没有更多时返回 false
+    bool packNextAudio();
+    bool isVcl(const Nalu& nalu) const;
+
+    MappedFile videoFile_; // 视频裸流映射
+    MappedFile audioFile_; // 音频裸流映射
+    std::unique_ptr<VideoPacketizer> video_; // 视频打包，没有视频时为空
+    AudioPacketizer audio_; // 音频打包
+    const uint8_t* videoPos_; // 视频读取位置
+    const uint8_t* audioPos_; // 音频读取位置
+    std::vector<Nalu> accessUnit_; // 正在切分的访问单元
+    Nalu lookahead_; // 已读出、属于下一个访问单元的 NALU
+    bool haveLookahead_; // lookahead_ 是否有效
+    double defaultFrameRate_; // VUI 没有帧率时使用的帧率
+    uint64_t frameCount_; // 已切出的视频帧数
+    uint64_t sampleCount_; // 已打包的音频样本数
+    // 已打包、等待输出的视频与音频：序列头在前
+    std::vector<uint8_t> videoHeader_;
+    std::vector<uint8_t> videoFrame_;
+    bool videoHeaderPending_;
+    bool videoFramePending_;
+    uint32_t videoTimestamp_; // 待输出视频的时间戳
+    uint64_t videoOffset_; // 待输出视频在文件中的偏移
+    std::vector<uint8_t> audioHeader_;
+    std::vector<uint8_t> audioFrame_;
+    bool audioHeaderPending_;
+    bool audioFramePending_;
+    uint32_t audioTimestamp_; // 待输出音频的时间戳
+    uint64_t audioOffset_; // 待输出音频在文件中的偏移
+    bool failed_; // 是否出错
+};
+
+#endif // ES_SOURCE_H
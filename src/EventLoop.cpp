@@ -0,0 +1,193 @@
+#include "EventLoop.h"
+#include "Vnsp_WriteLog.h"
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+namespace {
+const int64_t kTimerTickUs = 100; // 时间轮 tick 精度
+
+// 单调时钟（与 steady_clock 同源），微秒
+int64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+}
+
+EventLoop::EventLoop()
+    : epollFd_(-1), wakeupFd_(-1), timerFd_(-1), running_(false), events_(256),
+      timers_(kTimerTickUs, nowUs()), armedDeadline_(-1), syscalls_(0) {
+    epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd_ < 0) {
+        VNSP_LOG(LOG_FATAL, "EventLoop", "epoll_create1 failed: %s", strerror(errno));
+        return;
+    }
+    wakeupFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeupFd_ >= 0) {
+        epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.ptr = nullptr; // data.ptr 为空表示唤醒事件
+        epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeupFd_, &ev);
+    }
+    timerFd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timerFd_ >= 0) {
+        epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.ptr = &timerFd_; // 指向 timerFd_ 表示定时器到期
+        epoll_ctl(epollFd_, EPOLL_CTL_ADD, timerFd_, &ev);
+    } else {
+        VNSP_LOG(LOG_FATAL, "EventLoop", "timerfd_create failed: %s", strerror(errno));
+    }
+}
+
+EventLoop::~EventLoop() {
+    if (timerFd_ >= 0) ::close(timerFd_);
+    if (wakeupFd_ >= 0) ::close(wakeupFd_);
+    if (epollFd_ >= 0) ::close(epollFd_);
+}
+
+bool EventLoop::addFd(int fd, IoHandler* handler, uint32_t events) {
+    epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.ptr = handler;
+    if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        VNSP_LOG(LOG_ERROR, "EventLoop", "epoll_ctl add fd %d failed: %s", fd, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+bool EventLoop::modifyFd(int fd, IoHandler* handler, uint32_t events) {
+    epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.ptr = handler;
+    if (epoll_ctl(epollFd_, EPOLL_CTL_MOD, fd, &ev) < 0) {
+        VNSP_LOG(LOG_ERROR, "EventLoop", "epoll_ctl mod fd %d failed: %s", fd, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+void EventLoop::removeFd(int fd) {
+    epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, nullptr);
+}
+
+int EventLoop::runOnce(int timeoutMs) {
+    // 定时器由 timerfd 唤醒，这里只处理已到期的并重设 timerfd
+    runTimers();
+    {
+        AutoMutex lock(&taskLock_);
+        if (!pendingTasks_.empty()) timeoutMs = 0;
+    }
+    int n = epoll_wait(epollFd_, events_.data(), static_cast<int>(events_.size()), timeoutMs);
+    ++syscalls_;
+    if (n < 0) {
+        if (errno != EINTR) {
+            VNSP_LOG(LOG_ERROR, "EventLoop", "epoll_wait failed: %s", strerror(errno));
+        }
+        n = 0;
+    }
+    for (int i = 0; i < n; ++i) {
+        IoHandler* handler = static_cast<IoHandler*>(events_[i].data.ptr);
+        if (handler == nullptr) {
+            uint64_t value;
+            while (read(wakeupFd_, &value, sizeof(value)) > 0) {
+                ++syscalls_;
+            }
+            ++syscalls_;
+            continue;
+        }
+        if (events_[i].data.ptr == &timerFd_) {
+            // timerfd 为一次性定时，触发后即失效
+            uint64_t value;
+            while (read(timerFd_, &value, sizeof(value)) > 0) {
+                ++syscalls_;
+            }
+            ++syscalls_;
+            armedDeadline_ = -1;
+            continue;
+        }
+        handler->handleIoEvent(events_[i].events);
+    }
+    // 事件缓冲被填满时扩容，避免大量连接时多次 epoll_wait
+    if (n == static_cast<int>(events_.size())) {
+        events_.resize(events_.size() * 2);
+    }
+    runTimers();
+    runPendingTasks();
+    return n;
+}
+
+void EventLoop::runInLoop(const Task& task) {
+    {
+        AutoMutex lock(&taskLock_);
+        pendingTasks_.push_back(task);
+    }
+    wakeup();
+}
+
+void EventLoop::runPendingTasks() {
+    std::vector<Task> tasks;
+    {
+        AutoMutex lock(&taskLock_);
+        tasks.swap(pendingTasks_);
+    }
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        tasks[i]();
+    }
+}
+
+uint64_t EventLoop::addTimer(int delayMs, const Task& task) {
+    return timers_.add(nowUs() + static_cast<int64_t>(delayMs > 0 ? delayMs : 0) * 1000, task);
+}
+
+uint64_t EventLoop::addTimerAt(std::chrono::steady_clock::time_point when, const Task& task) {
+    return timers_.add(std::chrono::duration_cast<std::chrono::microseconds>(when.time_since_epoch()).count(), task);
+}
+
+void EventLoop::cancelTimer(uint64_t timerId) {
+    timers_.cancel(timerId);
+}
+
+void EventLoop::runTimers() {
+    timers_.advance(nowUs());
+    int64_t deadline = timers_.nextDeadline();
+    if (deadline == armedDeadline_ || timerFd_ < 0) return;
+    // 绝对时间设定，it_value 全零表示取消
+    itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    if (deadline >= 0) {
+        spec.it_value.tv_sec = deadline / 1000000;
+        spec.it_value.tv_nsec = (deadline % 1000000) * 1000;
+        if (spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0) spec.it_value.tv_nsec = 1;
+    }
+    timerfd_settime(timerFd_, TFD_TIMER_ABSTIME, &spec, nullptr);
+    ++syscalls_;
+    armedDeadline_ = deadline;
+}
+
+void EventLoop::run() {
+    running_ = true;
+    while (running_) {
+        runOnce(-1);
+    }
+}
+
+void EventLoop::stop() {
+    running_ = false;
+    wakeup();
+}
+
+void EventLoop::wakeup() {
+    if (wakeupFd_ >= 0) {
+        uint64_t one = 1;
+        ssize_t n = write(wakeupFd_, &one, sizeof(one));
+        (void)n;
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <cstdint>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <sys/epoll.h>
+#include "AutoLock.h"
+#include "TimerWheel.h"
+
+// 套接字就绪事件的处理接口，由持有 fd 的对象实现
+class IoHandler {
+public:
+    virtual ~IoHandler() {}
+    // events 为 epoll 返回的事件位（EPOLLIN/EPOLLOUT/EPOLLERR/...）
+    virtual void handleIoEvent(uint32_t events) = 0;
+};
+
+// 基于边沿触发 epoll 的事件循环，附带定时器与跨线程任务队列。
+// 一个循环只在一个线程中运行，挂在其上的会话全部是非阻塞状态机。
+// 定时器由分层时间轮管理，timerfd 按微秒级绝对时间唤醒，不受 epoll_wait 毫秒精度限制
+class EventLoop {
+public:
+    typedef std::function<void()> Task;
+
+    EventLoop();
+    ~EventLoop();
+
+    // 注册 fd，默认以边沿触发方式同时关注读写
+    bool addFd(int fd, IoHandler* handler, uint32_t events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET);
+    bool modifyFd(int fd, IoHandler* handler, uint32_t events);
+    void removeFd(int fd);
+    // 等待并分发一轮事件，timeoutMs < 0 表示无限等待，返回处理的事件数
+    int runOnce(int timeoutMs);
+    // 持续运行直到 stop()
+    void run();
+    // 可在任意线程调用
+    void stop();
+    void wakeup();
+    // 投递任务，在本轮事件分发之后于循环线程执行；可在任意线程调用
+    void runInLoop(const Task& task);
+    // 添加一次性定时器，返回定时器 ID（不为 0）；只能在循环线程调用
+    uint64_t addTimer(int delayMs, const Task& task);
+    // 在单调时钟的指定时刻触发，精度为时间轮的 tick（100 微秒）
+    uint64_t addTimerAt(std::chrono::steady_clock::time_point when, const Task& task);
+    void cancelTimer(uint64_t timerId);
+    // 循环自身的系统调用次数（epoll_wait、timerfd/eventfd 读写），只在循环线程或循环停止后读取
+    uint64_t syscalls() const { return syscalls_; }
+
+private:
+    // 执行到期定时器并按下一个到期时间重设 timerfd
+    void runTimers();
+    void runPendingTasks();
+
+    int epollFd_; // epoll 句柄
+    int wakeupFd_; // eventfd，用于跨线程唤醒
+    int timerFd_; // timerfd，按时间轮的下一个到期时间唤醒
+    volatile bool running_; // 循环运行标志
+    std::vector<epoll_event> events_; // epoll_wait 输出缓冲
+    TimerWheel timers_; // 定时器
+    int64_t armedDeadline_; // timerfd 当前设定的到期时间（微秒），未设定为 -1
+    uint64_t syscalls_; // 系统调用计数
+    LockMutex taskLock_; // 保护 pendingTasks_
+    std::vector<Task> pendingTasks_; // 跨线程投递的任务
+};
+
+#endif // EVENT_LOOP_H
@@ -0,0 +1,103 @@
+#include "FlvReader.h"
+#include "Vnsp_WriteLog.h"
+#include <cstring>
+#include <algorithm>
+
+namespace {
+const uint64_t kFlvHeaderSize = 9; // FLV 头部最小长度，实际长度见头部 DataOffset
+const uint64_t kTagHeaderSize = 11; // Tag 头部
+const uint64_t kPrevTagSize = 4; // 每个 Tag 之后的 PreviousTagSize
+}
+
+FlvReader::FlvReader() : firstTagOffset_(0), offset_(0), eof_(false) {}
+
+FlvReader::~FlvReader() {
+    close();
+}
+
+bool FlvReader::open(const std::string& filePath) {
+    close();
+    // 文件描述符随映射保持打开，大 Tag 可经 sendfile 直接从文件发送
+    if (!file_.open(filePath)) return false;
+    if (file_.size() < kFlvHeaderSize + kPrevTagSize || memcmp(file_.data(), "FLV", 3) != 0) {
+        VNSP_LOG(LOG_ERROR, "FlvReader", "Invalid FLV file: %s", filePath.c_str());
+        close();
+        return false;
+    }
+    const uint8_t* header = file_.data();
+    uint32_t dataOffset = (static_cast<uint32_t>(header[5]) << 24) | (header[6] << 16) | (header[7] << 8) | header[8];
+    firstTagOffset_ = std::max<uint64_t>(dataOffset, kFlvHeaderSize) + kPrevTagSize;
+    if (firstTagOffset_ > file_.size()) {
+        VNSP_LOG(LOG_ERROR, "FlvReader", "Invalid FLV header size %u: %s", dataOffset, filePath.c_str());
+        close();
+        return false;
+    }
+    offset_ = firstTagOffset_;
+    eof_ = false;
+    file_.advise(file_.data() + offset_);
+    return true;
+}
+
+void FlvReader::close() {
+    file_.close();
+    firstTagOffset_ = 0;
+    offset_ = 0;
+    eof_ = false;
+}
+
+bool FlvReader::readTag(FlvTag& tag) {
+    uint64_t size = file_.size();
+    if (!file_.isOpen() || size - offset_ < kTagHeaderSize) {
+        eof_ = true;
+        return false;
+    }
+    const uint8_t* header = file_.data() + offset_;
+    uint32_t dataSize = (header[1] << 16) | (header[2] << 8) | header[3];
+    // 最后一个 Tag 不完整时当作文件结束
+    if (size - offset_ < kTagHeaderSize + dataSize + kPrevTagSize) {
+        eof_ = true;
+        return false;
+    }
+    tag.type = header[0];
+    tag.timestamp = (header[4] << 16) | (header[5] << 8) | header[6];
+    tag.timestamp |= (static_cast<uint32_t>(header[7]) << 24); // Timestamp Extended
+    tag.data = header + kTagHeaderSize;
+    tag.size = dataSize;
+    tag.offset = offset_;
+    offset_ += kTagHeaderSize + dataSize + kPrevTagSize;
+    file_.advise(header + kTagHeaderSize + dataSize + kPrevTagSize);
+    return true;
+}
+
+bool FlvReader::seek(uint64_t offset) {
+    if (!file_.isOpen() || offset < firstTagOffset_ || offset > file_.size()) return false;
+    offset_ = offset;
+    eof_ = false;
+    file_.readvise(file_.data() + offset_);
+    return true;
+}
+
+uint32_t FlvReader::durationMs() const {
+    uint64_t size = file_.size();
+    if (!file_.isOpen() || size < firstTagOffset_ + 2 * (kTagHeaderSize + kPrevTagSize)) return 0;
+    const uint8_t* tail = file_.end() - kPrevTagSize;
+    uint64_t lastSize = (static_cast<uint32_t>(tail[0]) << 24) | (tail[1] << 16) | (tail[2] << 8) | tail[3];
+    if (lastSize < kTagHeaderSize || lastSize > size - firstTagOffset_ - kPrevTagSize) return 0;
+    const uint8_t* first = file_.data() + firstTagOffset_;
+    const uint8_t* last = tail - lastSize;
+    uint32_t firstTs = (first[4] << 16) | (first[5] << 8) | first[6] | (static_cast<uint32_t>(first[7]) << 24);
+    uint32_t lastTs = (last[4] << 16) | (last[5] << 8) | last[6] | (static_cast<uint32_t>(last[7]) << 24);
+    return lastTs > firstTs ? lastTs - firstTs : 0;
+}
+
+void FlvReader::prefault(uint64_t bytes) const {
+    if (!file_.isOpen()) return;
+    file_.prefault(file_.data() + offset_, bytes);
+}
+
+void FlvReader::swap(FlvReader& other) {
+    file_.swap(other.file_);
+    std::swap(firstTagOffset_, other.firstTagOffset_);
+    std::swap(offset_, other.offset_);
+    std::swap(eof_, other.eof_);
+}
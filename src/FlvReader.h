@@ -0,0 +1,57 @@
+#ifndef FLV_READER_H
+#define FLV_READER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include "MappedFile.h"
+
+// 一个 FLV Tag，data 直接指向文件映射，reader 关闭或重新打开前有效
+struct FlvTag {
+    uint8_t type; // Tag 类型（8 音频 / 9 视频 / 18 脚本）
+    uint32_t timestamp; // 含扩展字节的时间戳
+    const uint8_t* data; // Tag 数据
+    uint32_t size; // Tag 数据长度
+    uint64_t offset; // Tag 头部在文件中的偏移
+};
+
+// 基于 mmap 的 FLV 读取器：整个文件只读映射，Tag 以指针视图给出，
+// 不为每个 Tag 分配缓冲也不复制数据，发送时直接从页缓存写出
+class FlvReader {
+public:
+    FlvReader();
+    ~FlvReader();
+
+    // 映射并校验 FLV 文件，定位到第一个 Tag；"-" 表示重定向自普通文件的标准输入
+    bool open(const std::string& filePath);
+    // 解除映射，之前给出的 Tag 视图全部失效
+    void close();
+    bool isOpen() const { return file_.isOpen(); }
+    // 映射对应的文件描述符，可用于 sendfile 直接发送 Tag 数据
+    int fd() const { return file_.fd(); }
+    // 映射内指针对应的文件偏移
+    uint64_t fileOffsetOf(const uint8_t* p) const { return p - file_.data(); }
+    // 读取下一个完整 Tag，文件结束或数据不完整时返回 false
+    bool readTag(FlvTag& tag);
+    // 定位到指定偏移处的 Tag（必须是 readTag 给出过的 offset）
+    bool seek(uint64_t offset);
+    // 把当前位置之后 bytes 字节逐页读入映射，用于在后台线程预热，之后读取这部分 Tag 不再缺页
+    void prefault(uint64_t bytes) const;
+    // 与另一个读取器交换映射与读取状态
+    void swap(FlvReader& other);
+    // readTag 是否已因文件结束返回过 false
+    bool eof() const { return eof_; }
+    uint64_t offset() const { return offset_; }
+    uint64_t fileSize() const { return file_.size(); }
+    // 首尾 Tag 的时间戳差（毫秒），由文件末尾的 PreviousTagSize 直接定位最后一个 Tag，不扫描文件；
+    // 无法确定时返回 0
+    uint32_t durationMs() const;
+
+private:
+    MappedFile file_; // 文件映射，负责顺序读取的预读提示
+    uint64_t firstTagOffset_; // 第一个 Tag 的偏移，由头部 DataOffset 加上第一个 PreviousTagSize 得出
+    uint64_t offset_; // 下一个 Tag 的偏移
+    bool eof_; // 是否已读到文件结束
+};
+
+#endif // FLV_READER_H
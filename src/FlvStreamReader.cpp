@@ -0,0 +1,190 @@
+#include "FlvStreamReader.h"
+#include "Vnsp_WriteLog.h"
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+namespace {
+const size_t kFlvHeaderSize = 9; // FLV 头部，其后是 4 字节 PreviousTagSize0
+const size_t kTagHeaderSize = 11; // Tag 头部
+const size_t kPrevTagSize = 4; // 每个 Tag 之后的 PreviousTagSize
+const size_t kInitialBufferSize = 256 * 1024; // 初始读缓冲
+const char kUnixPrefix[] = "unix:";
+}
+
+FlvStreamReader::FlvStreamReader()
+    : fd_(-1), ownsFd_(false), savedFlags_(-1), fifo_(false), begin_(0), end_(0), headerParsed_(false), streamOffset_(0),
+      eof_(false), failed_(false) {}
+
+FlvStreamReader::~FlvStreamReader() {
+    close();
+}
+
+bool FlvStreamReader::isStreamSource(const std::string& source) {
+    struct stat st;
+    // 标准输入重定向自普通文件（xrtc_rtmppush < a.flv）时按文件处理，由 FlvReader 映射
+    if (source == "-") return fstat(STDIN_FILENO, &st) != 0 || !S_ISREG(st.st_mode);
+    if (source.compare(0, sizeof(kUnixPrefix) - 1, kUnixPrefix) == 0) return true;
+    return stat(source.c_str(), &st) == 0 && (S_ISFIFO(st.st_mode) || S_ISSOCK(st.st_mode));
+}
+
+bool FlvStreamReader::open(const std::string& source) {
+    close();
+    std::string socketPath;
+    struct stat st;
+    if (source.compare(0, sizeof(kUnixPrefix) - 1, kUnixPrefix) == 0) {
+        socketPath = source.substr(sizeof(kUnixPrefix) - 1);
+    } else if (source != "-" && stat(source.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+        socketPath = source;
+    }
+
+    if (source == "-") {
+        fd_ = STDIN_FILENO;
+        ownsFd_ = false;
+        fifo_ = false;
+        // 文件状态标志与父进程（shell）共享，close 时恢复
+        int flags = fcntl(fd_, F_GETFL);
+        if (flags < 0 || fcntl(fd_, F_SETFL, flags | O_NONBLOCK) < 0) {
+            VNSP_LOG(LOG_ERROR, "FlvStreamReader", "Failed to make stdin non-blocking: %s", strerror(errno));
+            fd_ = -1;
+            return false;
+        }
+        savedFlags_ = flags;
+    } else if (!socketPath.empty()) {
+        sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (socketPath.size() >= sizeof(addr.sun_path)) {
+            VNSP_LOG(LOG_ERROR, "FlvStreamReader", "Unix socket path too long: %s", socketPath.c_str());
+            return false;
+        }
+        memcpy(addr.sun_path, socketPath.c_str(), socketPath.size());
+        // 本地套接字的 connect 立即完成，之后再设为非阻塞
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) < 0) {
+            VNSP_LOG(LOG_ERROR, "FlvStreamReader", "Failed to connect to %s: %s", socketPath.c_str(), strerror(errno));
+            if (fd >= 0) ::close(fd);
+            return false;
+        }
+        fd_ = fd;
+        ownsFd_ = true;
+        fifo_ = false;
+    } else {
+        // 非阻塞打开 FIFO 不等写入端，写入端连接后由 EPOLLIN 唤醒
+        fd_ = ::open(source.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+        if (fd_ < 0) {
+            VNSP_LOG(LOG_ERROR, "FlvStreamReader", "Failed to open %s: %s", source.c_str(), strerror(errno));
+            return false;
+        }
+        ownsFd_ = true;
+        fifo_ = fstat(fd_, &st) == 0 && S_ISFIFO(st.st_mode);
+    }
+    if (buffer_.size() < kInitialBufferSize) {
+        buffer_.resize(kInitialBufferSize);
+    }
+    begin_ = 0;
+    end_ = 0;
+    headerParsed_ = false;
+    streamOffset_ = 0;
+    eof_ = false;
+    failed_ = false;
+    return true;
+}
+
+void FlvStreamReader::close() {
+    if (fd_ >= 0 && ownsFd_) {
+        ::close(fd_);
+    } else if (fd_ >= 0 && savedFlags_ >= 0) {
+        fcntl(fd_, F_SETFL, savedFlags_);
+    }
+    fd_ = -1;
+    ownsFd_ = false;
+    savedFlags_ = -1;
+    begin_ = 0;
+    end_ = 0;
+}
+
+bool FlvStreamReader::readTag(FlvTag& tag) {
+    if (fd_ < 0 || failed_) return false;
+    while (true) {
+        size_t available = end_ - begin_;
+        const uint8_t* data = buffer_.data() + begin_;
+        if (!headerParsed_) {
+            if (available >= kFlvHeaderSize) {
+                if (memcmp(data, "FLV", 3) != 0) {
+                    VNSP_LOG(LOG_ERROR, "FlvStreamReader", "Input is not an FLV stream");
+                    failed_ = true;
+                    return false;
+                }
+                uint32_t dataOffset = (static_cast<uint32_t>(data[5]) << 24) | (data[6] << 16) | (data[7] << 8) | data[8];
+                size_t skip = (dataOffset < kFlvHeaderSize ? kFlvHeaderSize : dataOffset) + kPrevTagSize;
+                if (skip > buffer_.size()) {
+                    VNSP_LOG(LOG_ERROR, "FlvStreamReader", "Invalid FLV header size %u", dataOffset);
+                    failed_ = true;
+                    return false;
+                }
+                if (available >= skip) {
+                    begin_ += skip;
+                    streamOffset_ += skip;
+                    headerParsed_ = true;
+                    continue;
+                }
+            }
+        } else if (available >= kTagHeaderSize) {
+            uint32_t dataSize = (data[1] << 16) | (data[2] << 8) | data[3];
+            size_t tagSize = kTagHeaderSize + dataSize + kPrevTagSize;
+            if (available >= tagSize) {
+                tag.type = data[0];
+                tag.timestamp = (data[4] << 16) | (data[5] << 8) | data[6];
+                tag.timestamp |= (static_cast<uint32_t>(data[7]) << 24); // Timestamp Extended
+                tag.data = data + kTagHeaderSize;
+                tag.size = dataSize;
+                tag.offset = streamOffset_;
+                begin_ += tagSize;
+                streamOffset_ += tagSize;
+                return true;
+            }
+            // 缓冲放不下这个 Tag 时按需扩大，之后一直复用
+            if (tagSize > buffer_.size()) {
+                buffer_.resize(tagSize);
+            }
+        }
+        if (eof_ || !fill()) return false;
+    }
+}
+
+bool FlvStreamReader::fill() {
+    // 上一个 Tag 已经交给发送队列（实时输入的 Tag 总是复制进队列），把剩余数据移到缓冲开头
+    if (begin_ > 0) {
+        memmove(buffer_.data(), buffer_.data() + begin_, end_ - begin_);
+        end_ -= begin_;
+        begin_ = 0;
+    }
+    while (true) {
+        ssize_t n = read(fd_, buffer_.data() + end_, buffer_.size() - end_);
+        if (n > 0) {
+            end_ += n;
+            return true;
+        }
+        if (n == 0) {
+            // FIFO 在写入端连接前读到 0，并不是结束
+            if (fifo_ && streamOffset_ == 0 && end_ == 0) return false;
+            eof_ = true;
+            if (end_ > begin_) {
+                VNSP_LOG(LOG_WARN, "FlvStreamReader", "Input ended with %zu bytes of incomplete tag", end_ - begin_);
+            }
+            return false;
+        }
+        if (errno == EINTR) continue;
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            VNSP_LOG(LOG_ERROR, "FlvStreamReader", "Failed to read input: %s", strerror(errno));
+            failed_ = true;
+        }
+        return false;
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef FLV_STREAM_READER_H
+#define FLV_STREAM_READER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "FlvReader.h"
+
+// 实时 FLV 输入的增量解析器：从标准输入、FIFO 或 Unix 域套接字非阻塞地读取编码器输出，
+// Tag 一旦完整即可取出。数据直接读入一块可复用的缓冲，已取走的部分在下次读入前整理掉，
+// 缓冲只增长到最大 Tag 的大小，不随流长度增长
+class FlvStreamReader {
+public:
+    FlvStreamReader();
+    ~FlvStreamReader();
+
+    // source 为实时输入时返回 true："-" 表示标准输入（重定向自普通文件时除外），"unix:路径" 表示 Unix 域套接字，
+    // 或是文件系统中的 FIFO / 套接字文件
+    static bool isStreamSource(const std::string& source);
+    // 打开输入并设为非阻塞；FIFO 打开时不等待写入端
+    bool open(const std::string& source);
+    void close();
+    bool isOpen() const { return fd_ >= 0; }
+    // 输入描述符，用于在事件循环上等待 EPOLLIN
+    int fd() const { return fd_; }
+    // 取出下一个完整 Tag；缓冲中没有时从输入读取，直到凑齐一个 Tag 或读到 EAGAIN。
+    // 返回 false 时检查 eof()/failed() 区分暂无数据、输入结束与出错。
+    // tag.data 指向内部缓冲，下一次 readTag 前有效；tag.offset 为该 Tag 在流中的字节位置
+    bool readTag(FlvTag& tag);
+    // 输入已结束（写入端关闭）
+    bool eof() const { return eof_; }
+    // 输入出错或数据不是合法的 FLV
+    bool failed() const { return failed_; }
+
+private:
+    // 从输入读入一次数据，返回是否读到了新数据
+    bool fill();
+
+    int fd_; // 输入描述符
+    bool ownsFd_; // 关闭时是否关闭 fd_（标准输入不关闭）
+    int savedFlags_; // 标准输入原来的文件状态标志，关闭时恢复；-1 表示无需恢复
+    bool fifo_; // 输入是否为 FIFO：写入端连接前读到 0 不表示结束
+    std::vector<uint8_t> buffer_; // 读缓冲
+    size_t begin_; // 未解析数据的起点
+    size_t end_; // 已读入数据的终点
+    bool headerParsed_; // 是否已跳过 FLV 头部
+    uint64_t streamOffset_; // buffer_[begin_] 在流中的字节位置
+    bool eof_; // 是否已读到输入结束
+    bool failed_; // 是否出错
+};
+
+#endif // FLV_STREAM_READER_H
@@ -0,0 +1,95 @@
+#include "FrameDropper.h"
+#include "Vnsp_WriteLog.h"
+#include "VideoTag.h"
+
+namespace {
+// FLV 视频帧类型
+const int kFrameTypeKey = 1;
+const int kFrameTypeDisposable = 3;
+// 配置记录中 lengthSizeMinusOne 所在字节
+const size_t kAvcLengthSizeByte = 4;
+const size_t kHevcLengthSizeByte = 21;
+}
+
+FrameDropper::FrameDropper() : maxLatencyMs_(0), droppingGop_(false), nalLengthSize_(4) {}
+
+FrameDropper::FrameKind FrameDropper::classify(const uint8_t* data, size_t size) {
+    VideoTagInfo info;
+    if (!VideoTag::parse(data, size, info) || VideoTag::isConfig(info)) {
+        // 序列头里记下 NALU 长度字段的字节数，后续帧按它切分
+        if (info.packetType == VideoTag::SEQUENCE_START && VideoTag::isNaluCodec(info.fourCc)) {
+            size_t lengthByte = info.fourCc == VideoTag::FOURCC_AVC ? kAvcLengthSizeByte : kHevcLengthSizeByte;
+            if (info.bodySize > lengthByte) {
+                nalLengthSize_ = (data[info.headerSize + lengthByte] & 0x03) + 1;
+            }
+        }
+        return FRAME_CONFIG;
+    }
+    if (info.frameType == kFrameTypeKey) return FRAME_KEY;
+    if (info.frameType == kFrameTypeDisposable) return FRAME_DISPOSABLE;
+    // H.264/HEVC 编码器都标为帧间帧，是否被参考要看 NALU 头；AV1 等其他编码按帧类型处理
+    if (VideoTag::isNaluCodec(info.fourCc) && info.bodySize > 0 &&
+        isNonReference(data + info.headerSize, info.bodySize, info.fourCc == VideoTag::FOURCC_HEVC)) {
+        return FRAME_DISPOSABLE;
+    }
+    return FRAME_INTER;
+}
+
+bool FrameDropper::isNonReference(const uint8_t* data, size_t size, bool hevc) const {
+    bool sawSlice = false;
+    size_t pos = 0;
+    while (pos + nalLengthSize_ < size) {
+        size_t length = 0;
+        for (size_t i = 0; i < nalLengthSize_; ++i) {
+            length = (length << 8) | data[pos + i];
+        }
+        pos += nalLengthSize_;
+        if (length == 0 || length > size - pos) return false;
+        uint8_t header = data[pos];
+        pos += length;
+        if (hevc) {
+            // HEVC：VCL 类型 0~31，其中不大于 14 的偶数类型（TRAIL_N、TSA_N、RASL_N 等）为子层非参考图像
+            int type = (header >> 1) & 0x3F;
+            if (type >= 32) continue;
+            if (type > 14 || (type & 1) != 0) return false;
+        } else {
+            // H.264：VCL 类型 1~5，nal_ref_idc 为 0 表示不被参考
+            int type = header & 0x1F;
+            if (type < 1 || type > 5) continue;
+            if ((header & 0x60) != 0) return false;
+        }
+        sawSlice = true;
+    }
+    return sawSlice;
+}
+
+bool FrameDropper::shouldDrop(const uint8_t* data, size_t size, int64_t lagMs) {
+    if (!enabled()) return false;
+    FrameKind kind = classify(data, size);
+    if (kind == FRAME_CONFIG) return false;
+    if (kind == FRAME_KEY) {
+        // 关键帧是恢复点：延迟回到预算内才恢复发送，否则连同这一组 GOP 继续丢弃
+        if (lagMs > maxLatencyMs_) {
+            if (!droppingGop_) {
+                VNSP_LOG(LOG_WARN, "FrameDropper", "Latency %" PRId64 " ms over budget %d ms, dropping GOP", lagMs,
+                         maxLatencyMs_);
+            }
+            droppingGop_ = true;
+            return true;
+        }
+        if (droppingGop_) {
+            VNSP_LOG(LOG_INFO, "FrameDropper", "Latency %" PRId64 " ms back within budget, resuming at keyframe", lagMs);
+            droppingGop_ = false;
+        }
+        return false;
+    }
+    if (droppingGop_) return true;
+    if (lagMs > maxLatencyMs_) {
+        // 丢掉被参考的帧后，直到下一个关键帧之前的帧都无法解码，整组丢弃
+        VNSP_LOG(LOG_WARN, "FrameDropper", "Latency %" PRId64 " ms over budget %d ms, dropping until next keyframe",
+                 lagMs, maxLatencyMs_);
+        droppingGop_ = true;
+        return true;
+    }
+    return kind == FRAME_DISPOSABLE && lagMs > maxLatencyMs_ / 2;
+}
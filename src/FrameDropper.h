@@ -0,0 +1,41 @@
+#ifndef FRAME_DROPPER_H
+#define FRAME_DROPPER_H
+
+#include <cstdint>
+#include <cstddef>
+
+// 拥塞丢帧策略：按 FLV 视频帧类型决定丢弃哪些视频 Tag，把推流相对实时的延迟限制在预算内。
+// 音频、脚本与序列头不经过本策略，总是发送。延迟超过预算一半时丢弃不被参考的帧；
+// 超过预算时丢弃之后的全部视频帧，直到延迟回落后的下一个关键帧，即整组 GOP 一起丢弃
+class FrameDropper {
+public:
+    // 视频 Tag 的丢弃优先级
+    enum FrameKind {
+        FRAME_CONFIG,    // 序列头、序列结束等解码配置，不可丢
+        FRAME_KEY,       // 关键帧，GOP 起点
+        FRAME_INTER,     // 被后续帧参考的帧间帧
+        FRAME_DISPOSABLE // 不被参考的帧，丢弃不影响其他帧解码
+    };
+
+    FrameDropper();
+
+    // 延迟预算（毫秒），0 表示不丢帧
+    void setMaxLatencyMs(int maxLatencyMs) { maxLatencyMs_ = maxLatencyMs; }
+    bool enabled() const { return maxLatencyMs_ > 0; }
+    // 判断视频 Tag 是否丢弃，lagMs 为该 Tag 现在写入时到达网络前的预计延迟
+    bool shouldDrop(const uint8_t* data, size_t size, int64_t lagMs);
+    // 是否处于整组 GOP 丢弃中
+    bool droppingGop() const { return droppingGop_; }
+    // 按视频头部（传统或 Enhanced RTMP 扩展头部）分类；H.264/HEVC 的帧间帧进一步检查 NALU 是否被参考
+    FrameKind classify(const uint8_t* data, size_t size);
+
+private:
+    // AVCC/HVCC 格式的帧是否全部由非参考 NALU 组成
+    bool isNonReference(const uint8_t* data, size_t size, bool hevc) const;
+
+    int maxLatencyMs_; // 延迟预算
+    bool droppingGop_; // 是否在丢弃到下一个关键帧
+    size_t nalLengthSize_; // NALU 长度字段字节数，取自序列头
+};
+
+#endif // FRAME_DROPPER_H
@@ -0,0 +1,97 @@
+#include "MappedFile.h"
+#include "Vnsp_WriteLog.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+
+namespace {
+const uint64_t kReadaheadBytes = 4 * 1024 * 1024; // 每次提示预读的窗口
+}
+
+MappedFile::MappedFile() : fd_(-1), base_(nullptr), size_(0), advisedEnd_(0) {}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string& path) {
+    close();
+    int fd = path == "-" ? fcntl(STDIN_FILENO, F_DUPFD_CLOEXEC, 0) : ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        VNSP_LOG(LOG_ERROR, "MappedFile", "Failed to open %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size <= 0) {
+        VNSP_LOG(LOG_ERROR, "MappedFile", "Empty or unreadable file: %s", path.c_str());
+        ::close(fd);
+        return false;
+    }
+    void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED) {
+        VNSP_LOG(LOG_ERROR, "MappedFile", "mmap %s failed: %s", path.c_str(), strerror(errno));
+        ::close(fd);
+        return false;
+    }
+    // 顺序读取：内核加大预读并尽早回收已读过的页
+    madvise(addr, st.st_size, MADV_SEQUENTIAL);
+    fd_ = fd;
+    base_ = static_cast<const uint8_t*>(addr);
+    size_ = st.st_size;
+    advisedEnd_ = 0;
+    advise(base_);
+    return true;
+}
+
+void MappedFile::close() {
+    if (base_ != nullptr) {
+        munmap(const_cast<uint8_t*>(base_), size_);
+        base_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    size_ = 0;
+    advisedEnd_ = 0;
+}
+
+void MappedFile::advise(const uint8_t* p) {
+    if (base_ == nullptr) return;
+    uint64_t offset = p - base_;
+    if (advisedEnd_ >= size_ || offset + kReadaheadBytes / 2 < advisedEnd_) return;
+    long pageSize = sysconf(_SC_PAGESIZE);
+    uint64_t start = offset & ~static_cast<uint64_t>(pageSize - 1);
+    uint64_t end = std::min<uint64_t>(offset + kReadaheadBytes, size_);
+    if (end > start) {
+        madvise(const_cast<uint8_t*>(base_) + start, end - start, MADV_WILLNEED);
+    }
+    advisedEnd_ = end;
+}
+
+void MappedFile::readvise(const uint8_t* p) {
+    advisedEnd_ = 0;
+    advise(p);
+}
+
+void MappedFile::prefault(const uint8_t* p, uint64_t bytes) const {
+    if (base_ == nullptr) return;
+    long pageSize = sysconf(_SC_PAGESIZE);
+    uint64_t offset = p - base_;
+    uint64_t end = std::min<uint64_t>(offset + bytes, size_);
+    volatile uint8_t sink = 0;
+    for (uint64_t pos = offset & ~static_cast<uint64_t>(pageSize - 1); pos < end; pos += pageSize) {
+        sink = sink + base_[pos];
+    }
+}
+
+void MappedFile::swap(MappedFile& other) {
+    std::swap(fd_, other.fd_);
+    std::swap(base_, other.base_);
+    std::swap(size_, other.size_);
+    std::swap(advisedEnd_, other.advisedEnd_);
+}
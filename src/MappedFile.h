@@ -0,0 +1,39 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+// 只读映射整个文件，供各类文件输入以指针直接访问数据；按顺序读取提示内核预读
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    // "-" 表示重定向自普通文件的标准输入，复制一个描述符映射，不影响标准输入本身
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return base_ != nullptr; }
+    const uint8_t* data() const { return base_; }
+    const uint8_t* end() const { return base_ + size_; }
+    uint64_t size() const { return size_; }
+    // 映射对应的文件描述符，与映射同生命周期，可用于 sendfile 直接发送文件数据
+    int fd() const { return fd_; }
+    // 读取推进到 p 时调用，进入已提示窗口后半段时再提示后面一段 WILLNEED
+    void advise(const uint8_t* p);
+    // 读取位置跳转到 p 后调用，丢弃原有窗口，从 p 开始重新提示
+    void readvise(const uint8_t* p);
+    // 把 p 之后 bytes 字节逐页读入映射，用于在后台线程预热
+    void prefault(const uint8_t* p, uint64_t bytes) const;
+    // 与另一个对象交换映射与预读状态
+    void swap(MappedFile& other);
+
+private:
+    int fd_; // 文件描述符
+    const uint8_t* base_; // 映射起始地址
+    uint64_t size_; // 文件大小
+    uint64_t advisedEnd_; // 已提示 WILLNEED 的范围终点
+};
+
+#endif // MAPPED_FILE_H
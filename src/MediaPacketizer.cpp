@@ -0,0 +1,514 @@
+#include "MediaPacketizer.h"
+#include "Vnsp_WriteLog.h"
+#include "VideoTag.h"
+#include <cstring>
+#include <algorithm>
+
+namespace {
+// FLV AAC 音频 Tag 的第一个字节：AAC，44 kHz，16 位，立体声（AAC 固定如此，实际参数在 AudioSpecificConfig）
+const uint8_t kAacSoundHeader = 0xAF;
+// AAC 采样率索引
+const int kAacSampleRates[13] = {96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050, 16000, 12000, 11025, 8000, 7350};
+
+// RBSP 比特读取，越界后读出 0 并置 error
+struct BitReader {
+    const uint8_t* data;
+    size_t size;
+    size_t bit;
+    bool error;
+    BitReader(const uint8_t* d, size_t s) : data(d), size(s), bit(0), error(false) {}
+    uint32_t readBits(int n) {
+        uint32_t v = 0;
+        for (int i = 0; i < n; ++i) {
+            if (bit >= size * 8) {
+                error = true;
+                return 0;
+            }
+            v = (v << 1) | ((data[bit >> 3] >> (7 - (bit & 7))) & 1);
+            ++bit;
+        }
+        return v;
+    }
+    void skipBits(size_t n) {
+        bit += n;
+        if (bit > size * 8) error = true;
+    }
+    uint32_t readUe() {
+        int zeros = 0;
+        while (readBits(1) == 0) {
+            if (error || ++zeros > 31) {
+                error = true;
+                return 0;
+            }
+        }
+        return ((1u << zeros) - 1) + readBits(zeros);
+    }
+    int32_t readSe() {
+        uint32_t v = readUe();
+        return (v & 1) ? static_cast<int32_t>((v + 1) / 2) : -static_cast<int32_t>(v / 2);
+    }
+};
+
+// 去掉防竞争字节 00 00 03 中的 03
+void unescapeRbsp(const uint8_t* data, size_t size, std::vector<uint8_t>& out) {
+    out.clear();
+    out.reserve(size);
+    int zeros = 0;
+    for (size_t i = 0; i < size; ++i) {
+        if (zeros >= 2 && data[i] == 0x03) {
+            zeros = 0;
+            continue;
+        }
+        zeros = data[i] == 0 ? zeros + 1 : 0;
+        out.push_back(data[i]);
+    }
+}
+
+void putU16(std::vector<uint8_t>& out, size_t v) {
+    out.push_back((v >> 8) & 0xFF);
+    out.push_back(v & 0xFF);
+}
+
+void putU32(uint8_t* p, uint32_t v) {
+    p[0] = (v >> 24) & 0xFF;
+    p[1] = (v >> 16) & 0xFF;
+    p[2] = (v >> 8) & 0xFF;
+    p[3] = v & 0xFF;
+}
+
+// 参数集与已保存的不同时保存并返回 true
+bool storeParameterSet(std::vector<uint8_t>& store, const Nalu& nalu) {
+    if (store.size() == nalu.size && memcmp(store.data(), nalu.data, nalu.size) == 0) return false;
+    store.assign(nalu.data, nalu.data + nalu.size);
+    return true;
+}
+
+// 跳过 HEVC SPS 的 scaling_list_data()
+void skipHevcScalingList(BitReader& br) {
+    for (int sizeId = 0; sizeId < 4 && !br.error; ++sizeId) {
+        for (int matrixId = 0; matrixId < 6; matrixId += sizeId == 3 ? 3 : 1) {
+            if (!br.readBits(1)) {
+                br.readUe(); // scaling_list_pred_matrix_id_delta
+                continue;
+            }
+            int coefNum = std::min(64, 1 << (4 + (sizeId << 1)));
+            if (sizeId > 1) br.readSe(); // scaling_list_dc_coef_minus8
+            for (int i = 0; i < coefNum && !br.error; ++i) br.readSe();
+        }
+    }
+}
+
+// 跳过 HEVC SPS 中的全部 st_ref_pic_set()，帧间预测的集合需要前一个集合的 NumDeltaPocs
+void skipHevcShortTermRefPicSets(BitReader& br) {
+    uint32_t count = br.readUe();
+    if (count > 64) {
+        br.error = true;
+        return;
+    }
+    std::vector<uint32_t> numDeltaPocs(count, 0);
+    for (uint32_t idx = 0; idx < count && !br.error; ++idx) {
+        if (idx != 0 && br.readBits(1)) {
+            // inter_ref_pic_set_prediction_flag：delta_rps_sign、abs_delta_rps_minus1，
+            // 再按参考集合的每个 delta POC（含自身）读 used/use_delta 标志
+            br.skipBits(1);
+            br.readUe();
+            for (uint32_t j = 0; j <= numDeltaPocs[idx - 1] && !br.error; ++j) {
+                bool used = br.readBits(1) != 0;
+                bool useDelta = used || br.readBits(1) != 0;
+                if (useDelta) ++numDeltaPocs[idx];
+            }
+        } else {
+            uint32_t negative = br.readUe();
+            uint32_t positive = br.readUe();
+            if (negative > 16 || positive > 16) {
+                br.error = true;
+                return;
+            }
+            for (uint32_t j = 0; j < negative + positive && !br.error; ++j) {
+                br.readUe(); // delta_poc_s0/s1_minus1
+                br.skipBits(1); // used_by_curr_pic_s0/s1_flag
+            }
+            numDeltaPocs[idx] = negative + positive;
+        }
+    }
+}
+
+// H.264 SPS 中 chroma_format_idc 等字段只在这些 profile 出现
+bool avcHighProfile(int profile) {
+    return profile == 100 || profile == 110 || profile == 122 || profile == 244 || profile == 44 || profile == 83 ||
+           profile == 86 || profile == 118 || profile == 128 || profile == 138 || profile == 139 || profile == 134 ||
+           profile == 135;
+}
+}
+
+VideoPacketizer::VideoPacketizer(Codec codec)
+    : codec_(codec), enhanced_(false), configChanged_(false), haveConfig_(false), headerPending_(false), frameRate_(0),
+      chromaFormat_(1), bitDepthLuma_(0), bitDepthChroma_(0), maxSubLayers_(1), temporalIdNested_(false),
+      hevcPtl_() {}
+
+bool VideoPacketizer::startsAccessUnit(const Nalu& nalu, bool haveVcl) const {
+    if (!haveVcl) return false;
+    if (codec_ == CODEC_H264) {
+        int type = nalu.data[0] & 0x1F;
+        // AUD、SEI、SPS、PPS 及保留类型只能出现在图像之前
+        if (type == 9 || type == 6 || type == 7 || type == 8 || (type >= 14 && type <= 18)) return true;
+        // 片的 first_mb_in_slice 为 0（ue 编码首位为 1）表示新图像
+        if (type == 1 || type == 5) return nalu.size > 1 && (nalu.data[1] & 0x80) != 0;
+        return false;
+    }
+    if (nalu.size < 2) return false;
+    int type = (nalu.data[0] >> 1) & 0x3F;
+    if ((type >= 32 && type <= 35) || type == 39 || (type >= 41 && type <= 44) || (type >= 48 && type <= 55)) return true;
+    // first_slice_segment_in_pic_flag
+    if (type < 32) return nalu.size > 2 && (nalu.data[2] & 0x80) != 0;
+    return false;
+}
+
+bool VideoPacketizer::inspectNalu(const Nalu& nalu, bool& keyframe) {
+    if (codec_ == CODEC_HEVC) {
+        int type = (nalu.data[0] >> 1) & 0x3F;
+        if (type == 32 || type == 33 || type == 34) {
+            std::vector<uint8_t>& store = type == 32 ? vps_ : (type == 33 ? sps_ : pps_);
+            if (storeParameterSet(store, nalu)) {
+                configChanged_ = true;
+                if (type == 33) parseSps(nalu);
+            }
+            return false;
+        }
+        // AUD、序列/码流结束与填充数据不进入 AVCC
+        if (type >= 35 && type <= 38) return false;
+        if (type >= 16 && type <= 23) keyframe = true;
+        return true;
+    }
+    int type = nalu.data[0] & 0x1F;
+    if (type == 7 || type == 8) {
+        if (storeParameterSet(type == 7 ? sps_ : pps_, nalu)) {
+            configChanged_ = true;
+            if (type == 7) parseSps(nalu);
+        }
+        return false;
+    }
+    if (type == 9 || type == 10 || type == 11 || type == 12) return false;
+    if (type == 5) keyframe = true;
+    return true;
+}
+
+bool VideoPacketizer::finishFrame(std::vector<uint8_t>& frame, bool keyframe, int32_t cts) {
+    if (configChanged_ && buildSequenceHeader()) {
+        configChanged_ = false;
+        haveConfig_ = true;
+        headerPending_ = true;
+    }
+    if (!haveConfig_ || frame.size() <= headerSize()) return false;
+    VideoTag::writeHeader(&frame[0], exHeader(), keyframe ? 1 : 2, VideoTag::CODED_FRAMES, fourCc(), cts);
+    return true;
+}
+
+size_t VideoPacketizer::headerSize() const {
+    return VideoTag::headerSize(exHeader(), VideoTag::CODED_FRAMES, fourCc());
+}
+
+uint32_t VideoPacketizer::fourCc() const {
+    return codec_ == CODEC_HEVC ? VideoTag::FOURCC_HEVC : VideoTag::FOURCC_AVC;
+}
+
+bool VideoPacketizer::packetize(const Nalu* nalus, size_t count, int32_t cts, std::vector<uint8_t>& frame) {
+    bool keyframe = false;
+    // 先算出总长，帧缓冲只分配一次
+    size_t total = headerSize();
+    for (size_t i = 0; i < count; ++i) {
+        total += 4 + nalus[i].size;
+    }
+    frame.resize(total);
+    size_t offset = headerSize();
+    for (size_t i = 0; i < count; ++i) {
+        const Nalu& nalu = nalus[i];
+        if (nalu.size == 0 || !inspectNalu(nalu, keyframe)) continue;
+        putU32(&frame[offset], static_cast<uint32_t>(nalu.size));
+        memcpy(&frame[offset + 4], nalu.data, nalu.size);
+        offset += 4 + nalu.size;
+    }
+    frame.resize(offset);
+    return finishFrame(frame, keyframe, cts);
+}
+
+bool VideoPacketizer::packetizeInPlace(std::vector<uint8_t>& frame, int32_t cts) {
+    bool keyframe = false;
+    size_t offset = headerSize();
+    while (offset + 4 <= frame.size()) {
+        size_t size = (static_cast<size_t>(frame[offset]) << 24) | (frame[offset + 1] << 16) |
+                      (frame[offset + 2] << 8) | frame[offset + 3];
+        if (size == 0 || size > frame.size() - offset - 4) {
+            VNSP_LOG(LOG_WARN, "VideoPacketizer", "Bad NALU length %zu in frame of %zu bytes", size, frame.size());
+            return false;
+        }
+        Nalu nalu = {&frame[offset + 4], size};
+        inspectNalu(nalu, keyframe);
+        offset += 4 + size;
+    }
+    return finishFrame(frame, keyframe, cts);
+}
+
+bool VideoPacketizer::takeSequenceHeader(std::vector<uint8_t>& header) {
+    if (!headerPending_) return false;
+    headerPending_ = false;
+    header.assign(header_.begin(), header_.end());
+    return true;
+}
+
+bool VideoPacketizer::buildSequenceHeader() {
+    if (sps_.size() < 4 || pps_.empty() || (codec_ == CODEC_HEVC && vps_.empty())) return false;
+    uint8_t head[VideoTag::kMaxHeaderSize];
+    size_t headSize = VideoTag::writeHeader(head, exHeader(), 1, VideoTag::SEQUENCE_START, fourCc(), 0);
+    header_.assign(head, head + headSize);
+    if (codec_ == CODEC_H264) {
+        // AVCDecoderConfigurationRecord：profile/兼容性/level 直接取自 SPS，NALU 长度 4 字节
+        header_.push_back(1);
+        header_.push_back(sps_[1]);
+        header_.push_back(sps_[2]);
+        header_.push_back(sps_[3]);
+        header_.push_back(0xFF);
+        header_.push_back(0xE1); // 1 个 SPS
+        putU16(header_, sps_.size());
+        header_.insert(header_.end(), sps_.begin(), sps_.end());
+        header_.push_back(1); // 1 个 PPS
+        putU16(header_, pps_.size());
+        header_.insert(header_.end(), pps_.begin(), pps_.end());
+        if (avcHighProfile(sps_[1])) {
+            header_.push_back(0xFC | chromaFormat_);
+            header_.push_back(0xF8 | bitDepthLuma_);
+            header_.push_back(0xF8 | bitDepthChroma_);
+            header_.push_back(0); // 没有 SPS 扩展
+        }
+        return true;
+    }
+    // HEVCDecoderConfigurationRecord：general profile_tier_level 取自 SPS，NALU 长度 4 字节
+    header_.push_back(1);
+    header_.insert(header_.end(), hevcPtl_, hevcPtl_ + sizeof(hevcPtl_));
+    header_.push_back(0xF0); // min_spatial_segmentation_idc 0
+    header_.push_back(0x00);
+    header_.push_back(0xFC); // parallelismType 未知
+    header_.push_back(0xFC | chromaFormat_);
+    header_.push_back(0xF8 | bitDepthLuma_);
+    header_.push_back(0xF8 | bitDepthChroma_);
+    putU16(header_, 0); // avgFrameRate 未知
+    header_.push_back((maxSubLayers_ << 3) | (temporalIdNested_ ? 0x04 : 0) | 0x03);
+    header_.push_back(3); // VPS、SPS、PPS 三组
+    const std::vector<uint8_t>* sets[3] = {&vps_, &sps_, &pps_};
+    for (int i = 0; i < 3; ++i) {
+        header_.push_back(0x80 | (32 + i)); // array_completeness = 1
+        putU16(header_, 1);
+        putU16(header_, sets[i]->size());
+        header_.insert(header_.end(), sets[i]->begin(), sets[i]->end());
+    }
+    return true;
+}
+
+void VideoPacketizer::parseSps(const Nalu& sps) {
+    std::vector<uint8_t> rbsp;
+    size_t headerSize = codec_ == CODEC_H264 ? 1 : 2;
+    if (sps.size <= headerSize) return;
+    unescapeRbsp(sps.data + headerSize, sps.size - headerSize, rbsp);
+    BitReader br(rbsp.data(), rbsp.size());
+    chromaFormat_ = 1;
+    bitDepthLuma_ = 0;
+    bitDepthChroma_ = 0;
+
+    if (codec_ == CODEC_HEVC) {
+        br.skipBits(4); // sps_video_parameter_set_id
+        maxSubLayers_ = br.readBits(3) + 1;
+        temporalIdNested_ = br.readBits(1) != 0;
+        for (size_t i = 0; i < sizeof(hevcPtl_); ++i) {
+            hevcPtl_[i] = static_cast<uint8_t>(br.readBits(8));
+        }
+        bool subProfile[8] = {false};
+        bool subLevel[8] = {false};
+        for (int i = 0; i < maxSubLayers_ - 1; ++i) {
+            subProfile[i] = br.readBits(1) != 0;
+            subLevel[i] = br.readBits(1) != 0;
+        }
+        if (maxSubLayers_ > 1) {
+            br.skipBits(2 * (8 - (maxSubLayers_ - 1)));
+        }
+        for (int i = 0; i < maxSubLayers_ - 1; ++i) {
+            if (subProfile[i]) br.skipBits(88);
+            if (subLevel[i]) br.skipBits(8);
+        }
+        br.readUe(); // sps_seq_parameter_set_id
+        chromaFormat_ = br.readUe();
+        if (chromaFormat_ == 3) br.skipBits(1);
+        br.readUe(); // pic_width_in_luma_samples
+        br.readUe(); // pic_height_in_luma_samples
+        if (br.readBits(1)) {
+            for (int i = 0; i < 4; ++i) br.readUe(); // conformance window
+        }
+        bitDepthLuma_ = br.readUe();
+        bitDepthChroma_ = br.readUe();
+        uint32_t log2MaxPocLsb = br.readUe() + 4;
+        bool subLayerOrdering = br.readBits(1) != 0;
+        for (int i = subLayerOrdering ? 0 : maxSubLayers_ - 1; i < maxSubLayers_; ++i) {
+            for (int j = 0; j < 3; ++j) br.readUe(); // max_dec_pic_buffering、num_reorder_pics、max_latency_increase
+        }
+        for (int i = 0; i < 6; ++i) br.readUe(); // 编码块与变换块尺寸、变换层级深度
+        if (br.readBits(1) && br.readBits(1)) skipHevcScalingList(br);
+        br.skipBits(2); // amp_enabled_flag、sample_adaptive_offset_enabled_flag
+        if (br.readBits(1)) {
+            br.skipBits(8); // pcm_sample_bit_depth_luma/chroma_minus1
+            br.readUe();
+            br.readUe();
+            br.skipBits(1); // pcm_loop_filter_disabled_flag
+        }
+        skipHevcShortTermRefPicSets(br);
+        if (br.readBits(1)) {
+            uint32_t longTermRefs = br.readUe();
+            for (uint32_t i = 0; i < longTermRefs && !br.error; ++i) br.skipBits(log2MaxPocLsb + 1);
+        }
+        br.skipBits(2); // sps_temporal_mvp_enabled_flag、strong_intra_smoothing_enabled_flag
+        if (br.readBits(1)) {
+            // VUI：跳到 vui_timing_info 取帧率
+            if (br.readBits(1) && br.readBits(8) == 255) br.skipBits(32); // aspect_ratio_info
+            if (br.readBits(1)) br.skipBits(1); // overscan_info
+            if (br.readBits(1)) {
+                br.skipBits(4); // video_format、video_full_range_flag
+                if (br.readBits(1)) br.skipBits(24); // colour_description
+            }
+            if (br.readBits(1)) {
+                br.readUe(); // chroma_sample_loc_type
+                br.readUe();
+            }
+            br.skipBits(3); // neutral_chroma_indication_flag、field_seq_flag、frame_field_info_present_flag
+            if (br.readBits(1)) {
+                for (int i = 0; i < 4; ++i) br.readUe(); // default_display_window
+            }
+            if (br.readBits(1)) {
+                uint32_t unitsInTick = br.readBits(32);
+                uint32_t timeScale = br.readBits(32);
+                // 与 H.264 不同，HEVC 的帧率 = time_scale / num_units_in_tick
+                if (!br.error && unitsInTick > 0 && timeScale > 0) {
+                    frameRate_ = static_cast<double>(timeScale) / unitsInTick;
+                }
+            }
+        }
+    } else {
+        int profile = br.readBits(8);
+        br.skipBits(16); // constraint_set 标志与 level_idc
+        br.readUe(); // seq_parameter_set_id
+        if (avcHighProfile(profile)) {
+            chromaFormat_ = br.readUe();
+            if (chromaFormat_ == 3) br.skipBits(1);
+            bitDepthLuma_ = br.readUe();
+            bitDepthChroma_ = br.readUe();
+            br.skipBits(1); // qpprime_y_zero_transform_bypass_flag
+            if (br.readBits(1)) {
+                // 缩放矩阵只需跳过
+                int lists = chromaFormat_ != 3 ? 8 : 12;
+                for (int i = 0; i < lists && !br.error; ++i) {
+                    if (!br.readBits(1)) continue;
+                    int size = i < 6 ? 16 : 64;
+                    int last = 8, next = 8;
+                    for (int j = 0; j < size; ++j) {
+                        if (next != 0) next = (last + br.readSe() + 256) % 256;
+                        last = next == 0 ? last : next;
+                    }
+                }
+            }
+        }
+        br.readUe(); // log2_max_frame_num_minus4
+        uint32_t pocType = br.readUe();
+        if (pocType == 0) {
+            br.readUe();
+        } else if (pocType == 1) {
+            br.skipBits(1);
+            br.readSe();
+            br.readSe();
+            uint32_t cycle = br.readUe();
+            for (uint32_t i = 0; i < cycle && !br.error; ++i) br.readSe();
+        }
+        br.readUe(); // max_num_ref_frames
+        br.skipBits(1);
+        br.readUe(); // pic_width_in_mbs_minus1
+        br.readUe(); // pic_height_in_map_units_minus1
+        if (!br.readBits(1)) br.skipBits(1); // frame_mbs_only_flag / mb_adaptive_frame_field_flag
+        br.skipBits(1); // direct_8x8_inference_flag
+        if (br.readBits(1)) {
+            for (int i = 0; i < 4; ++i) br.readUe(); // frame_cropping
+        }
+        if (br.readBits(1)) {
+            // VUI：跳到 timing_info 取帧率
+            if (br.readBits(1) && br.readBits(8) == 255) br.skipBits(32); // aspect_ratio_info
+            if (br.readBits(1)) br.skipBits(1); // overscan_info
+            if (br.readBits(1)) {
+                br.skipBits(4); // video_format、video_full_range_flag
+                if (br.readBits(1)) br.skipBits(24); // colour_description
+            }
+            if (br.readBits(1)) {
+                br.readUe(); // chroma_sample_loc_type
+                br.readUe();
+            }
+            if (br.readBits(1)) {
+                uint32_t unitsInTick = br.readBits(32);
+                uint32_t timeScale = br.readBits(32);
+                // 帧率 = time_scale / (2 * num_units_in_tick)
+                if (!br.error && unitsInTick > 0 && timeScale > 0) {
+                    frameRate_ = timeScale / (2.0 * unitsInTick);
+                }
+            }
+        }
+    }
+    if (br.error) {
+        VNSP_LOG(LOG_WARN, "VideoPacketizer", "Truncated SPS of %zu bytes", sps.size);
+    }
+}
+
+AudioPacketizer::AudioPacketizer()
+    : config_(), haveConfig_(false), headerPending_(false), sampleRate_(44100), samplesPerFrame_(1024) {}
+
+size_t AudioPacketizer::adtsFrameSize(const uint8_t* data, size_t size) {
+    // 12 位同步字 0xFFF，layer 为 0
+    if (size < 7 || data[0] != 0xFF || (data[1] & 0xF6) != 0xF0) return 0;
+    size_t frameSize = ((data[3] & 0x03) << 11) | (data[4] << 3) | (data[5] >> 5);
+    size_t headerSize = adtsHeaderSize(data);
+    return frameSize > headerSize ? frameSize : 0;
+}
+
+bool AudioPacketizer::packetize(const uint8_t* adts, size_t size, std::vector<uint8_t>& frame) {
+    size_t frameSize = adtsFrameSize(adts, size);
+    if (frameSize == 0 || frameSize > size || !beginFrame(adts, frame)) return false;
+    size_t headerSize = adtsHeaderSize(adts);
+    frame.reserve(2 + frameSize - headerSize);
+    frame.insert(frame.end(), adts + headerSize, adts + frameSize);
+    return true;
+}
+
+bool AudioPacketizer::beginFrame(const uint8_t* adts, std::vector<uint8_t>& frame) {
+    int profile = (adts[2] >> 6) & 0x03;
+    int rateIndex = (adts[2] >> 2) & 0x0F;
+    int channels = ((adts[2] & 0x01) << 2) | (adts[3] >> 6);
+    if (rateIndex >= 13) return false;
+    sampleRate_ = kAacSampleRates[rateIndex];
+    samplesPerFrame_ = 1024 * ((adts[6] & 0x03) + 1);
+
+    // AudioSpecificConfig：audioObjectType = profile + 1，采样率索引，声道配置
+    uint8_t config[2];
+    config[0] = static_cast<uint8_t>(((profile + 1) << 3) | (rateIndex >> 1));
+    config[1] = static_cast<uint8_t>(((rateIndex & 1) << 7) | (channels << 3));
+    if (!haveConfig_ || memcmp(config, config_, sizeof(config)) != 0) {
+        memcpy(config_, config, sizeof(config));
+        haveConfig_ = true;
+        headerPending_ = true;
+        header_.assign(1, kAacSoundHeader);
+        header_.push_back(0); // 序列头
+        header_.insert(header_.end(), config, config + sizeof(config));
+    }
+    frame.resize(2);
+    frame[0] = kAacSoundHeader;
+    frame[1] = 1; // 原始帧
+    return true;
+}
+
+bool AudioPacketizer::takeSequenceHeader(std::vector<uint8_t>& header) {
+    if (!headerPending_) return false;
+    headerPending_ = false;
+    header.assign(header_.begin(), header_.end());
+    return true;
+}
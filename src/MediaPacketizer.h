@@ -0,0 +1,99 @@
+#ifndef MEDIA_PACKETIZER_H
+#define MEDIA_PACKETIZER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "AnnexB.h"
+
+// 把 Annex-B 访问单元打包成 RTMP 视频消息（与 FLV 视频 Tag 数据相同，NALU 改为 4 字节长度前缀），
+// HEVC 可选用 Enhanced RTMP 扩展视频头部（FourCC hvc1），
+// NALU 从输入直接复制到帧缓冲，只复制一次。带内的参数集被拿出来组成
+// AVCDecoderConfigurationRecord / HEVCDecoderConfigurationRecord，首次出现或变化时先给出一个序列头
+class VideoPacketizer {
+public:
+    enum Codec {
+        CODEC_H264,
+        CODEC_HEVC
+    };
+
+    explicit VideoPacketizer(Codec codec);
+
+    Codec codec() const { return codec_; }
+    // HEVC 是否使用扩展视频头部（默认关闭，按编码 ID 12）；H.264 总是使用传统头部，所有服务端都能接受
+    void setEnhanced(bool enhanced) { enhanced_ = enhanced; }
+    // 帧消息的视频头部长度：传统头部 5 字节，HEVC 扩展头部 8 字节
+    size_t headerSize() const;
+    // nalu 是否开始一个新的访问单元；haveVcl 为当前访问单元是否已有图像数据
+    bool startsAccessUnit(const Nalu& nalu, bool haveVcl) const;
+    // 打包一个访问单元，帧数据写入 frame（覆盖原内容）；收到参数集之前的帧无法解码，返回 false。
+    // 参数集首次出现或变化时生成新的序列头，由 takeSequenceHeader 取出，须先于该帧发送
+    bool packetize(const Nalu* nalus, size_t count, int32_t cts, std::vector<uint8_t>& frame);
+    // 就地完成一个已是 4 字节长度前缀格式的访问单元：frame 前 headerSize() 字节预留给视频头部，其后是 NALU。
+    // 参数集同样被拿出来生成序列头，但留在帧内不再移动数据（解码器忽略带内的重复参数集）
+    bool packetizeInPlace(std::vector<uint8_t>& frame, int32_t cts);
+    // 取出待发送的序列头，没有时返回 false
+    bool takeSequenceHeader(std::vector<uint8_t>& header);
+    // SPS 中 VUI 给出的帧率，没有时返回 0
+    double frameRate() const { return frameRate_; }
+
+private:
+    bool exHeader() const { return enhanced_ && codec_ == CODEC_HEVC; }
+    uint32_t fourCc() const;
+    // 保存参数集并检查关键帧，返回 NALU 是否应进入帧数据
+    bool inspectNalu(const Nalu& nalu, bool& keyframe);
+    // 按需生成序列头并填写 frame 的视频头部，还不能发送时返回 false
+    bool finishFrame(std::vector<uint8_t>& frame, bool keyframe, int32_t cts);
+    // 按当前参数集生成序列头，参数集不全时返回 false
+    bool buildSequenceHeader();
+    void parseSps(const Nalu& sps);
+
+    Codec codec_; // 编码
+    bool enhanced_; // HEVC 是否使用扩展视频头部
+    std::vector<uint8_t> vps_; // 当前 VPS（仅 HEVC）
+    std::vector<uint8_t> sps_; // 当前 SPS
+    std::vector<uint8_t> pps_; // 当前 PPS
+    bool configChanged_; // 参数集变化后尚未生成序列头
+    bool haveConfig_; // 是否已生成过序列头
+    bool headerPending_; // 序列头是否尚未取出
+    std::vector<uint8_t> header_; // 序列头 Tag 数据
+    double frameRate_; // VUI 帧率
+    // SPS 中解析出的、配置记录需要的字段
+    int chromaFormat_; // chroma_format_idc
+    int bitDepthLuma_; // bit_depth_luma_minus8
+    int bitDepthChroma_; // bit_depth_chroma_minus8
+    int maxSubLayers_; // HEVC sps_max_sub_layers_minus1 + 1
+    bool temporalIdNested_; // HEVC sps_temporal_id_nesting_flag
+    uint8_t hevcPtl_[12]; // HEVC general profile_tier_level
+};
+
+// 把 ADTS 帧打包成 RTMP AAC 音频消息，格式首次出现或变化时先给出 AudioSpecificConfig 序列头
+class AudioPacketizer {
+public:
+    AudioPacketizer();
+
+    // 解析 data 开头的 ADTS 头部，返回整帧长度（含头部）；不是 ADTS 帧返回 0
+    static size_t adtsFrameSize(const uint8_t* data, size_t size);
+    // ADTS 头部长度（有 CRC 时为 9），data 至少 2 字节
+    static size_t adtsHeaderSize(const uint8_t* data) { return (data[1] & 0x01) ? 7 : 9; }
+    // 打包一个完整的 ADTS 帧，帧数据写入 frame（覆盖原内容），不是有效的 ADTS 帧返回 false。
+    // 格式首次出现或变化时生成新的序列头，由 takeSequenceHeader 取出，须先于该帧发送
+    bool packetize(const uint8_t* adts, size_t size, std::vector<uint8_t>& frame);
+    // 只按 ADTS 头部开始一帧：frame 写入 2 字节音频头部，原始数据由调用方随后追加。
+    // 用于数据分散到达的输入（如 TS 包），帧数据直接追加到 frame 只复制一次
+    bool beginFrame(const uint8_t* adts, std::vector<uint8_t>& frame);
+    bool takeSequenceHeader(std::vector<uint8_t>& header);
+    // 最近一帧的采样率与样本数，用于推算时间戳
+    int sampleRate() const { return sampleRate_; }
+    int samplesPerFrame() const { return samplesPerFrame_; }
+
+private:
+    uint8_t config_[2]; // 当前 AudioSpecificConfig
+    bool haveConfig_; // 是否已生成过序列头
+    bool headerPending_; // 序列头是否尚未取出
+    std::vector<uint8_t> header_; // 序列头 Tag 数据
+    int sampleRate_; // 采样率
+    int samplesPerFrame_; // 每个 ADTS 帧的样本数
+};
+
+#endif // MEDIA_PACKETIZER_H
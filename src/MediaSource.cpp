@@ -0,0 +1,22 @@
+#include "MediaSource.h"
+#include "EsSource.h"
+#include "TsSource.h"
+#include "Mp4Source.h"
+#include <cctype>
+
+MediaSource* MediaSource::create(const std::string& path) {
+    if (TsSource::isTsPath(path)) return new TsSource();
+    if (Mp4Source::isMp4Path(path)) return new Mp4Source();
+    if (EsSource::isEsPath(path)) return new EsSource();
+    return nullptr;
+}
+
+std::string MediaSource::extensionOf(const std::string& path) {
+    size_t dot = path.rfind('.');
+    if (dot == std::string::npos || path.find('/', dot) != std::string::npos) return std::string();
+    std::string ext = path.substr(dot + 1);
+    for (size_t i = 0; i < ext.size(); ++i) {
+        ext[i] = static_cast<char>(tolower(static_cast<unsigned char>(ext[i])));
+    }
+    return ext;
+}
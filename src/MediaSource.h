@@ -0,0 +1,37 @@
+#ifndef MEDIA_SOURCE_H
+#define MEDIA_SOURCE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "FlvReader.h"
+
+// 非 FLV 输入：把其他封装或裸流转换成 RTMP 音视频消息（与 FLV Tag 数据格式相同），
+// 按时间戳顺序给出，由推流会话按时间戳节奏发送。消息负载写入调用方给出的缓冲，
+// 调用方把缓冲整个移交发送队列，帧数据从输入到套接字只复制一次
+class MediaSource {
+public:
+    MediaSource() : enhancedRtmp_(true) {}
+    virtual ~MediaSource() {}
+
+    // path 是支持的非 FLV 输入时创建对应的输入（尚未打开），否则返回 nullptr
+    static MediaSource* create(const std::string& path);
+
+    virtual bool open(const std::string& path) = 0;
+    // 读取下一条消息：负载写入 payload（覆盖原内容，可能与内部缓冲交换），tag.data 指向它。
+    // 返回 false 时 failed() 区分出错与输入结束
+    virtual bool readTag(FlvTag& tag, std::vector<uint8_t>& payload) = 0;
+    virtual bool failed() const = 0;
+    // 估算的码率（bit/s），未知时返回 0
+    virtual uint64_t bitrate() const { return 0; }
+    // 是否以 Enhanced RTMP 扩展视频头部输出 HEVC/AV1（默认开启），须在 open 之前设置
+    void setEnhancedRtmp(bool enhanced) { enhancedRtmp_ = enhanced; }
+
+    // 文件后缀（小写，不含点），没有时返回空串
+    static std::string extensionOf(const std::string& path);
+
+protected:
+    bool enhancedRtmp_; // 是否使用 Enhanced RTMP 扩展视频头部
+};
+
+#endif // MEDIA_SOURCE_H
@@ -0,0 +1,613 @@
+#include "Mp4Source.h"
+#include "Vnsp_WriteLog.h"
+#include "VideoTag.h"
+#include <cstring>
+#include <algorithm>
+
+namespace {
+// FLV AAC 音频 Tag 的第一个字节
+const uint8_t kAacSoundHeader = 0xAF;
+
+constexpr uint32_t fourcc(const char* s) {
+    return (static_cast<uint32_t>(s[0]) << 24) | (static_cast<uint32_t>(s[1]) << 16) |
+           (static_cast<uint32_t>(s[2]) << 8) | static_cast<uint32_t>(s[3]);
+}
+
+uint16_t readU16(const uint8_t* p) {
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+uint32_t readU32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+uint64_t readU64(const uint8_t* p) {
+    return (static_cast<uint64_t>(readU32(p)) << 32) | readU32(p + 4);
+}
+
+// 一个 box 的类型与内容（不含头部）
+struct Box {
+    uint32_t type;
+    const uint8_t* data;
+    size_t size;
+};
+
+// 读取 *pos 处的 box 并把 *pos 移到其后，box 不完整时返回 false
+bool nextBox(const uint8_t** pos, const uint8_t* end, Box& box) {
+    const uint8_t* p = *pos;
+    if (end - p < 8) return false;
+    uint64_t size = readU32(p);
+    size_t headerSize = 8;
+    if (size == 1) {
+        if (end - p < 16) return false;
+        size = readU64(p + 8);
+        headerSize = 16;
+    } else if (size == 0) {
+        // 延伸到文件末尾
+        size = end - p;
+    }
+    if (size < headerSize || size > static_cast<uint64_t>(end - p)) return false;
+    box.type = readU32(p + 4);
+    box.data = p + headerSize;
+    box.size = size - headerSize;
+    *pos = p + size;
+    return true;
+}
+
+// 在 [data, data + size) 的子 box 中查找第一个 type
+bool findBox(const uint8_t* data, size_t size, uint32_t type, Box& box) {
+    const uint8_t* p = data;
+    while (nextBox(&p, data + size, box)) {
+        if (box.type == type) return true;
+    }
+    return false;
+}
+
+// 读取一个 MPEG-4 描述符的标签与长度（长度每字节 7 位，最多 4 字节）
+bool readDescriptor(const uint8_t** pos, const uint8_t* end, uint8_t& tag, size_t& length) {
+    const uint8_t* p = *pos;
+    if (p >= end) return false;
+    tag = *p++;
+    length = 0;
+    for (int i = 0; i < 4; ++i) {
+        if (p >= end) return false;
+        uint8_t b = *p++;
+        length = (length << 7) | (b & 0x7F);
+        if ((b & 0x80) == 0) break;
+    }
+    if (length > static_cast<size_t>(end - p)) return false;
+    *pos = p;
+    return true;
+}
+
+// 从 esds 中取出 AAC 的 AudioSpecificConfig
+bool parseEsds(const uint8_t* data, size_t size, std::vector<uint8_t>& config) {
+    if (size < 4) return false;
+    const uint8_t* p = data + 4;
+    const uint8_t* end = data + size;
+    uint8_t tag;
+    size_t length;
+    // ES_Descriptor
+    if (!readDescriptor(&p, end, tag, length) || tag != 0x03 || length < 3) return false;
+    end = p + length;
+    uint8_t flags = p[2];
+    p += 3;
+    if (flags & 0x80) p += 2; // dependsOn_ES_ID
+    if (flags & 0x40) p += 1 + (p < end ? *p : 0); // URL
+    if (flags & 0x20) p += 2; // OCR_ES_Id
+    // DecoderConfigDescriptor
+    if (p > end || !readDescriptor(&p, end, tag, length) || tag != 0x04 || length < 13) return false;
+    uint8_t objectType = p[0];
+    // 0x40 MPEG-4 音频，0x66~0x68 MPEG-2 AAC
+    if (objectType != 0x40 && (objectType < 0x66 || objectType > 0x68)) return false;
+    end = p + length;
+    p += 13;
+    // DecoderSpecificInfo
+    if (!readDescriptor(&p, end, tag, length) || tag != 0x05 || length < 2) return false;
+    config.assign(p, p + length);
+    return true;
+}
+}
+
+Mp4Source::Track::Track()
+    : id(0), video(false), timescale(0), fourCc(0), exHeader(false), next(0), headerSent(false), defaultDuration(0),
+      defaultSize(0), defaultFlags(0), fragmentDts(0), editShift(0) {}
+
+Mp4Source::Mp4Source() : movieTimescale_(0), originMs_(0), bitrate_(0), failed_(false) {}
+
+bool Mp4Source::isMp4Path(const std::string& path) {
+    std::string ext = extensionOf(path);
+    return ext == "mp4" || ext == "m4v" || ext == "m4a" || ext == "mov";
+}
+
+bool Mp4Source::open(const std::string& path) {
+    if (!file_.open(path)) {
+        failed_ = true;
+        return false;
+    }
+    // 顶层 box：moov 在前，fMP4 的 moof 随后；mdat 只记录位置，不读取内容
+    const uint8_t* end = file_.end();
+    const uint8_t* p = file_.data();
+    bool haveMoov = false;
+    Box box;
+    while (p < end) {
+        const uint8_t* boxStart = p;
+        if (!nextBox(&p, end, box)) {
+            VNSP_LOG(LOG_WARN, "Mp4Source", "Truncated box at offset %llu in %s",
+                     static_cast<unsigned long long>(boxStart - file_.data()), path.c_str());
+            break;
+        }
+        if (box.type == fourcc("moov")) {
+            haveMoov = parseMoov(box.data, box.size);
+        } else if (box.type == fourcc("moof") && haveMoov) {
+            parseMoof(boxStart, box.data, box.size);
+        }
+    }
+    if (!haveMoov || (video_.id == 0 && audio_.id == 0)) {
+        VNSP_LOG(LOG_ERROR, "Mp4Source", "No H.264/HEVC or AAC track in %s", path.c_str());
+        failed_ = true;
+        return false;
+    }
+
+    // 截断的文件：丢弃数据不在文件内的样本
+    Track* tracks[] = {&video_, &audio_};
+    uint64_t totalBytes = 0;
+    int64_t firstMs = INT64_MAX, lastMs = 0;
+    for (Track* track : tracks) {
+        if (track->id == 0) continue;
+        for (size_t i = 0; i < track->samples.size(); ++i) {
+            const Sample& s = track->samples[i];
+            // 偏移来自文件中的 64 位字段，相加可能回绕，分开比较
+            if (s.offset > file_.size() || s.size > file_.size() - s.offset) {
+                VNSP_LOG(LOG_WARN, "Mp4Source", "Track %u truncated at sample %zu of %zu", track->id, i,
+                         track->samples.size());
+                track->samples.resize(i);
+                break;
+            }
+            totalBytes += s.size;
+        }
+        if (!track->samples.empty()) {
+            firstMs = std::min(firstMs, toMs(*track, track->samples.front().dts));
+            lastMs = std::max(lastMs, toMs(*track, track->samples.back().dts));
+        }
+    }
+    originMs_ = firstMs == INT64_MAX ? 0 : firstMs;
+    if (lastMs > originMs_) bitrate_ = totalBytes * 8 * 1000 / (lastMs - originMs_);
+    VNSP_LOG(LOG_INFO, "Mp4Source", "Indexed %s: %zu video and %zu audio samples, estimated bitrate %llu bps",
+             path.c_str(), video_.samples.size(), audio_.samples.size(), static_cast<unsigned long long>(bitrate_));
+    return true;
+}
+
+bool Mp4Source::parseMoov(const uint8_t* data, size_t size) {
+    const uint8_t* end = data + size;
+    Box box;
+    if (findBox(data, size, fourcc("mvhd"), box) && box.size >= (box.data[0] == 1 ? 24u : 16u)) {
+        movieTimescale_ = readU32(box.data + (box.data[0] == 1 ? 20 : 12));
+    }
+    for (const uint8_t* p = data; nextBox(&p, end, box);) {
+        if (box.type == fourcc("trak")) parseTrak(box.data, box.size);
+    }
+    // trex 引用轨道，轨道全部解析后再读
+    Box mvex;
+    if (findBox(data, size, fourcc("mvex"), mvex)) {
+        for (const uint8_t* p = mvex.data; nextBox(&p, mvex.data + mvex.size, box);) {
+            if (box.type == fourcc("trex")) parseTrex(box.data, box.size);
+        }
+    }
+    return true;
+}
+
+void Mp4Source::parseTrak(const uint8_t* data, size_t size) {
+    Box tkhd, mdia, mdhd, hdlr, minf, stbl;
+    if (!findBox(data, size, fourcc("tkhd"), tkhd) || !findBox(data, size, fourcc("mdia"), mdia)) return;
+    if (!findBox(mdia.data, mdia.size, fourcc("mdhd"), mdhd) || !findBox(mdia.data, mdia.size, fourcc("hdlr"), hdlr) ||
+        !findBox(mdia.data, mdia.size, fourcc("minf"), minf) || !findBox(minf.data, minf.size, fourcc("stbl"), stbl)) {
+        return;
+    }
+    bool v1 = tkhd.size > 0 && tkhd.data[0] == 1;
+    if (tkhd.size < (v1 ? 24u : 16u) || hdlr.size < 12 || mdhd.size < (mdhd.data[0] == 1 ? 24u : 16u)) return;
+    uint32_t handler = readU32(hdlr.data + 8);
+    if (handler != fourcc("vide") && handler != fourcc("soun")) return;
+    bool video = handler == fourcc("vide");
+    // 每类只取第一路
+    Track& slot = video ? video_ : audio_;
+    if (slot.id != 0) return;
+
+    Track track;
+    track.id = readU32(tkhd.data + (v1 ? 20 : 12));
+    track.video = video;
+    track.timescale = readU32(mdhd.data + (mdhd.data[0] == 1 ? 20 : 12));
+    if (track.timescale == 0) return;
+    Box stsd;
+    if (!findBox(stbl.data, stbl.size, fourcc("stsd"), stsd) || !parseStsd(track, stsd.data, stsd.size)) {
+        VNSP_LOG(LOG_INFO, "Mp4Source", "Skipping track %u with unsupported codec", track.id);
+        return;
+    }
+    if (!parseStbl(track, stbl.data, stbl.size)) return;
+    Box edts;
+    if (findBox(data, size, fourcc("edts"), edts)) parseEdts(track, edts.data, edts.size);
+    slot = std::move(track);
+}
+
+bool Mp4Source::parseStsd(Track& track, const uint8_t* data, size_t size) {
+    if (size < 8) return false;
+    const uint8_t* p = data + 8;
+    Box entry;
+    if (!nextBox(&p, data + size, entry)) return false;
+    Box config;
+    if (track.video) {
+        // VisualSampleEntry 固定部分 78 字节，之后是 avcC/hvcC/av1C 等子 box
+        bool avc = entry.type == fourcc("avc1") || entry.type == fourcc("avc3");
+        bool hevc = entry.type == fourcc("hvc1") || entry.type == fourcc("hev1");
+        // AV1 没有传统编码 ID，只能以扩展视频头部发送
+        bool av1 = entry.type == fourcc("av01") && enhancedRtmp_;
+        if ((!avc && !hevc && !av1) || entry.size < 78) return false;
+        uint32_t configType = avc ? fourcc("avcC") : (hevc ? fourcc("hvcC") : fourcc("av1C"));
+        if (!findBox(entry.data + 78, entry.size - 78, configType, config)) return false;
+        track.fourCc = avc ? VideoTag::FOURCC_AVC : (hevc ? VideoTag::FOURCC_HEVC : VideoTag::FOURCC_AV1);
+        track.exHeader = enhancedRtmp_ && !avc;
+        // 配置记录与 FLV 序列头的数据相同，样本的 NALU 长度字段也按记录中的长度发送
+        uint8_t head[VideoTag::kMaxHeaderSize];
+        size_t headSize = VideoTag::writeHeader(head, track.exHeader, 1, VideoTag::SEQUENCE_START, track.fourCc, 0);
+        track.header.assign(head, head + headSize);
+        track.header.insert(track.header.end(), config.data, config.data + config.size);
+        return true;
+    }
+    // AudioSampleEntry 固定部分 28 字节，QuickTime 第 1/2 版另有 16/36 字节
+    if (entry.type != fourcc("mp4a") || entry.size < 28) return false;
+    uint16_t version = readU16(entry.data + 8);
+    size_t skip = 28 + (version == 1 ? 16 : (version == 2 ? 36 : 0));
+    if (entry.size < skip) return false;
+    const uint8_t* children = entry.data + skip;
+    size_t childrenSize = entry.size - skip;
+    Box wave;
+    // QuickTime 把 esds 放在 wave 中
+    if (!findBox(children, childrenSize, fourcc("esds"), config) &&
+        !(findBox(children, childrenSize, fourcc("wave"), wave) &&
+          findBox(wave.data, wave.size, fourcc("esds"), config))) {
+        return false;
+    }
+    std::vector<uint8_t> audioConfig;
+    if (!parseEsds(config.data, config.size, audioConfig)) return false;
+    track.header.assign(1, kAacSoundHeader);
+    track.header.push_back(0); // 序列头
+    track.header.insert(track.header.end(), audioConfig.begin(), audioConfig.end());
+    return true;
+}
+
+bool Mp4Source::parseStbl(Track& track, const uint8_t* data, size_t size) {
+    Box stts, stsc, stsz, chunks, ctts, stss;
+    bool compactSizes = false;
+    if (!findBox(data, size, fourcc("stsz"), stsz)) {
+        if (!findBox(data, size, fourcc("stz2"), stsz)) return true; // 没有样本表（fMP4）
+        compactSizes = true;
+    }
+    bool largeOffsets = false;
+    if (!findBox(data, size, fourcc("stco"), chunks)) {
+        if (!findBox(data, size, fourcc("co64"), chunks)) return false;
+        largeOffsets = true;
+    }
+    if (!findBox(data, size, fourcc("stts"), stts) || !findBox(data, size, fourcc("stsc"), stsc)) return false;
+    bool haveCtts = findBox(data, size, fourcc("ctts"), ctts);
+    bool haveStss = findBox(data, size, fourcc("stss"), stss);
+
+    // 样本长度
+    if (stsz.size < 12) return false;
+    uint32_t count = readU32(stsz.data + 8);
+    uint32_t fixedSize = compactSizes ? 0 : readU32(stsz.data + 4);
+    int fieldBits = compactSizes ? stsz.data[7] : 32;
+    if (fieldBits != 4 && fieldBits != 8 && fieldBits != 16 && fieldBits != 32) return false;
+    if (fixedSize == 0 && static_cast<uint64_t>(count) * fieldBits > static_cast<uint64_t>(stsz.size - 12) * 8) {
+        return false;
+    }
+    if (fixedSize != 0) {
+        // 固定长度时没有逐样本的表，数量不受 stsz 长度约束：按 stts 的样本总数与文件能容纳的样本数截断，
+        // 损坏的数量不会分配巨大的索引
+        if (stts.size < 8) return false;
+        uint64_t timed = 0;
+        uint32_t sttsEntries = std::min<uint32_t>(readU32(stts.data + 4), (stts.size - 8) / 8);
+        for (uint32_t e = 0; e < sttsEntries; ++e) {
+            timed += readU32(stts.data + 8 + 8 * e);
+        }
+        uint64_t fits = file_.size() / fixedSize;
+        count = static_cast<uint32_t>(std::min<uint64_t>(count, std::min(timed, fits)));
+    }
+    std::vector<Sample>& samples = track.samples;
+    samples.resize(count);
+    const uint8_t* table = stsz.data + 12;
+    for (uint32_t i = 0; i < count; ++i) {
+        Sample& s = samples[i];
+        if (fixedSize != 0) {
+            s.size = fixedSize;
+        } else if (fieldBits == 32) {
+            s.size = readU32(table + 4 * i);
+        } else if (fieldBits == 16) {
+            s.size = readU16(table + 2 * i);
+        } else if (fieldBits == 8) {
+            s.size = table[i];
+        } else {
+            s.size = (i & 1) ? (table[i / 2] & 0x0F) : (table[i / 2] >> 4);
+        }
+        s.offset = 0;
+        s.dts = 0;
+        s.cts = 0;
+        s.keyframe = !haveStss;
+    }
+
+    // 解码时间
+    int64_t dts = 0;
+    uint32_t index = 0;
+    if (stts.size < 8) return false;
+    uint32_t entries = std::min<uint32_t>(readU32(stts.data + 4), (stts.size - 8) / 8);
+    for (uint32_t e = 0; e < entries && index < count; ++e) {
+        uint32_t n = readU32(stts.data + 8 + 8 * e);
+        uint32_t delta = readU32(stts.data + 12 + 8 * e);
+        for (uint32_t i = 0; i < n && index < count; ++i) {
+            samples[index++].dts = dts;
+            dts += delta;
+        }
+    }
+    track.fragmentDts = dts;
+
+    // 显示时间偏移，第 1 版为有符号数，第 0 版实际也常按有符号写入
+    if (haveCtts && ctts.size >= 8) {
+        index = 0;
+        entries = std::min<uint32_t>(readU32(ctts.data + 4), (ctts.size - 8) / 8);
+        for (uint32_t e = 0; e < entries && index < count; ++e) {
+            uint32_t n = readU32(ctts.data + 8 + 8 * e);
+            int32_t offset = static_cast<int32_t>(readU32(ctts.data + 12 + 8 * e));
+            for (uint32_t i = 0; i < n && index < count; ++i) {
+                samples[index++].cts = offset;
+            }
+        }
+    }
+
+    // 同步样本，没有 stss 时全部是同步样本
+    if (haveStss && stss.size >= 8) {
+        entries = std::min<uint32_t>(readU32(stss.data + 4), (stss.size - 8) / 4);
+        for (uint32_t e = 0; e < entries; ++e) {
+            uint32_t number = readU32(stss.data + 8 + 4 * e);
+            if (number >= 1 && number <= count) samples[number - 1].keyframe = true;
+        }
+    }
+
+    // 样本偏移：stsc 给出每个 chunk 的样本数，chunk 内样本连续存放
+    if (chunks.size < 8 || stsc.size < 8) return false;
+    size_t entrySize = largeOffsets ? 8 : 4;
+    uint32_t chunkCount = std::min<uint32_t>(readU32(chunks.data + 4), (chunks.size - 8) / entrySize);
+    entries = std::min<uint32_t>(readU32(stsc.data + 4), (stsc.size - 8) / 12);
+    index = 0;
+    for (uint32_t e = 0; e < entries && index < count; ++e) {
+        uint32_t firstChunk = readU32(stsc.data + 8 + 12 * e);
+        uint32_t perChunk = readU32(stsc.data + 12 + 12 * e);
+        uint32_t lastChunk = e + 1 < entries ? readU32(stsc.data + 8 + 12 * (e + 1)) : chunkCount + 1;
+        for (uint32_t c = firstChunk; c < lastChunk && c <= chunkCount && index < count; ++c) {
+            const uint8_t* entry = chunks.data + 8 + entrySize * (c - 1);
+            uint64_t offset = largeOffsets ? readU64(entry) : readU32(entry);
+            for (uint32_t i = 0; i < perChunk && index < count; ++i) {
+                samples[index].offset = offset;
+                offset += samples[index].size;
+                ++index;
+            }
+        }
+    }
+    // stsc 没有覆盖的样本没有位置
+    samples.resize(index);
+    return true;
+}
+
+void Mp4Source::parseEdts(Track& track, const uint8_t* data, size_t size) {
+    Box elst;
+    if (!findBox(data, size, fourcc("elst"), elst) || elst.size < 8) return;
+    bool v1 = elst.data[0] == 1;
+    size_t entrySize = v1 ? 20 : 12;
+    uint32_t entries = std::min<uint32_t>(readU32(elst.data + 4), (elst.size - 8) / entrySize);
+    // 只处理起点：开头的空编辑（media_time 为 -1）累计为延迟，第一段媒体编辑的 media_time 为起始显示时间。
+    // B 帧视频常见 media_time 等于第一帧的 CTS，不减去时视频会比音频晚这一段
+    int64_t delay = 0;
+    for (uint32_t e = 0; e < entries; ++e) {
+        const uint8_t* entry = elst.data + 8 + entrySize * e;
+        uint64_t duration = v1 ? readU64(entry) : readU32(entry);
+        int64_t mediaTime = v1 ? static_cast<int64_t>(readU64(entry + 8)) : static_cast<int32_t>(readU32(entry + 4));
+        if (mediaTime == -1) {
+            if (movieTimescale_ > 0) delay += static_cast<int64_t>(duration) * track.timescale / movieTimescale_;
+            continue;
+        }
+        track.editShift = mediaTime - delay;
+        if (entries > e + 1) {
+            VNSP_LOG(LOG_INFO, "Mp4Source", "Track %u: only the start of a %u-entry edit list is applied", track.id,
+                     entries);
+        }
+        return;
+    }
+}
+
+void Mp4Source::parseTrex(const uint8_t* data, size_t size) {
+    if (size < 24) return;
+    Track* track = trackById(readU32(data + 4));
+    if (track == nullptr) return;
+    track->defaultDuration = readU32(data + 12);
+    track->defaultSize = readU32(data + 16);
+    track->defaultFlags = readU32(data + 20);
+}
+
+void Mp4Source::parseMoof(const uint8_t* moof, const uint8_t* data, size_t size) {
+    Box box;
+    for (const uint8_t* p = data; nextBox(&p, data + size, box);) {
+        if (box.type == fourcc("traf")) parseTraf(moof, box.data, box.size);
+    }
+}
+
+void Mp4Source::parseTraf(const uint8_t* moof, const uint8_t* data, size_t size) {
+    Box tfhd;
+    if (!findBox(data, size, fourcc("tfhd"), tfhd) || tfhd.size < 8) return;
+    uint32_t flags = readU32(tfhd.data) & 0xFFFFFF;
+    Track* track = trackById(readU32(tfhd.data + 4));
+    if (track == nullptr) return;
+    const uint8_t* p = tfhd.data + 8;
+    const uint8_t* end = tfhd.data + tfhd.size;
+    // 数据基准：显式的 base_data_offset，否则取 moof 起点（default-base-is-moof，常见封装器都如此）
+    uint64_t base = moof - file_.data();
+    if (flags & 0x01) {
+        if (end - p < 8) return;
+        base = readU64(p);
+        p += 8;
+    }
+    if (flags & 0x02) p += 4; // sample_description_index
+    uint32_t defaultDuration = track->defaultDuration;
+    uint32_t defaultSize = track->defaultSize;
+    uint32_t defaultFlags = track->defaultFlags;
+    if (flags & 0x08) {
+        if (end - p < 4) return;
+        defaultDuration = readU32(p);
+        p += 4;
+    }
+    if (flags & 0x10) {
+        if (end - p < 4) return;
+        defaultSize = readU32(p);
+        p += 4;
+    }
+    if (flags & 0x20) {
+        if (end - p < 4) return;
+        defaultFlags = readU32(p);
+    }
+    int64_t dts = track->fragmentDts;
+    Box tfdt;
+    if (findBox(data, size, fourcc("tfdt"), tfdt) && tfdt.size >= 8) {
+        dts = tfdt.data[0] == 1 && tfdt.size >= 12 ? static_cast<int64_t>(readU64(tfdt.data + 4))
+                                                   : static_cast<int64_t>(readU32(tfdt.data + 4));
+    }
+
+    uint64_t offset = base;
+    Box trun;
+    for (const uint8_t* q = data; nextBox(&q, data + size, trun);) {
+        if (trun.type != fourcc("trun") || trun.size < 8) continue;
+        uint32_t runFlags = readU32(trun.data) & 0xFFFFFF;
+        uint32_t count = readU32(trun.data + 4);
+        const uint8_t* r = trun.data + 8;
+        const uint8_t* runEnd = trun.data + trun.size;
+        if (runFlags & 0x01) {
+            if (runEnd - r < 4) return;
+            int32_t dataOffset = static_cast<int32_t>(readU32(r));
+            // 负的 data_offset 不能越过数据基准之前
+            if (dataOffset < 0 && static_cast<uint64_t>(-static_cast<int64_t>(dataOffset)) > base) return;
+            offset = base + dataOffset;
+            r += 4;
+        }
+        bool haveFirstFlags = (runFlags & 0x04) != 0;
+        uint32_t firstFlags = 0;
+        if (haveFirstFlags) {
+            if (runEnd - r < 4) return;
+            firstFlags = readU32(r);
+            r += 4;
+        }
+        size_t fieldCount = ((runFlags >> 8) & 1) + ((runFlags >> 9) & 1) + ((runFlags >> 10) & 1) +
+                            ((runFlags >> 11) & 1);
+        if (static_cast<uint64_t>(count) * fieldCount * 4 > static_cast<uint64_t>(runEnd - r)) return;
+        if (!(runFlags & 0x200)) {
+            // 没有逐样本长度时 trun 本身不限制样本数：按默认长度截断到文件能容纳的数量，
+            // 损坏的 sample_count 不会逐个追加数十亿个样本
+            if (defaultSize == 0) return;
+            uint64_t room = offset < file_.size() ? file_.size() - offset : 0;
+            count = static_cast<uint32_t>(std::min<uint64_t>(count, room / defaultSize));
+        }
+        for (uint32_t i = 0; i < count; ++i) {
+            uint32_t duration = defaultDuration, sampleSize = defaultSize, sampleFlags = defaultFlags;
+            int32_t cts = 0;
+            if (runFlags & 0x100) {
+                duration = readU32(r);
+                r += 4;
+            }
+            if (runFlags & 0x200) {
+                sampleSize = readU32(r);
+                r += 4;
+            }
+            if (runFlags & 0x400) {
+                sampleFlags = readU32(r);
+                r += 4;
+            } else if (i == 0 && haveFirstFlags) {
+                sampleFlags = firstFlags;
+            }
+            if (runFlags & 0x800) {
+                cts = static_cast<int32_t>(readU32(r));
+                r += 4;
+            }
+            Sample s;
+            s.offset = offset;
+            s.size = sampleSize;
+            s.dts = dts;
+            s.cts = cts;
+            // sample_is_non_sync_sample
+            s.keyframe = !track->video || ((sampleFlags >> 16) & 1) == 0;
+            track->samples.push_back(s);
+            offset += sampleSize;
+            dts += duration;
+        }
+    }
+    track->fragmentDts = dts;
+}
+
+Mp4Source::Track* Mp4Source::trackById(uint32_t id) {
+    if (video_.id != 0 && video_.id == id) return &video_;
+    if (audio_.id != 0 && audio_.id == id) return &audio_;
+    return nullptr;
+}
+
+int64_t Mp4Source::toMs(const Track& track, int64_t t) {
+    return (t - track.editShift) * 1000 / static_cast<int64_t>(track.timescale);
+}
+
+bool Mp4Source::readTag(FlvTag& tag, std::vector<uint8_t>& payload) {
+    if (failed_) return false;
+    // 各轨道的序列头在其第一个样本之前发出
+    Track* tracks[] = {&video_, &audio_};
+    for (Track* track : tracks) {
+        if (track->id == 0 || track->headerSent) continue;
+        track->headerSent = true;
+        tag.type = track->video ? 9 : 8;
+        tag.timestamp = 0;
+        tag.offset = 0;
+        payload.assign(track->header.begin(), track->header.end());
+        tag.data = payload.data();
+        tag.size = static_cast<uint32_t>(payload.size());
+        return true;
+    }
+
+    // DTS 小的先发，相同时先发视频
+    Track* track = nullptr;
+    int64_t dtsMs = 0;
+    for (Track* t : tracks) {
+        if (t->id == 0 || t->next >= t->samples.size()) continue;
+        int64_t ms = toMs(*t, t->samples[t->next].dts);
+        if (track == nullptr || ms < dtsMs) {
+            track = t;
+            dtsMs = ms;
+        }
+    }
+    if (track == nullptr) return false;
+    const Sample& s = track->samples[track->next++];
+    const uint8_t* data = file_.data() + s.offset;
+    file_.advise(data);
+
+    // 样本从文件映射直接复制到消息缓冲，前面加上 FLV 音视频头部
+    size_t headSize = 2;
+    if (track->video) {
+        int32_t cts = static_cast<int32_t>(static_cast<int64_t>(s.cts) * 1000 / track->timescale);
+        // 扩展头部在 CompositionTime 为 0 时省去该字段
+        int packetType = track->exHeader && cts == 0 ? VideoTag::CODED_FRAMES_X : VideoTag::CODED_FRAMES;
+        headSize = VideoTag::headerSize(track->exHeader, packetType, track->fourCc);
+        payload.resize(headSize + s.size);
+        VideoTag::writeHeader(&payload[0], track->exHeader, s.keyframe ? 1 : 2, packetType, track->fourCc, cts);
+    } else {
+        payload.resize(headSize + s.size);
+        payload[0] = kAacSoundHeader;
+        payload[1] = 1; // 原始帧
+    }
+    memcpy(&payload[headSize], data, s.size);
+    tag.type = track->video ? 9 : 8;
+    tag.timestamp = dtsMs > originMs_ ? static_cast<uint32_t>(dtsMs - originMs_) : 0;
+    tag.offset = s.offset;
+    tag.data = payload.data();
+    tag.size = static_cast<uint32_t>(payload.size());
+    return true;
+}
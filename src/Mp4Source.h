@@ -0,0 +1,79 @@
+#ifndef MP4_SOURCE_H
+#define MP4_SOURCE_H
+
+#include "MediaSource.h"
+#include "MappedFile.h"
+
+// MP4/fMP4 文件输入（.mp4/.m4v/.m4a/.mov）。打开时遍历一次 moov 的样本表与所有 moof 的 trun，
+// 为第一路 H.264/HEVC/AV1 视频与第一路 AAC 音频建立样本索引（文件偏移、长度、DTS、CTS、是否关键帧），
+// 之后按 DTS 交错输出：样本数据从文件映射直接复制进消息缓冲，不经过 FLV 转封装；
+// edts/elst 的起点偏移（如 B 帧视频以第一帧 CTS 为 media_time）从时间戳中减去，音视频按显示时间对齐。
+// 视频样本本身就是长度前缀 NALU 或 AV1 OBU，avcC/hvcC/av1C 原样作为序列头；
+// 开启 Enhanced RTMP 时 HEVC/AV1 以扩展视频头部发送
+class Mp4Source : public MediaSource {
+public:
+    Mp4Source();
+
+    // 路径是否为 MP4 文件
+    static bool isMp4Path(const std::string& path);
+
+    bool open(const std::string& path) override;
+    bool readTag(FlvTag& tag, std::vector<uint8_t>& payload) override;
+    bool failed() const override { return failed_; }
+    uint64_t bitrate() const override { return bitrate_; }
+
+private:
+    // 一个样本
+    struct Sample {
+        uint64_t offset; // 文件偏移
+        uint32_t size; // 长度
+        int64_t dts; // 解码时间（轨道时间单位）
+        int32_t cts; // 显示时间与解码时间之差（轨道时间单位）
+        bool keyframe; // 是否同步样本
+    };
+
+    // 一路轨道
+    struct Track {
+        uint32_t id; // track_ID
+        bool video; // 视频或音频
+        uint32_t timescale; // 时间单位
+        std::vector<uint8_t> header; // 序列头消息
+        uint32_t fourCc; // 视频编码 FourCC
+        bool exHeader; // 是否使用扩展视频头部
+        std::vector<Sample> samples; // 样本索引，按解码顺序
+        size_t next; // 下一个待输出的样本
+        bool headerSent; // 序列头是否已输出
+        // trex 给出的片段默认值
+        uint32_t defaultDuration;
+        uint32_t defaultSize;
+        uint32_t defaultFlags;
+        int64_t fragmentDts; // 没有 tfdt 时下一个片段的起始 DTS
+        int64_t editShift; // 编辑列表给出的起点偏移（轨道时间单位），从样本时间中减去
+        Track();
+    };
+
+    // 解析 moov 与 moof，建立样本索引
+    bool parseMoov(const uint8_t* data, size_t size);
+    void parseTrak(const uint8_t* data, size_t size);
+    // 解析 stsd 的第一个样本描述，生成序列头；不支持的编码返回 false
+    bool parseStsd(Track& track, const uint8_t* data, size_t size);
+    bool parseStbl(Track& track, const uint8_t* data, size_t size);
+    // 按 edts/elst 计算轨道的起点偏移：开头的空编辑推迟轨道，第一段媒体编辑的 media_time 提前轨道
+    void parseEdts(Track& track, const uint8_t* data, size_t size);
+    void parseTrex(const uint8_t* data, size_t size);
+    void parseMoof(const uint8_t* moof, const uint8_t* data, size_t size);
+    void parseTraf(const uint8_t* moof, const uint8_t* data, size_t size);
+    Track* trackById(uint32_t id);
+    // 样本时间减去编辑列表偏移后换算成毫秒
+    static int64_t toMs(const Track& track, int64_t t);
+
+    MappedFile file_; // MP4 文件映射
+    Track video_; // 视频轨道，id 为 0 表示没有
+    Track audio_; // 音频轨道，id 为 0 表示没有
+    uint32_t movieTimescale_; // mvhd 的时间单位，编辑列表的时长按它计
+    int64_t originMs_; // 时间戳零点：各轨道第一个样本 DTS 中最早的一个（毫秒）
+    uint64_t bitrate_; // 由样本总长与时长估算的码率
+    bool failed_; // 是否出错
+};
+
+#endif // MP4_SOURCE_H
@@ -0,0 +1,258 @@
+#include "Resolver.h"
+#include "Vnsp_WriteLog.h"
+#include <netdb.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <arpa/nameser.h>
+#include <resolv.h>
+#include <pthread.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <strings.h>
+#include <fstream>
+#include <sstream>
+
+namespace {
+const int kDefaultTtlSec = 60; // 拿不到记录 TTL（如 /etc/hosts 中的名字）时的缓存时间
+const int kMinTtlSec = 1; // TTL 下限，避免 TTL 为 0 的记录让重连风暴退化为逐次查询
+const int kMaxTtlSec = 3600; // TTL 上限
+const int kNegativeTtlSec = 5; // 解析失败的缓存时间
+const int kTtlQueryTimeoutSec = 1; // TTL 查询的超时，只试一次，查不到就用默认 TTL
+
+int64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 查询线程参数
+struct QueryParam {
+    Resolver* resolver;
+    std::string host;
+};
+
+// 按 addrinfo 链表生成地址列表，保留 getaddrinfo 的排序（RFC 6724）
+void collectAddresses(const addrinfo* list, std::vector<SocketAddress>& addresses) {
+    for (const addrinfo* ai = list; ai != nullptr; ai = ai->ai_next) {
+        if (ai->ai_family != AF_INET && ai->ai_family != AF_INET6) continue;
+        if (ai->ai_addrlen > sizeof(sockaddr_storage)) continue;
+        SocketAddress address;
+        memcpy(&address.storage, ai->ai_addr, ai->ai_addrlen);
+        address.length = ai->ai_addrlen;
+        addresses.push_back(address);
+    }
+}
+
+// host 是否在 /etc/hosts 中（不区分大小写）
+bool inHostsFile(const std::string& host) {
+    std::ifstream file("/etc/hosts");
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream fields(line.substr(0, line.find('#')));
+        std::string name;
+        fields >> name; // 跳过地址
+        while (fields >> name) {
+            if (strcasecmp(name.c_str(), host.c_str()) == 0) return true;
+        }
+    }
+    return false;
+}
+
+// 名字是否由 DNS 之外的途径解析：/etc/hosts 或 mDNS（.local），这类名字没有记录 TTL 可查
+bool resolvedLocally(const std::string& host) {
+    static const char kMdnsSuffix[] = ".local";
+    std::string name = host;
+    if (!name.empty() && name[name.size() - 1] == '.') name.erase(name.size() - 1);
+    size_t suffixSize = sizeof(kMdnsSuffix) - 1;
+    if (name.size() >= suffixSize && strcasecmp(name.c_str() + name.size() - suffixSize, kMdnsSuffix) == 0) {
+        return true;
+    }
+    return inHostsFile(name);
+}
+
+// 向 DNS 查询 host 的记录 TTL（取应答中的最小值），失败返回 -1
+int queryTtl(const std::string& host, int family) {
+    struct __res_state state;
+    memset(&state, 0, sizeof(state));
+    if (res_ninit(&state) != 0) return -1;
+    // 地址已经拿到，这里只为缓存时间，不值得等系统配置的完整超时与重试
+    state.retrans = kTtlQueryTimeoutSec;
+    state.retry = 1;
+    unsigned char answer[4096];
+    int len = res_nquery(&state, host.c_str(), ns_c_in, family == AF_INET6 ? ns_t_aaaa : ns_t_a, answer, sizeof(answer));
+    res_nclose(&state);
+    if (len <= 0) return -1;
+    ns_msg msg;
+    if (ns_initparse(answer, len, &msg) != 0) return -1;
+    int ttl = -1;
+    int count = ns_msg_count(msg, ns_s_an);
+    for (int i = 0; i < count; ++i) {
+        ns_rr rr;
+        if (ns_parserr(&msg, ns_s_an, i, &rr) != 0) break;
+        int recordTtl = static_cast<int>(ns_rr_ttl(rr));
+        if (ttl < 0 || recordTtl < ttl) ttl = recordTtl;
+    }
+    return ttl;
+}
+}
+
+void SocketAddress::setPort(int port) {
+    if (family() == AF_INET6) {
+        reinterpret_cast<sockaddr_in6*>(&storage)->sin6_port = htons(port);
+    } else {
+        reinterpret_cast<sockaddr_in*>(&storage)->sin_port = htons(port);
+    }
+}
+
+std::string SocketAddress::toString() const {
+    char text[INET6_ADDRSTRLEN] = {0};
+    if (family() == AF_INET6) {
+        inet_ntop(AF_INET6, &reinterpret_cast<const sockaddr_in6*>(&storage)->sin6_addr, text, sizeof(text));
+    } else {
+        inet_ntop(AF_INET, &reinterpret_cast<const sockaddr_in*>(&storage)->sin_addr, text, sizeof(text));
+    }
+    return text;
+}
+
+Resolver& Resolver::instance() {
+    // 查询线程分离运行，实例不随进程退出析构
+    static Resolver* resolver = new Resolver();
+    return *resolver;
+}
+
+bool Resolver::lookup(const std::string& host, std::vector<SocketAddress>& addresses) {
+    addresses.clear();
+    // IP 字面量：AI_NUMERICHOST 不会发起任何查询
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_NUMERICHOST;
+    addrinfo* list = nullptr;
+    if (getaddrinfo(host.c_str(), nullptr, &hints, &list) == 0) {
+        collectAddresses(list, addresses);
+        freeaddrinfo(list);
+        return true;
+    }
+
+    AutoMutex lock(&lock_);
+    std::map<std::string, Entry>::iterator it = cache_.find(host);
+    if (it == cache_.end() || it->second.pending || it->second.expireUs <= nowUs()) return false;
+    addresses = it->second.addresses;
+    return true;
+}
+
+uint64_t Resolver::resolve(const std::string& host, EventLoop* loop, const Callback& callback) {
+    uint64_t requestId;
+    {
+        AutoMutex lock(&lock_);
+        requestId = ++nextRequestId_;
+        Entry& entry = cache_[host];
+        Waiter waiter;
+        waiter.id = requestId;
+        waiter.loop = loop;
+        waiter.callback = callback;
+        entry.waiters.push_back(waiter);
+        if (!entry.pending && entry.expireUs > nowUs()) {
+            // 缓存未过期（可能在 lookup 之后刚刚更新）
+            dispatch(entry);
+            return requestId;
+        }
+        // 已有查询在进行，等它的结果即可
+        if (entry.pending) return requestId;
+        entry.pending = true;
+    }
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    QueryParam* param = new QueryParam();
+    param->resolver = this;
+    param->host = host;
+    pthread_t threadId;
+    if (pthread_create(&threadId, &attr, OnResolveThread, param) != 0) {
+        VNSP_LOG(LOG_ERROR, "Resolver", "Failed to create resolve thread for %s", host.c_str());
+        delete param;
+        AutoMutex lock(&lock_);
+        Entry& entry = cache_[host];
+        entry.pending = false;
+        entry.addresses.clear();
+        entry.expireUs = 0;
+        dispatch(entry);
+    }
+    pthread_attr_destroy(&attr);
+    return requestId;
+}
+
+void Resolver::cancel(uint64_t requestId) {
+    AutoMutex lock(&lock_);
+    for (std::map<std::string, Entry>::iterator it = cache_.begin(); it != cache_.end(); ++it) {
+        std::vector<Waiter>& waiters = it->second.waiters;
+        for (size_t i = 0; i < waiters.size(); ++i) {
+            if (waiters[i].id == requestId) {
+                waiters.erase(waiters.begin() + i);
+                return;
+            }
+        }
+    }
+}
+
+void Resolver::dispatch(Entry& entry) {
+    const std::vector<SocketAddress>& addresses = entry.addresses;
+    for (size_t i = 0; i < entry.waiters.size(); ++i) {
+        Callback callback = entry.waiters[i].callback;
+        entry.waiters[i].loop->runInLoop([callback, addresses] { callback(addresses); });
+    }
+    entry.waiters.clear();
+}
+
+void* Resolver::OnResolveThread(void* pParam) {
+    QueryParam* param = static_cast<QueryParam*>(pParam);
+    param->resolver->runQuery(param->host);
+    delete param;
+    return NULL;
+}
+
+void Resolver::runQuery(const std::string& host) {
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_ADDRCONFIG;
+    addrinfo* list = nullptr;
+    int rc = getaddrinfo(host.c_str(), nullptr, &hints, &list);
+    std::vector<SocketAddress> addresses;
+    if (rc == 0) {
+        collectAddresses(list, addresses);
+        freeaddrinfo(list);
+    }
+    if (addresses.empty()) {
+        VNSP_LOG(LOG_ERROR, "Resolver", "Failed to resolve %s: %s", host.c_str(), rc == 0 ? "no address" : gai_strerror(rc));
+    } else {
+        VNSP_LOG(LOG_INFO, "Resolver", "Resolved %s to %zu addresses, first %s", host.c_str(), addresses.size(),
+                 addresses[0].toString().c_str());
+    }
+
+    // 先按默认 TTL 缓存并分发结果，连接不必等 TTL 查询
+    {
+        AutoMutex lock(&lock_);
+        Entry& entry = cache_[host];
+        entry.addresses = addresses;
+        entry.expireUs = nowUs() + static_cast<int64_t>(addresses.empty() ? kNegativeTtlSec : kDefaultTtlSec) * 1000000;
+        entry.pending = false;
+        dispatch(entry);
+    }
+    if (addresses.empty()) return;
+
+    // getaddrinfo 不提供记录 TTL，再向 DNS 查一次同类记录取 TTL 修正过期时间；
+    // 本地解析的名字向 DNS 查询只会等到超时，直接沿用默认 TTL
+    if (resolvedLocally(host)) return;
+    int ttl = queryTtl(host, addresses[0].family());
+    if (ttl < 0) return;
+    ttl = std::max(kMinTtlSec, std::min(ttl, kMaxTtlSec));
+    AutoMutex lock(&lock_);
+    Entry& entry = cache_[host];
+    if (!entry.pending && !entry.addresses.empty()) {
+        entry.expireUs = nowUs() + static_cast<int64_t>(ttl) * 1000000;
+    }
+}
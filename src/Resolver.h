@@ -0,0 +1,68 @@
+#ifndef RESOLVER_H
+#define RESOLVER_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+#include <functional>
+#include <sys/socket.h>
+#include "AutoLock.h"
+#include "EventLoop.h"
+
+// IPv4/IPv6 套接字地址
+struct SocketAddress {
+    sockaddr_storage storage; // 地址，端口由连接方填写
+    socklen_t length; // 有效长度
+    SocketAddress() : storage(), length(0) {}
+    int family() const { return storage.ss_family; }
+    const sockaddr* get() const { return reinterpret_cast<const sockaddr*>(&storage); }
+    void setPort(int port);
+    std::string toString() const;
+};
+
+// 主机名解析：查询在独立线程执行，不阻塞事件循环；结果按 DNS 记录的 TTL 缓存，进程内所有会话共享，
+// 同一主机名的并发请求合并为一次查询。解析经 getaddrinfo，/etc/hosts 与系统配置的 DNS 均生效
+class Resolver {
+public:
+    // 解析结果，失败时 addresses 为空
+    typedef std::function<void(const std::vector<SocketAddress>& addresses)> Callback;
+
+    static Resolver& instance();
+
+    // IP 字面量或缓存未过期时直接给出结果并返回 true，不发起查询
+    bool lookup(const std::string& host, std::vector<SocketAddress>& addresses);
+    // 异步解析，callback 经 loop->runInLoop 在该循环线程执行；可在任意线程调用。
+    // 返回请求 ID，请求方在结果到达前销毁时须 cancel，之后不再向其循环投递
+    uint64_t resolve(const std::string& host, EventLoop* loop, const Callback& callback);
+    void cancel(uint64_t requestId);
+
+private:
+    // 等待结果的请求
+    struct Waiter {
+        uint64_t id; // 请求 ID
+        EventLoop* loop; // 回调所在的事件循环
+        Callback callback; // 结果回调
+    };
+    // 一个主机名的缓存项
+    struct Entry {
+        std::vector<SocketAddress> addresses; // 解析结果，空表示解析失败（负缓存）
+        int64_t expireUs; // 过期时间（单调时钟，微秒）
+        bool pending; // 是否有查询正在进行
+        std::vector<Waiter> waiters; // 等待本次查询的请求
+        Entry() : expireUs(0), pending(false) {}
+    };
+
+    Resolver() : nextRequestId_(0) {}
+    static void* OnResolveThread(void* pParam);
+    // 在查询线程中执行一次解析并分发结果
+    void runQuery(const std::string& host);
+    // 把结果投递给 entry 的全部请求，须持有 lock_，以保证 cancel 返回后不再投递
+    static void dispatch(Entry& entry);
+
+    LockMutex lock_; // 保护以下成员
+    std::map<std::string, Entry> cache_; // 主机名 -> 缓存项
+    uint64_t nextRequestId_; // 上一个请求 ID
+};
+
+#endif // RESOLVER_H
@@ -1,534 +1,1526 @@
 #include "RtmpClient.h"
+#include "VideoTag.h"
 #include <sys/socket.h>
+#include <sys/random.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <linux/sockios.h>
+#include <sys/ioctl.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <algorithm>
 #include <iostream>
-#include <fstream>
 #include <cstring>
 #include <chrono>
-#include <thread>
+#include <atomic>
+#include <random>
+
+namespace {
+const int kSetupTimeoutMs = 15000; // TCP 连接、握手及 publish 的总超时
+const int kSendStallTimeoutMs = 10000; // 发送缓冲无进展的最长等待
+const int kReconnectDelayMs = 2000; // 重连间隔
+const int kCloseTimeoutMs = 2000; // 正常结束时等待释放流的命令写出、服务端关闭连接的时间
+const int kMaxReconnectAttempts = 3; // 连续重连次数上限
+const size_t kMaxPendingSendBytes = 512 * 1024; // 媒体数据在发送队列中的积压上限
+const size_t kResumePendingSendBytes = 256 * 1024; // 积压降到该值以下时恢复读取
+const size_t kDefaultChunkSize = 128; // 协议默认 Chunk 大小
+const size_t kInitialChunkSize = 4096; // connect 成功后首次声明的 Chunk 大小
+const size_t kDefaultMaxChunkSize = 65536; // 常见服务端（如 SRS）接受的上限
+const size_t kProtocolMaxChunkSize = 0xFFFFFF; // 超过消息长度上限的 Chunk 没有意义
+const uint64_t kDefaultBitrate = 2000000; // 无法估算码率时按 2 Mbps
+const int kMinSendBuffer = 64 * 1024; // SO_SNDBUF 下限
+const int kMinNotSentLowat = 16 * 1024; // TCP_NOTSENT_LOWAT 下限，低于一个关键帧时唤醒过于频繁
+const size_t kCommandBufferSize = 1024; // 命令编码用的栈缓冲，超长时改用堆缓冲
+const size_t kHandshakeSize = 1536; // C1/S1/C2/S2 长度
+const size_t kHandshakeRandomSize = kHandshakeSize - 8; // C1 中时间戳与零字段之后的随机部分
+const size_t kRandomPoolSize = 16384; // 握手随机池大小
+const size_t kRandomPoolStride = 1021; // 相邻连接取随机段的偏移步长
+const uint64_t kPrefetchBytes = 2 * 1024 * 1024; // 预取时读入映射的文件开头部分
+const uint32_t kDefaultFrameIntervalMs = 40; // 未观察到帧间隔时按 25 fps
+const uint32_t kMaxFrameIntervalMs = 1000; // 超过该值的时间戳跳变不视为帧间隔
+
+// 进程内共享的握手随机池，首次使用时生成一次，各连接按步长轮换取一段作为 C1 随机部分
+const uint8_t* handshakeRandomPool() {
+    static const std::vector<uint8_t> pool = [] {
+        std::vector<uint8_t> bytes(kRandomPoolSize);
+        size_t filled = 0;
+        while (filled < bytes.size()) {
+            ssize_t n = getrandom(bytes.data() + filled, bytes.size() - filled, 0);
+            if (n <= 0) break;
+            filled += n;
+        }
+        if (filled < bytes.size()) {
+            // getrandom 不可用时退回伪随机数，握手只要求数据不可预测性很低的随机填充
+            std::mt19937 gen(std::random_device{}());
+            for (size_t i = filled; i < bytes.size(); ++i) bytes[i] = static_cast<uint8_t>(gen());
+        }
+        return bytes;
+    }();
+    return pool.data();
+}
+std::atomic<size_t> randomPoolCursor(0); // 下一次取随机段的位置
+
+// 从随机池轮换取 size（不超过 kHandshakeRandomSize）字节
+void fillHandshakeRandom(uint8_t* out, size_t size) {
+    size_t offset = randomPoolCursor.fetch_add(kRandomPoolStride, std::memory_order_relaxed) %
+                    (kRandomPoolSize - kHandshakeRandomSize);
+    memcpy(out, handshakeRandomPool() + offset, size);
+}
+
+// onMetaData 脚本 Tag
+bool isOnMetaData(const uint8_t* data, size_t size) {
+    static const char kOnMetaData[] = "onMetaData";
+    const size_t nameSize = sizeof(kOnMetaData) - 1;
+    return size >= 3 + nameSize && data[0] == 0x02 && ((data[1] << 8) | data[2]) == nameSize &&
+           memcmp(data + 3, kOnMetaData, nameSize) == 0;
+}
+
+// 视频序列头（解码配置记录）：传统 AVC/HEVC 包类型 0，或扩展头部的 SequenceStart
+bool isVideoSequenceHeader(const uint8_t* data, size_t size) {
+    VideoTagInfo info;
+    return VideoTag::parse(data, size, info) && info.frameType != 5 &&
+           (info.packetType == VideoTag::SEQUENCE_START || info.packetType == VideoTag::MPEG2TS_SEQUENCE_START);
+}
+
+// 视频关键帧，不含序列头等配置 Tag
+bool isVideoKeyframe(const uint8_t* data, size_t size) {
+    VideoTagInfo info;
+    return VideoTag::parse(data, size, info) && info.frameType == 1 && !VideoTag::isConfig(info);
+}
+
+// AAC 序列头（AudioSpecificConfig）：声音格式 10，包类型 0
+bool isAudioSequenceHeader(const uint8_t* data, size_t size) {
+    return size >= 2 && (data[0] >> 4) == 10 && data[1] == 0;
+}
+
+// 不小于 n 的最小 2 的幂
+size_t roundUpPow2(size_t n) {
+    size_t v = 1;
+    while (v < n) v <<= 1;
+    return v;
+}
+}
 
 RtmpClient::RtmpClient(const std::string& server, int port, const std::string& app, const std::string& stream)
-    : server_(server), port_(port), app_(app), stream_(stream), socket_(-1), streamId_(1), fileOffset_(0), baseTimestamp_(0), chunkSize_(128) {}
+    : RtmpClient(nullptr, server, port, app, stream) {}
+
+RtmpClient::RtmpClient(EventLoop* loop, const std::string& server, int port, const std::string& app, const std::string& stream)
+    : server_(server), port_(port), app_(app), stream_(stream), socket_(-1),
+      ownedLoop_(loop == nullptr ? new EventLoop() : nullptr), loop_(loop == nullptr ? ownedLoop_.get() : loop),
+      state_(STATE_IDLE), writable_(false), c2Sent_(false), complexHandshake_(true), enhancedRtmp_(true),
+      serverDigest_(false),
+      fastOpen_(false), connector_(loop_), resolveRequest_(0), lifeToken_(new int(0)),
+      bitrate_(kDefaultBitrate),
+      bytesReceived_(0), lastAckedBytes_(0), inAckWindow_(0), outAckWindow_(0),
+      streamId_(1), transactionId_(0), createStreamTransaction_(0), publishTransaction_(0),
+      pipelined_(true), pipelining_(false), serialFallback_(false), baseTimestamp_(0), chunkSize_(kDefaultChunkSize),
+      maxChunkSize_(kDefaultMaxChunkSize), largestMessageSize_(0),
+      pushing_(false), finished_(false), finishOk_(false), waitingDrain_(false), firstTag_(true),
+      tagPending_(false), tag_(), lastSentTagOffset_(0), keyframeOffset_(0), input_(INPUT_FILE),
+      loopPlaylist_(false), playlistIndex_(0), nextIndex_(0), failedAssets_(0), prefetching_(false),
+      prefetchThread_(), prefetchJoinable_(false), waitingAsset_(false), retiredMark_(0), timelineOffset_(0), timelineEnd_(0), assetBaseTimestamp_(0),
+      assetBaseSet_(false), mediaEnded_(false), tagsSent_(false), waitKeyframe_(false),
+      setupTimer_(0), pacingTimer_(0), retryTimer_(0), closeTimer_(0), reconnectAttempts_(0) {
+    inputHandler_.owner = this;
+}
 
 RtmpClient::~RtmpClient() {
-    close();
+    finishCallback_ = nullptr;
+    cancelTimers();
+    closeSocket();
+    closeInput();
+    // 预取线程持有事件循环指针与 pendingAsset_，等它退出后事件循环与预取结果才能释放
+    joinPrefetch();
 }
 
 bool RtmpClient::connect() {
-    // 创建 TCP 套接字
-    socket_ = socket(AF_INET, SOCK_STREAM, 0);
-    if (socket_ < 0) {
-        VNSP_LOG(LOG_ERROR, "connect", "Failed to create socket: %s", strerror(errno));
+    // 阻塞接口：驱动自带的事件循环直到 publish 成功或失败，超时由 setupTimer_ 保证
+    if (!startConnect()) return false;
+    // 流水线被拒绝时 retryTimer_ 上挂着逐条模式的重连，需继续等待
+    while ((state_ != STATE_PUBLISHING && state_ != STATE_FAILED) || retryTimer_ != 0) {
+        loop_->runOnce(-1);
+    }
+    if (state_ != STATE_PUBLISHING) {
+        VNSP_LOG(LOG_ERROR, "connect", "RTMP session setup failed with %s:%d", server_.c_str(), port_);
+        closeSocket();
         return false;
     }
+    return true;
+}
 
-    // 设置非阻塞
-    int flags = fcntl(socket_, F_GETFL, 0);
-    fcntl(socket_, F_SETFL, flags | O_NONBLOCK);
-
-    // 连接到服务器
-    sockaddr_in serverAddr;
-    serverAddr.sin_family = AF_INET;
-    serverAddr.sin_port = htons(port_);
-    inet_pton(AF_INET, server_.c_str(), &serverAddr.sin_addr);
+bool RtmpClient::start(const std::string& filePath, const FinishCallback& callback) {
+    return start(std::vector<std::string>(1, filePath), false, callback);
+}
 
-    if (::connect(socket_, (sockaddr*)&serverAddr, sizeof(serverAddr)) < 0 && errno != EINPROGRESS) {
-        VNSP_LOG(LOG_ERROR, "connect", "Failed to connect to server %s:%d: %s", server_.c_str(), port_, strerror(errno));
-        close();
+bool RtmpClient::start(const std::vector<std::string>& playlist, bool loop, const FinishCallback& callback) {
+    if (playlist.empty()) return false;
+    finishCallback_ = callback;
+    resetPlaylist(playlist, loop);
+    if (!openFlvFile(playlist[0])) return false;
+    if (input_ == INPUT_LIVE && playlistMode()) {
+        VNSP_LOG(LOG_ERROR, "playlist", "Live input %s cannot be used in a playlist", playlist[0].c_str());
+        closeInput();
         return false;
     }
+    pushing_ = true;
+    finished_ = false;
+    reconnectAttempts_ = 0;
+    if (!startConnect()) {
+        // 首次连接同步失败同样走重连流程
+        scheduleRetry();
+    }
+    startPrefetch();
+    return true;
+}
 
-    // 等待连接完成
-    fd_set writeFds;
-    FD_ZERO(&writeFds);
-    FD_SET(socket_, &writeFds);
-    struct timeval tv = {5, 0}; // 5 秒超时
-    if (select(socket_ + 1, nullptr, &writeFds, nullptr, &tv) <= 0) {
-        VNSP_LOG(LOG_ERROR, "connect", "Connect timeout or error");
-        close();
-        return false;
+bool RtmpClient::startConnect() {
+    // 新连接从协议默认 Chunk 大小开始
+    chunkSize_ = kDefaultChunkSize;
+    chunkWriter_.reset();
+    chunkWriter_.setChunkSize(chunkSize_);
+    chunkReader_.reset();
+    bytesReceived_ = 0;
+    lastAckedBytes_ = 0;
+    inAckWindow_ = 0;
+    outAckWindow_ = 0;
+    transactionId_ = 0;
+    createStreamTransaction_ = 0;
+    publishTransaction_ = 0;
+    pipelining_ = false;
+    recvBuf_.clear();
+    writable_ = false;
+    state_ = STATE_RESOLVING;
+
+    // 解析、建连、握手与命令交互全部由事件驱动，整个过程受总超时约束
+    setupTimer_ = loop_->addTimer(kSetupTimeoutMs, [this] {
+        setupTimer_ = 0;
+        VNSP_LOG(LOG_ERROR, "connect", "Connect timeout or error with %s:%d", server_.c_str(), port_);
+        setFailed("setup timeout");
+    });
+
+    // IP 字面量或缓存命中时直接建连，否则在解析线程查询，同一主机名的并发重连共用一次查询
+    std::vector<SocketAddress> addresses;
+    if (Resolver::instance().lookup(server_, addresses)) {
+        return connectTo(addresses);
     }
+    std::weak_ptr<int> token = lifeToken_;
+    resolveRequest_ = Resolver::instance().resolve(server_, loop_, [this, token](const std::vector<SocketAddress>& result) {
+        if (token.expired() || state_ != STATE_RESOLVING) return;
+        resolveRequest_ = 0;
+        if (!connectTo(result)) {
+            setFailed("resolve");
+        }
+    });
+    return true;
+}
 
-    // 执行 RTMP 握手
-    if (!handshake()) {
-        VNSP_LOG(LOG_ERROR, "connect", "Handshake failed");
-        close();
+bool RtmpClient::connectTo(const std::vector<SocketAddress>& addresses) {
+    if (addresses.empty()) {
+        VNSP_LOG(LOG_ERROR, "connect", "Failed to resolve %s", server_.c_str());
+        closeSocket();
         return false;
     }
+    state_ = STATE_CONNECTING;
+    connector_.start(addresses, port_, fastOpen_, [this](int fd, int error) { onConnected(fd, error); });
+    return true;
+}
 
-    // 发送 connect 命令
-    if (!sendConnect()) {
-        std::cerr << "Send connect failed" << std::endl;
-        close();
-        return false;
+void RtmpClient::onConnected(int fd, int error) {
+    if (fd < 0) {
+        VNSP_LOG(LOG_ERROR, "connect", "Failed to connect to server %s:%d: %s", server_.c_str(), port_, strerror(error));
+        setFailed("connect");
+        return;
+    }
+    socket_ = fd;
+    applySocketProfile();
+    if (!loop_->addFd(socket_, this)) {
+        setFailed("connect");
+        return;
     }
+    writable_ = true;
+    // 执行 RTMP 握手；TCP Fast Open 时 C0+C1 随 SYN 发出。写失败时 flushSend 已标记失败
+    handshake();
+}
 
-    // 发送 createStream 命令
-    if (!sendCreateStream()) {
-        std::cerr << "Send createStream failed" << std::endl;
-        close();
-        return false;
+void RtmpClient::scheduleRetry() {
+    closeSocket();
+    if (!pushing_) return;
+    if (++reconnectAttempts_ > kMaxReconnectAttempts) {
+        VNSP_LOG(LOG_ERROR, "reconnect", "Failed to reconnect after %d attempts", kMaxReconnectAttempts);
+        finish(false);
+        return;
     }
+    // 首次重连立即进行，之后每次间隔 kReconnectDelayMs
+    int delayMs = reconnectAttempts_ == 1 ? 0 : kReconnectDelayMs;
+    VNSP_LOG(LOG_INFO, "reconnect", "Attempting to reconnect to %s:%d in %d ms", server_.c_str(), port_, delayMs);
+    retryTimer_ = loop_->addTimer(delayMs, [this] {
+        retryTimer_ = 0;
+        if (!startConnect()) {
+            scheduleRetry();
+        }
+    });
+}
 
-    // 发送 publish 命令
-    if (!sendPublish()) {
-        std::cerr << "Send publish failed" << std::endl;
-        close();
-        return false;
+void RtmpClient::handleIoEvent(uint32_t events) {
+    if (socket_ < 0 || state_ == STATE_FAILED) return;
+
+    if (events & (EPOLLERR | EPOLLHUP)) {
+        int err = 0;
+        socklen_t len = sizeof(err);
+        getsockopt(socket_, SOL_SOCKET, SO_ERROR, &err, &len);
+        VNSP_LOG(LOG_ERROR, "handleIoEvent", "Socket error: %s", strerror(err));
+        setFailed("socket");
+        return;
+    }
+    if (events & EPOLLOUT) {
+        onWritable();
+    }
+    if (events & (EPOLLIN | EPOLLRDHUP)) {
+        onReadable();
+    }
+}
+
+void RtmpClient::onWritable() {
+    writable_ = true;
+    if (!flushSend()) return;
+    if (state_ == STATE_CLOSING) {
+        if (chunkWriter_.empty()) shutdownSend();
+        return;
+    }
+    if (retiredReader_.isOpen() && chunkWriter_.writtenThrough(retiredMark_)) {
+        retiredReader_.close();
+    }
+    if (pushing_ && state_ == STATE_PUBLISHING) {
+        if (waitingDrain_ && chunkWriter_.pendingBytes() <= kResumePendingSendBytes) {
+            // 积压已消化，恢复读取文件
+            waitingDrain_ = false;
+            pumpFlv();
+        } else if (!tagPending_ && inputEnded() && chunkWriter_.empty()) {
+            // 输入已读完且数据全部写出
+            finish(true);
+        }
+    }
+}
+
+void RtmpClient::onReadable() {
+    // 边沿触发：必须读到 EAGAIN 为止
+    uint8_t buf[16384];
+    bool ok = true;
+    while (ok && socket_ >= 0 && state_ != STATE_FAILED) {
+        ssize_t n = recv(socket_, buf, sizeof(buf), 0);
+        ++stats_.syscalls;
+        if (n > 0) {
+            if (state_ == STATE_HANDSHAKE) {
+                recvBuf_.insert(recvBuf_.end(), buf, buf + n);
+                ok = handleHandshakeInput();
+            } else {
+                bytesReceived_ += n;
+                chunkReader_.feed(buf, n);
+                ok = handleChunkInput();
+            }
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (n == 0 && state_ == STATE_CLOSING) {
+            // 服务端在半关闭后关闭了连接，此时释放不会丢弃已发出的数据
+            completeFinish();
+            return;
+        }
+        VNSP_LOG(LOG_ERROR, "receivePacket", "Receive failed: %s", n == 0 ? "peer closed" : strerror(errno));
+        setFailed("recv");
+        return;
+    }
+    if (!ok) {
+        setFailed("input");
     }
+}
 
+bool RtmpClient::handleChunkInput() {
+    while (true) {
+        ChunkReader::ReadResult result = chunkReader_.next(inMessage_);
+        if (result == ChunkReader::READ_NEED_MORE) break;
+        if (result == ChunkReader::READ_ERROR) {
+            VNSP_LOG(LOG_ERROR, "handleChunkInput", "Malformed chunk stream from %s:%d", server_.c_str(), port_);
+            return false;
+        }
+        if (!handleMessage(inMessage_)) return false;
+    }
+    // 收满确认窗口即回 Acknowledgement，序号为已接收字节数（按 32 位回绕）
+    if (inAckWindow_ > 0 && bytesReceived_ - lastAckedBytes_ >= inAckWindow_) {
+        lastAckedBytes_ = bytesReceived_;
+        uint32_t sequence = static_cast<uint32_t>(bytesReceived_);
+        std::vector<uint8_t> payload(4);
+        payload[0] = (sequence >> 24) & 0xFF;
+        payload[1] = (sequence >> 16) & 0xFF;
+        payload[2] = (sequence >> 8) & 0xFF;
+        payload[3] = sequence & 0xFF;
+        if (!sendControl(0x03, std::move(payload))) return false;
+    }
     return true;
 }
 
-bool RtmpClient::reconnect() {
-    close();
-    VNSP_LOG(LOG_INFO, "reconnect", "Attempting to reconnect to %s:%d", server_.c_str(), port_);
-    for (int i = 0; i < 3; ++i) {
-        if (connect()) {
-            VNSP_LOG(LOG_INFO, "reconnect", "Reconnected successfully");
+bool RtmpClient::handleMessage(const RtmpMessage& msg) {
+    const std::vector<uint8_t>& p = msg.payload;
+    switch (msg.type) {
+        case 0x01: {// Set Chunk Size
+            if (p.size() < 4) return false;
+            uint32_t size = ((p[0] & 0x7F) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+            if (size == 0) return false;
+            chunkReader_.setChunkSize(size);
             return true;
         }
-        std::this_thread::sleep_for(std::chrono::seconds(2));
+        case 0x02: {// Abort Message
+            if (p.size() < 4) return false;
+            chunkReader_.abort((p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]);
+            return true;
+        }
+        case 0x03: // Acknowledgement，推流端无需处理
+            return true;
+        case 0x04: // User Control Message
+            return handleUserControl(p);
+        case 0x05: {// Window Acknowledgement Size
+            if (p.size() < 4) return false;
+            inAckWindow_ = (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+            VNSP_LOG(LOG_INFO, "handleMessage", "Server window ack size %u", inAckWindow_);
+            return true;
+        }
+        case 0x06: {// Set Peer Bandwidth
+            if (p.size() < 5) return false;
+            uint32_t window = (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+            // 与上次声明的确认窗口不同时需回 Window Acknowledgement Size
+            if (window != outAckWindow_) {
+                outAckWindow_ = window;
+                std::vector<uint8_t> payload(p.begin(), p.begin() + 4);
+                return sendControl(0x05, std::move(payload));
+            }
+            return true;
+        }
+        case 0x14: // AMF0 Command
+            return handleCommand(msg);
+        default:
+            // 其他消息（AMF3 命令、数据消息等）推流端忽略
+            return true;
     }
-    VNSP_LOG(LOG_ERROR, "reconnect", "Failed to reconnect after 3 attempts");
-    return false;
 }
 
-bool RtmpClient::handshake() {
-    // C0: 版本号
-    uint8_t c0 = 0x03; // RTMP 版本 3
-    if (!sendPacket(std::vector<uint8_t>{c0})) return false;
+bool RtmpClient::handleUserControl(const std::vector<uint8_t>& payload) {
+    if (payload.size() < 2) return false;
+    uint16_t event = (payload[0] << 8) | payload[1];
+    if (event == 0x06 && payload.size() >= 6) {
+        // PingRequest：原样回送时间戳作为 PingResponse
+        std::vector<uint8_t> response(payload.begin(), payload.begin() + 6);
+        response[1] = 0x07;
+        return sendControl(0x04, std::move(response));
+    }
+    // Stream Begin/EOF 等事件无需处理
+    return true;
+}
 
-    // C1: 时间戳 + 零填充
-    std::vector<uint8_t> c1(1536, 0);
-    uint32_t timestamp = static_cast<uint32_t>(std::chrono::system_clock::now().time_since_epoch().count() / 1000);
-    c1[0] = (timestamp >> 24) & 0xFF;
-    c1[1] = (timestamp >> 16) & 0xFF;
-    c1[2] = (timestamp >> 8) & 0xFF;
-    c1[3] = timestamp & 0xFF;
-    if (!sendPacket(c1)) return false;
-
-    // 接收 S0 + S1
-    std::vector<uint8_t> s0s1(1537);
-    if (!receivePacket(s0s1, 1537)) return false;
-    if (s0s1[0] != 0x03) {
-        VNSP_LOG(LOG_ERROR, "handshake", "Invalid S0 version: %d", s0s1[0]);
+bool RtmpClient::CommandInfo::onValue(int depth, const Amf0Item& item) {
+    if (depth == 0) {
+        int index = position++;
+        if (index == 0) {
+            if (item.type != Amf0Item::STRING) return false;
+            name = item.string;
+        } else if (index == 1) {
+            if (item.type == Amf0Item::NUMBER) transactionId = item.number;
+        } else if (item.type == Amf0Item::NUMBER && !hasNumber) {
+            hasNumber = true;
+            number = item.number;
+        }
+    } else if (depth == 1 && item.type == Amf0Item::STRING) {
+        // 信息对象（onStatus 或 connect 的 _result）中的状态字段
+        if (item.key.equals("level")) {
+            level = item.string;
+        } else if (item.key.equals("code")) {
+            code = item.string;
+        } else if (item.key.equals("description")) {
+            description = item.string;
+        }
+    }
+    return true;
+}
+
+bool RtmpClient::handleCommand(const RtmpMessage& msg) {
+    // SAX 解码：只提取需要的字段，字符串直接指向消息缓冲
+    CommandInfo info;
+    if (!Amf0Reader::parse(msg.payload.data(), msg.payload.size(), info) || info.position == 0) return false;
+    const Amf0String& name = info.name;
+    if (pipelining_) {
+        return handlePipelinedResponse(msg, info);
+    }
+
+    if (state_ == STATE_CREATESTREAM_SENT && (name.equals("_result") || name.equals("_error")) &&
+        info.transactionId != createStreamTransaction_) {
+        // releaseStream/FCPublish 的应答，部分服务端会回 _error，均不影响推流
+        return true;
+    }
+    if (name.equals("_error")) {
+        VNSP_LOG(LOG_ERROR, "handleCommand", "Server rejected command in state %d: %s", state_, info.code.str().c_str());
         return false;
     }
+    if (name.equals("_result") || name.equals("onStatus")) {
+        switch (state_) {
+            case STATE_CONNECT_SENT: return handleConnectResponse(info);
+            case STATE_CREATESTREAM_SENT: return handleCreateStreamResponse(info);
+            case STATE_PUBLISH_SENT: return handlePublishResponse(info);
+            case STATE_PUBLISHING: return handlePublishingStatus(info);
+            default: return true;
+        }
+    }
+    // onBWDone 等其他命令忽略
+    return true;
+}
 
-    // 发送 C2（回送 S1）
-    if (!sendPacket(std::vector<uint8_t>(s0s1.begin() + 1, s0s1.end()))) return false;
+void RtmpClient::setFailed(const char* reason) {
+    if (state_ == STATE_FAILED) return;
+    if (state_ == STATE_CLOSING) {
+        // 收尾阶段出错只是提前结束等待
+        completeFinish();
+        return;
+    }
+    VNSP_LOG(LOG_ERROR, "setFailed", "Session %s/%s failed at %s", app_.c_str(), stream_.c_str(), reason);
+    state_ = STATE_FAILED;
+    // 断开、超时等传输错误与流水线无关，按普通失败重连并计入重连次数
+    bool rejected = pipelining_ && serialFallback_;
+    pipelining_ = false;
+    if (rejected) {
+        // 服务端以 _error 或错误 onStatus 拒绝了流水线序列（应答处理时已置 serialFallback_）：
+        // 立即以逐条模式重连，不计入重连次数
+        VNSP_LOG(LOG_WARN, "setFailed", "Server %s:%d rejected pipelined commands, falling back to serial mode",
+                 server_.c_str(), port_);
+        if (retryTimer_ != 0) {
+            loop_->cancelTimer(retryTimer_);
+        }
+        retryTimer_ = loop_->addTimer(0, [this] {
+            retryTimer_ = 0;
+            closeSocket();
+            if (!startConnect()) {
+                if (pushing_) {
+                    scheduleRetry();
+                } else {
+                    state_ = STATE_FAILED;
+                }
+            }
+        });
+        return;
+    }
+    // 推流中的会话在当前事件处理结束后再关闭并重连，避免在回调栈中释放状态
+    if (pushing_ && retryTimer_ == 0) {
+        retryTimer_ = loop_->addTimer(0, [this] {
+            retryTimer_ = 0;
+            scheduleRetry();
+        });
+    }
+}
 
-    // 接收 S2
-    std::vector<uint8_t> s2(1536);
-    if (!receivePacket(s2, 1536)) return false;
+bool RtmpClient::runLoopUntil(const std::function<bool()>& done, int timeoutMs) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (!done()) {
+        if (state_ == STATE_FAILED) return done();
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) return false;
+        auto waitMs = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count();
+        loop_->runOnce(static_cast<int>(waitMs) + 1);
+    }
+    return true;
+}
 
+bool RtmpClient::waitForSendBuffer(size_t limit) {
+    while (chunkWriter_.pendingBytes() > limit) {
+        size_t pending = chunkWriter_.pendingBytes();
+        // 只要在超时内有进展就继续等待 EPOLLOUT
+        if (!runLoopUntil([this, pending] { return chunkWriter_.pendingBytes() < pending; }, kSendStallTimeoutMs)) {
+            VNSP_LOG(LOG_ERROR, "waitForSendBuffer", "Send stalled with %zu bytes pending", pending);
+            setFailed("send stall");
+            return false;
+        }
+        if (state_ == STATE_FAILED) return false;
+    }
     return true;
 }
 
+void RtmpClient::applySocketProfile() {
+    const SocketProfile& profile = socketProfile_;
+    uint64_t bytesPerSec = bitrate_ / 8;
+    if (profile.noDelay) {
+        int on = 1;
+        setsockopt(socket_, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    }
+    int sendBuffer = 0;
+    if (profile.sendBufferMs > 0) {
+        // 显式设置后内核不再自动调整，按码率给足一段时长即可
+        sendBuffer = static_cast<int>(std::min<uint64_t>(bytesPerSec * profile.sendBufferMs / 1000, INT32_MAX / 2));
+        sendBuffer = std::max(sendBuffer, kMinSendBuffer);
+        if (setsockopt(socket_, SOL_SOCKET, SO_SNDBUF, &sendBuffer, sizeof(sendBuffer)) != 0) {
+            VNSP_LOG(LOG_WARN, "connect", "SO_SNDBUF %d failed: %s", sendBuffer, strerror(errno));
+        }
+    }
+    int lowat = 0;
+    if (profile.notSentLowatMs > 0) {
+        // 内核里尚未发出的数据超过该值时不报告 EPOLLOUT，其余数据留在应用队列，丢帧等决策仍可作用于它们
+        lowat = static_cast<int>(std::min<uint64_t>(bytesPerSec * profile.notSentLowatMs / 1000, INT32_MAX / 2));
+        lowat = std::max(lowat, kMinNotSentLowat);
+        if (setsockopt(socket_, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &lowat, sizeof(lowat)) != 0) {
+            VNSP_LOG(LOG_WARN, "connect", "TCP_NOTSENT_LOWAT %d failed: %s", lowat, strerror(errno));
+        }
+    }
+    uint64_t pacingRate = 0;
+    if (profile.pacingPercent > 0) {
+        // 按码率的倍数限速，平滑关键帧突发；需 fq qdisc 或内核 TCP 内部 pacing
+        pacingRate = bytesPerSec * profile.pacingPercent / 100;
+        unsigned long rate = static_cast<unsigned long>(pacingRate);
+        if (setsockopt(socket_, SOL_SOCKET, SO_MAX_PACING_RATE, &rate, sizeof(rate)) != 0) {
+            VNSP_LOG(LOG_WARN, "connect", "SO_MAX_PACING_RATE %lu failed: %s", rate, strerror(errno));
+        }
+    }
+    VNSP_LOG(LOG_INFO, "connect", "Stream %s/%s socket: bitrate %" PRIu64 " bps, sndbuf %d, notsent lowat %d, pacing %" PRIu64 " B/s",
+             app_.c_str(), stream_.c_str(), bitrate_, sendBuffer, lowat, pacingRate);
+}
+
+bool RtmpClient::handshake() {
+    // C0 + C1 拼成一个缓冲一次写出
+    uint8_t c0c1[1 + kHandshakeSize];
+    c0c1[0] = 0x03; // RTMP 版本 3
+    // C1: 时间戳 + 4 字节零（复杂握手为版本号）+ 随机数据（复杂握手其中一段为摘要）
+    uint32_t timestamp = static_cast<uint32_t>(std::chrono::system_clock::now().time_since_epoch().count() / 1000);
+    c0c1[1] = (timestamp >> 24) & 0xFF;
+    c0c1[2] = (timestamp >> 16) & 0xFF;
+    c0c1[3] = (timestamp >> 8) & 0xFF;
+    c0c1[4] = timestamp & 0xFF;
+    memset(c0c1 + 5, 0, 4);
+    fillHandshakeRandom(c0c1 + 9, kHandshakeRandomSize);
+    if (complexHandshake_) {
+        RtmpHandshake::signC1(c0c1 + 1, c1Digest_);
+    }
+
+    state_ = STATE_HANDSHAKE;
+    c2Sent_ = false;
+    serverDigest_ = false;
+    chunkWriter_.appendRaw(c0c1, sizeof(c0c1));
+    return flushSend();
+}
+
+bool RtmpClient::handleHandshakeInput() {
+    // S1 到达即回送 C2，与 S2 的传输重叠
+    if (!c2Sent_) {
+        if (recvBuf_.size() < 1 + kHandshakeSize) return true;
+        if (recvBuf_[0] != 0x03) {
+            VNSP_LOG(LOG_ERROR, "handshake", "Invalid S0 version: %d", recvBuf_[0]);
+            return false;
+        }
+        uint8_t s1Digest[RtmpHandshake::kDigestSize];
+        if (complexHandshake_ && RtmpHandshake::verifyS1(recvBuf_.data() + 1, s1Digest)) {
+            // 复杂握手：C2 = 随机数据 + 以 S1 摘要派生的签名
+            uint8_t c2[kHandshakeSize];
+            fillHandshakeRandom(c2, kHandshakeSize - RtmpHandshake::kDigestSize);
+            RtmpHandshake::signC2(c2, s1Digest);
+            chunkWriter_.appendRaw(c2, sizeof(c2));
+            serverDigest_ = true;
+        } else {
+            // 简单握手（或服务端不支持复杂握手）：回送 S1
+            chunkWriter_.appendRaw(recvBuf_.data() + 1, kHandshakeSize);
+        }
+        if (!flushSend()) return false;
+        c2Sent_ = true;
+    }
+
+    // 等待 S2
+    const size_t serverHandshakeSize = 1 + 2 * kHandshakeSize;
+    if (recvBuf_.size() < serverHandshakeSize) return true;
+    if (serverDigest_ && !RtmpHandshake::verifyS2(recvBuf_.data() + 1 + kHandshakeSize, c1Digest_)) {
+        // 部分服务端的 S2 不按规范签名，实际并不影响后续交互，只记录
+        VNSP_LOG(LOG_WARN, "handshake", "S2 signature mismatch from %s:%d", server_.c_str(), port_);
+    }
+
+    // 握手之后的数据交给 chunk 解复用器
+    state_ = STATE_CONNECT_SENT;
+    if (recvBuf_.size() > serverHandshakeSize) {
+        bytesReceived_ += recvBuf_.size() - serverHandshakeSize;
+        chunkReader_.feed(recvBuf_.data() + serverHandshakeSize, recvBuf_.size() - serverHandshakeSize);
+    }
+    recvBuf_.clear();
+
+    // 发送 connect 命令，流水线模式下紧接着发出其余命令
+    if (!sendConnect()) return false;
+    if (pipelined_ && !serialFallback_ && !sendPipelinedCommands()) return false;
+    return handleChunkInput();
+}
+
 bool RtmpClient::sendConnect() {
-    std::vector<uint8_t> connectPacket = encodeAmf0Connect();
-    if (!sendPacket(connectPacket)) return false;
-
-    std::vector<uint8_t> response(4096);
-    if (!receivePacket(response, 4096)) return false;
-    Amf0Value result;
-    if (!parseAmf0Response(response, result)) return false;
-    if (result.array.size() >= 2 && result.array[0].string == "_result" && result.array[1].number == 1.0) {
-        return true;
+    if (!sendCommand(&RtmpClient::encodeConnect, 0)) return false;
+    state_ = STATE_CONNECT_SENT;
+    return true;
+}
+
+bool RtmpClient::sendCreateStream() {
+    // releaseStream/FCPublish 按 FMLE 惯例先于 createStream 发出，应答不影响流程
+    if (!sendCommand(&RtmpClient::encodeReleaseStream, 0)) return false;
+    if (!sendCommand(&RtmpClient::encodeFCPublish, 0)) return false;
+    if (!sendCommand(&RtmpClient::encodeCreateStream, 0)) return false;
+    createStreamTransaction_ = transactionId_;
+    state_ = STATE_CREATESTREAM_SENT;
+    return true;
+}
+
+bool RtmpClient::sendPublish() {
+    if (!sendCommand(&RtmpClient::encodePublish, streamId_)) return false;
+    publishTransaction_ = transactionId_;
+    state_ = STATE_PUBLISH_SENT;
+    return true;
+}
+
+bool RtmpClient::sendPipelinedCommands() {
+    // Set Chunk Size 是协议控制消息，不依赖 connect 的结果
+    size_t initial = std::max(kInitialChunkSize, roundUpPow2(largestMessageSize_));
+    if (!sendSetChunkSize(std::min(initial, maxChunkSize_))) return false;
+    // 服务端按序处理同一连接上的命令，createStream 分配的流 ID 通常是 1，
+    // 重连时沿用上次实际分配的 ID；预测错误时在 createStream 应答里纠正
+    if (!sendCreateStream() || !sendPublish()) return false;
+    pipelining_ = true;
+    return true;
+}
+
+bool RtmpClient::sendUnpublish() {
+    return sendCommand(&RtmpClient::encodeFCUnpublish, 0) && sendCommand(&RtmpClient::encodeDeleteStream, 0);
+}
+
+bool RtmpClient::handleConnectResponse(const CommandInfo& info) {
+    if (info.name.equals("_result") && info.transactionId == 1.0) {
+        // 声明较大的 Chunk 大小，已知本流的 Tag 大小时（重连）直接覆盖最大 Tag
+        size_t initial = std::max(kInitialChunkSize, roundUpPow2(largestMessageSize_));
+        if (!sendSetChunkSize(std::min(initial, maxChunkSize_))) return false;
+        // 发送 createStream 命令
+        return sendCreateStream();
     }
     VNSP_LOG(LOG_ERROR, "sendConnect", "Connect response invalid");
     return false;
 }
 
-bool RtmpClient::sendCreateStream() {
-    std::vector<uint8_t> createStreamPacket = encodeAmf0CreateStream();
-    if (!sendPacket(createStreamPacket)) return false;
-
-    std::vector<uint8_t> response(4096);
-    if (!receivePacket(response, 4096)) return false;
-    Amf0Value result;
-    if (!parseAmf0Response(response, result)) return false;
-    if (result.array.size() >= 4 && result.array[0].string == "_result" && result.array[1].number == 2.0) {
-        streamId_ = static_cast<uint32_t>(result.array[3].number);
-        return true;
+bool RtmpClient::handleCreateStreamResponse(const CommandInfo& info) {
+    if (info.name.equals("_result") && info.transactionId == createStreamTransaction_ && info.hasNumber) {
+        streamId_ = static_cast<uint32_t>(info.number);
+        // 发送 publish 命令
+        return sendPublish();
     }
     VNSP_LOG(LOG_ERROR, "sendCreateStream", "CreateStream response invalid");
     return false;
 }
 
-bool RtmpClient::sendPublish() {
-    std::vector<uint8_t> publishPacket = encodeAmf0Publish();
-    if (!sendPacket(publishPacket)) return false;
-
-    std::vector<uint8_t> response(4096);
-    if (!receivePacket(response, 4096)) return false;
-    Amf0Value result;
-    if (!parseAmf0Response(response, result)) return false;
-    if (result.array.size() >= 4 && result.array[0].string == "onStatus" && result.array[3].object.count("code")) {
-        std::string code = result.array[3].object["code"].string;
-        if (code == "NetStream.Publish.Start") {
+bool RtmpClient::handlePublishResponse(const CommandInfo& info) {
+    if (info.name.equals("onStatus") && info.code.size > 0) {
+        if (info.code.equals("NetStream.Publish.Start")) {
+            onPublishStarted();
             return true;
         }
-        VNSP_LOG(LOG_ERROR, "sendPublish", "Publish failed: %s", code.c_str());
+        VNSP_LOG(LOG_ERROR, "sendPublish", "Publish failed: %s %s", info.code.str().c_str(), info.description.str().c_str());
         return false;
     }
     VNSP_LOG(LOG_ERROR, "sendPublish", "Publish response invalid");
     return false;
 }
 
+bool RtmpClient::handlePipelinedResponse(const RtmpMessage& msg, const CommandInfo& info) {
+    bool error = info.name.equals("_error");
+    if (error || info.name.equals("_result")) {
+        if (info.transactionId == 1.0) {
+            if (error) {
+                VNSP_LOG(LOG_ERROR, "sendConnect", "Connect rejected: %s", info.code.str().c_str());
+                serialFallback_ = true;
+                return false;
+            }
+            return true;
+        }
+        if (info.transactionId == createStreamTransaction_) {
+            if (error || !info.hasNumber) {
+                VNSP_LOG(LOG_ERROR, "sendCreateStream", "CreateStream response invalid");
+                serialFallback_ = true;
+                return false;
+            }
+            uint32_t streamId = static_cast<uint32_t>(info.number);
+            if (streamId != streamId_) {
+                // publish 已发往预测的流 ID，按实际 ID 重发；该 ID 也用于之后的重连
+                VNSP_LOG(LOG_INFO, "sendPublish", "Stream %s/%s got stream id %u instead of %u, republishing",
+                         app_.c_str(), stream_.c_str(), streamId, streamId_);
+                streamId_ = streamId;
+                return sendPublish();
+            }
+            return true;
+        }
+        if (error && info.transactionId == publishTransaction_) {
+            VNSP_LOG(LOG_ERROR, "sendPublish", "Publish rejected: %s", info.code.str().c_str());
+            serialFallback_ = true;
+            return false;
+        }
+        // releaseStream/FCPublish 以及发往错误流 ID 的 publish 的应答不影响流程
+        return true;
+    }
+    if (info.name.equals("onStatus")) {
+        // 发往错误流 ID 的 publish 的状态忽略
+        if (msg.streamId != 0 && msg.streamId != streamId_) return true;
+        if (!handlePublishResponse(info)) {
+            serialFallback_ = true;
+            return false;
+        }
+        return true;
+    }
+    return true;
+}
+
+bool RtmpClient::handlePublishingStatus(const CommandInfo& info) {
+    if (info.name.equals("onStatus") && info.code.size > 0) {
+        VNSP_LOG(LOG_INFO, "handlePublishingStatus", "Stream %s/%s status: %s", app_.c_str(), stream_.c_str(), info.code.str().c_str());
+        if (info.level.equals("error")) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void RtmpClient::onPublishStarted() {
+    state_ = STATE_PUBLISHING;
+    pipelining_ = false;
+    reconnectAttempts_ = 0;
+    if (setupTimer_ != 0) {
+        loop_->cancelTimer(setupTimer_);
+        setupTimer_ = 0;
+    }
+    if (!pushing_) return;
+
+    // 实时输入与转换的输入无法回退：重连后补发缓存的元数据与序列头，视频从下一个关键帧开始。
+    // 转换输入待发的 Tag 仍在 tagPayload_ 中，保留发送
+    if (input_ != INPUT_FILE && tagsSent_) {
+        if (input_ == INPUT_LIVE) tagPending_ = false;
+        waitKeyframe_ = true;
+        if (!replayStreamHeaders(tag_.timestamp)) return;
+    }
+    // 重连后从最近发出的关键帧继续（纯音频流没有关键帧，回退到最后发出的 Tag），
+    // 先以该 Tag 的时间戳补发缓存的元数据与序列头，新的发布从第一帧起即可解码
+    if (input_ == INPUT_FILE && tagsSent_) {
+        if (!flvReader_.isOpen() && !flvReader_.open(filePath_)) {
+            finish(false);
+            return;
+        }
+        flvReader_.seek(keyframeOffset_ != 0 ? keyframeOffset_ : lastSentTagOffset_);
+        tagPending_ = false;
+        if (readNextTag() && !replayStreamHeaders(tag_.timestamp)) return;
+    }
+    // 断线期间节奏时钟仍在走：以恢复后的第一个 Tag 重建基准，回退的 GOP 与断线期间到期的 Tag
+    // 按流速率发送，不会整段判为迟到而突发写出或被丢帧预算丢弃
+    if (input_ != INPUT_LIVE && tagsSent_) firstTag_ = true;
+    waitingDrain_ = false;
+    pumpFlv();
+}
+
 bool RtmpClient::pushFlvFile(const std::string& filePath) {
-    fileOffset_ = 0;
-    baseTimestamp_ = 0;
-    startTime_ = std::chrono::steady_clock::now();
-    return readAndSendFlv(filePath);
+    resetPlaylist(std::vector<std::string>(1, filePath), false);
+    if (!openFlvFile(filePath)) return false;
+    pushing_ = true;
+    finished_ = false;
+    reconnectAttempts_ = 0;
+    if (state_ == STATE_PUBLISHING) {
+        pumpFlv();
+    } else if (!startConnect()) {
+        scheduleRetry();
+    }
+    // 阻塞接口：驱动自带的事件循环直到推送结束，节奏由定时器控制
+    while (!finished_) {
+        loop_->runOnce(-1);
+    }
+    return finishOk_;
+}
+
+void RtmpClient::finish(bool ok) {
+    if (!pushing_) return;
+    pushing_ = false;
+    finishOk_ = ok;
+    cancelTimers();
+    if (ok && state_ == STATE_PUBLISHING && sendUnpublish()) {
+        // 直接关闭会丢掉未写出的命令，接收队列中未读的应答还会使内核以 RST 关闭连接、丢弃已发出的数据：
+        // 写空后半关闭，服务端关闭连接或超时后再释放
+        state_ = STATE_CLOSING;
+        if (chunkWriter_.empty()) shutdownSend();
+        closeTimer_ = loop_->addTimer(kCloseTimeoutMs, [this] {
+            closeTimer_ = 0;
+            completeFinish();
+        });
+        return;
+    }
+    completeFinish();
+}
+
+void RtmpClient::shutdownSend() {
+    shutdown(socket_, SHUT_WR);
+    // 半关闭后套接字一直可写，只等服务端关闭
+    loop_->modifyFd(socket_, this, EPOLLIN | EPOLLRDHUP | EPOLLET);
+}
+
+void RtmpClient::completeFinish() {
+    if (closeTimer_ != 0) {
+        loop_->cancelTimer(closeTimer_);
+        closeTimer_ = 0;
+    }
+    finished_ = true;
+    closeSocket();
+    closeInput();
+    bool ok = finishOk_;
+    VNSP_LOG(ok ? LOG_INFO : LOG_ERROR, "finish", "Push %s/%s %s", app_.c_str(), stream_.c_str(), ok ? "completed" : "failed");
+    if (finishCallback_) {
+        FinishCallback callback = finishCallback_;
+        callback(this, ok);
+    }
 }
 
 void RtmpClient::close() {
+    // 独立模式下关闭前尽量把已排队的数据写完
+    if (ownedLoop_ && socket_ >= 0 && state_ == STATE_PUBLISHING) {
+        if (sendUnpublish()) {
+            waitForSendBuffer(0);
+        }
+    }
+    pushing_ = false;
+    cancelTimers();
+    closeSocket();
+    closeInput();
+}
+
+RtmpClient::PushStats RtmpClient::stats() const {
+    PushStats stats = stats_;
+    stats.syscalls += chunkWriter_.syscalls();
+    return stats;
+}
+
+void RtmpClient::closeSocket() {
+    connector_.cancel();
+    if (resolveRequest_ != 0) {
+        Resolver::instance().cancel(resolveRequest_);
+        resolveRequest_ = 0;
+    }
+    if (setupTimer_ != 0) {
+        loop_->cancelTimer(setupTimer_);
+        setupTimer_ = 0;
+    }
     if (socket_ >= 0) {
+        loop_->removeFd(socket_);
         ::close(socket_);
         socket_ = -1;
     }
+    state_ = STATE_IDLE;
+    waitingDrain_ = false;
+    chunkWriter_.reset();
+    chunkReader_.reset();
+    recvBuf_.clear();
 }
 
-bool RtmpClient::sendPacket(const std::vector<uint8_t>& packet, int retryCount) {
-    for (int i = 0; i < retryCount; ++i) {
-        size_t sent = 0;
-        while (sent < packet.size()) {
-            ssize_t n = send(socket_, packet.data() + sent, packet.size() - sent, 0);
-            if (n <= 0) {
-                if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
-                    VNSP_LOG(LOG_ERROR, "sendPacket", "Send failed: %s", strerror(errno));
-                    if (reconnect()) {
-                        return sendPacket(packet, retryCount - i - 1);
-                    }
-                    return false;
-                }
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
-                continue;
-            }
-            sent += n;
+void RtmpClient::cancelTimers() {
+    uint64_t* timers[] = {&setupTimer_, &pacingTimer_, &retryTimer_, &closeTimer_};
+    for (size_t i = 0; i < sizeof(timers) / sizeof(timers[0]); ++i) {
+        if (*timers[i] != 0) {
+            loop_->cancelTimer(*timers[i]);
+            *timers[i] = 0;
         }
-        return true;
     }
-    VNSP_LOG(LOG_ERROR, "sendPacket", "Send failed after %d retries", retryCount);
-    return false;
 }
 
-bool RtmpClient::receivePacket(std::vector<uint8_t>& buffer, size_t size, int retryCount) {
-    for (int i = 0; i < retryCount; ++i) {
-        size_t received = 0;
-        while (received < size) {
-            ssize_t n = recv(socket_, buffer.data() + received, size - received, 0);
-            if (n <= 0) {
-                if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
-                    VNSP_LOG(LOG_ERROR, "receivePacket", "Receive failed: %s", strerror(errno));
-                    if (reconnect()) {
-                        return receivePacket(buffer, size, retryCount - i - 1);
-                    }
-                    return false;
-                }
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
-                continue;
-            }
-            received += n;
-        }
-        return true;
+bool RtmpClient::sendCommand(CommandEncoder encoder, uint32_t streamId) {
+    if (socket_ < 0 || state_ == STATE_FAILED) return false;
+    ++transactionId_;
+    // 先编码到栈缓冲，再复制进发送队列复用的负载缓冲，稳态下不分配内存
+    uint8_t buffer[kCommandBufferSize];
+    Amf0Writer writer(buffer, sizeof(buffer));
+    (this->*encoder)(writer);
+    if (writer.ok()) {
+        // Message Type ID = 20 (AMF0 Command)
+        chunkWriter_.appendMessageCopy(CSID_COMMAND, 0, 0x14, streamId, writer.data(), writer.size());
+    } else {
+        // 超长的 tcUrl 或流名：按所需长度重新编码
+        std::vector<uint8_t> body(writer.size());
+        Amf0Writer large(body.data(), body.size());
+        (this->*encoder)(large);
+        chunkWriter_.appendMessage(CSID_COMMAND, 0, 0x14, streamId, std::move(body));
     }
+    return flushSend();
+}
 
-    VNSP_LOG(LOG_ERROR, "receivePacket", "Receive failed after %d retries", retryCount);
-    return false;
+bool RtmpClient::sendControl(uint8_t type, std::vector<uint8_t>&& payload) {
+    if (socket_ < 0 || state_ == STATE_FAILED) return false;
+    // 协议控制消息走 Message Stream ID = 0
+    chunkWriter_.appendMessage(CSID_CONTROL, 0, type, 0, std::move(payload));
+    return flushSend();
 }
 
-std::vector<uint8_t> RtmpClient::encodeAmf0Connect() {
-    std::vector<uint8_t> packet;
-    packet.push_back(0x03); // Chunk Stream ID = 3
-    packet.push_back(0x00); packet.push_back(0x00); packet.push_back(0x00); // Timestamp = 0
-    packet.push_back(0x00); packet.push_back(0x00); packet.push_back(0x00); // Message Length
-    packet.push_back(0x14); // Message Type ID = 20 (AMF0 Command)
-    packet.push_back(0x00); packet.push_back(0x00); packet.push_back(0x00); packet.push_back(0x00); // Message Stream ID = 0
-
-    packet.push_back(0x02); // String type
-    packet.push_back(0x00); packet.push_back(0x07); // Length = 7
-    packet.insert(packet.end(), {'c', 'o', 'n', 'n', 'e', 'c', 't'});
-    packet.push_back(0x00); // Number type
-    packet.push_back(0x3F); packet.push_back(0xF0); packet.push_back(0x00); packet.push_back(0x00);
-    packet.push_back(0x00); packet.push_back(0x00); packet.push_back(0x00); packet.push_back(0x00); // 1.0
-    packet.push_back(0x03); // Object type
-    packet.push_back(0x00); packet.push_back(0x03); // Length = 3
-    packet.insert(packet.end(), {'a', 'p', 'p'});
-    packet.push_back(0x02); // String type
-    packet.push_back(0x00); packet.push_back(app_.size());
-    packet.insert(packet.end(), app_.begin(), app_.end());
-    packet.push_back(0x00); packet.push_back(0x05); // Length = 5
-    packet.insert(packet.end(), {'t', 'c', 'U', 'r', 'l'});
-    packet.push_back(0x02); // String type
+bool RtmpClient::flushSend() {
+    // 边沿触发：写到 EAGAIN 后等待下一次 EPOLLOUT 从中断处继续
+    if (!writable_ || chunkWriter_.empty()) return true;
+    ChunkWriter::FlushResult result = chunkWriter_.flush(socket_);
+    if (result == ChunkWriter::FLUSH_BLOCKED) {
+        writable_ = false;
+    } else if (result == ChunkWriter::FLUSH_ERROR) {
+        VNSP_LOG(LOG_ERROR, "sendPacket", "Send failed: %s", strerror(errno));
+        setFailed("send");
+        return false;
+    }
+    return true;
+}
+
+void RtmpClient::encodeConnect(Amf0Writer& writer) {
     std::string tcUrl = "rtmp://" + server_ + ":" + std::to_string(port_) + "/" + app_;
-    packet.push_back(0x00); packet.push_back(tcUrl.size());
-    packet.insert(packet.end(), tcUrl.begin(), tcUrl.end());
-    packet.push_back(0x00); packet.push_back(0x00); packet.push_back(0x09); // Object end
-
-    size_t length = packet.size() - 12;
-    packet[4] = (length >> 16) & 0xFF;
-    packet[5] = (length >> 8) & 0xFF;
-    packet[6] = length & 0xFF;
-
-    return packet;
-}
-
-std::vector<uint8_t> RtmpClient::encodeAmf0CreateStream() {
-    std::vector<uint8_t> packet;
-    packet.push_back(0x03); // Chunk Stream ID = 3
-    packet.push_back(0x00); packet.push_back(0x00); packet.push_back(0x00); // Timestamp = 0
-    packet.push_back(0x00); packet.push_back(0x00); packet.push_back(0x00); // Message Length
-    packet.push_back(0x14); // Message Type ID = 20
-    packet.push_back(0x00); packet.push_back(0x00); packet.push_back(0x00); packet.push_back(0x00);
-
-    packet.push_back(0x02); // String type
-    packet.push_back(0x00); packet.push_back(0x0C); // Length = 12
-    packet.insert(packet.end(), {'c', 'r', 'e', 'a', 't', 'e', 'S', 't', 'r', 'e', 'a', 'm'});
-    packet.push_back(0x00); // Number type
-    packet.push_back(0x40); packet.push_back(0x00); packet.push_back(0x00); packet.push_back(0x00);
-    packet.push_back(0x00); packet.push_back(0x00); packet.push_back(0x00); packet.push_back(0x00); // 2.0
-    packet.push_back(0x05); // Null type
-
-    size_t length = packet.size() - 12;
-    packet[4] = (length >> 16) & 0xFF;
-    packet[5] = (length >> 8) & 0xFF;
-    packet[6] = length & 0xFF;
-
-    return packet;
-}
-
-std::vector<uint8_t> RtmpClient::encodeAmf0Publish() {
-    std::vector<uint8_t> packet;
-    packet.push_back(0x03); // Chunk Stream ID = 3
-    packet.push_back(0x00); packet.push_back(0x00); packet.push_back(0x00); // Timestamp = 0
-    packet.push_back(0x00); packet.push_back(0x00); packet.push_back(0x00); // Message Length
-    packet.push_back(0x14); // Message Type ID = 20
-    packet.push_back(0x00); packet.push_back(0x00); packet.push_back(0x00); packet.push_back(0x01); // Message Stream ID = 1
-
-    packet.push_back(0x02); // String type
-    packet.push_back(0x00); packet.push_back(0x07); // Length = 7
-    packet.insert(packet.end(), {'p', 'u', 'b', 'l', 'i', 's', 'h'});
-    packet.push_back(0x00); // Number type
-    packet.push_back(0x40); packet.push_back(0x08); packet.push_back(0x00); packet.push_back(0x00);
-    packet.push_back(0x00); packet.push_back(0x00); packet.push_back(0x00); packet.push_back(0x00); // 3.0
-    packet.push_back(0x05); // Null type
-    packet.push_back(0x02); // String type
-    packet.push_back(0x00); packet.push_back(stream_.size());
-    packet.insert(packet.end(), stream_.begin(), stream_.end());
-    packet.push_back(0x02); // String type
-    packet.push_back(0x00); packet.push_back(0x04); // Length = 4
-    packet.insert(packet.end(), {'l', 'i', 'v', 'e'});
-
-    size_t length = packet.size() - 12;
-    packet[4] = (length >> 16) & 0xFF;
-    packet[5] = (length >> 8) & 0xFF;
-    packet[6] = length & 0xFF;
-
-    return packet;
-}
-
-bool RtmpClient::parseAmf0Value(const std::vector<uint8_t>& data, size_t& pos, Amf0Value& value) {
-    if (pos >= data.size()) return false;
-    uint8_t type = data[pos++];
-
-    switch (type) {
-        case 0x00: {// Number
-            if (pos + 8 > data.size()) return false;
-            value.type = Amf0Value::NUMBER;
-            value.number = 0;
-            for (int i = 0; i < 8; ++i) {
-                value.number = (value.number << 8) | data[pos++];
-            }
-            return true;
-        }
-        case 0x01: {// Boolean
-            if (pos >= data.size()) return false;
-            value.type = Amf0Value::BOOLEAN;
-            value.boolean = data[pos++] != 0;
-            return true;
-        }
-        case 0x02: {// String
-            if (pos + 2 > data.size()) return false;
-            value.type = Amf0Value::STRING;
-            uint16_t len = (data[pos] << 8) | data[pos + 1];
-            pos += 2;
-            if (pos + len > data.size()) return false;
-            value.string = std::string(data.begin() + pos, data.begin() + pos + len);
-            pos += len;
-            return true;
-        }
-        case 0x03: {// Object
-            value.type = Amf0Value::OBJECT;
-            while (pos + 3 <= data.size()) {
-                uint16_t keyLen = (data[pos] << 8) | data[pos + 1];
-                pos += 2;
-                if (keyLen == 0 && pos + 1 <= data.size() && data[pos] == 0x09) {
-                    pos++; // Object end
-                    break;
-                }
-                if (pos + keyLen > data.size()) return false;
-                std::string key(data.begin() + pos, data.begin() + pos + keyLen);
-                pos += keyLen;
-                Amf0Value subValue;
-                if (!parseAmf0Value(data, pos, subValue)) return false;
-                value.object[key] = subValue;
-            }
-            return true;
-        }
-        case 0x05: {// Null
-            value.type = Amf0Value::NULL_TYPE;
-            return true;
-        }
-        case 0x08: {// Array
-            if (pos + 4 > data.size()) return false;
-            value.type = Amf0Value::ARRAY;
-            uint32_t arrayLen = (data[pos] << 24) | (data[pos + 1] << 16) | (data[pos + 2] << 8) | data[pos + 3];
-            pos += 4;
-            for (uint32_t i = 0; i < arrayLen; ++i) {
-                Amf0Value subValue;
-                if (!parseAmf0Value(data, pos, subValue)) return false;
-                value.array.push_back(subValue);
-            }
-            return true;
+    writer.string("connect").number(transactionId_);
+    writer.beginObject()
+        .property("app", app_)
+        .property("type", "nonprivate")
+        .property("flashVer", "FMLE/3.0 (compatible; FMSc/1.0)")
+        .property("tcUrl", tcUrl);
+    if (enhancedRtmp_) {
+        // Enhanced RTMP：声明支持的视频编码，服务端据此接受扩展视频头部
+        writer.key("fourCcList").beginStrictArray(3).string("hvc1").string("av01").string("avc1");
+    }
+    writer.endObject();
+}
+
+void RtmpClient::encodeReleaseStream(Amf0Writer& writer) {
+    writer.string("releaseStream").number(transactionId_).null().string(stream_);
+}
+
+void RtmpClient::encodeFCPublish(Amf0Writer& writer) {
+    writer.string("FCPublish").number(transactionId_).null().string(stream_);
+}
+
+void RtmpClient::encodeCreateStream(Amf0Writer& writer) {
+    writer.string("createStream").number(transactionId_).null();
+}
+
+void RtmpClient::encodePublish(Amf0Writer& writer) {
+    writer.string("publish").number(transactionId_).null().string(stream_).string("live");
+}
+
+void RtmpClient::encodeFCUnpublish(Amf0Writer& writer) {
+    writer.string("FCUnpublish").number(transactionId_).null().string(stream_);
+}
+
+void RtmpClient::encodeDeleteStream(Amf0Writer& writer) {
+    writer.string("deleteStream").number(transactionId_).null().number(streamId_);
+}
+
+void RtmpClient::setMaxChunkSize(size_t maxChunkSize) {
+    maxChunkSize_ = std::max(kDefaultChunkSize, std::min(maxChunkSize, kProtocolMaxChunkSize));
+}
+
+bool RtmpClient::sendSetChunkSize(size_t chunkSize) {
+    if (chunkSize == chunkSize_) return true;
+    // Set Chunk Size (Type 1): 4 字节，最高位必须为 0
+    std::vector<uint8_t> payload(4);
+    payload[0] = (chunkSize >> 24) & 0x7F;
+    payload[1] = (chunkSize >> 16) & 0xFF;
+    payload[2] = (chunkSize >> 8) & 0xFF;
+    payload[3] = chunkSize & 0xFF;
+    if (!sendControl(0x01, std::move(payload))) return false;
+    // 新大小对其后入队的消息生效，队列中的顺序保证服务端先收到声明
+    chunkSize_ = chunkSize;
+    chunkWriter_.setChunkSize(chunkSize);
+    VNSP_LOG(LOG_INFO, "sendSetChunkSize", "Stream %s/%s chunk size set to %zu", app_.c_str(), stream_.c_str(), chunkSize);
+    return true;
+}
+
+bool RtmpClient::adjustChunkSize(size_t messageSize) {
+    if (messageSize > largestMessageSize_) {
+        largestMessageSize_ = messageSize;
+    }
+    // 只在消息超过当前 Chunk 且仍有上调空间时调整，让大多数 Tag 以单个 Chunk 发出
+    if (messageSize <= chunkSize_ || chunkSize_ >= maxChunkSize_) return true;
+    return sendSetChunkSize(std::min(roundUpPow2(messageSize), maxChunkSize_));
+}
+
+bool RtmpClient::sendChunkedData(const uint8_t* data, size_t size, uint32_t timestamp, uint8_t type, uint32_t streamId,
+                                 int fileFd, uint64_t fileOffset) {
+    if (socket_ < 0 || state_ == STATE_FAILED) return false;
+    if (!adjustChunkSize(size)) return false;
+    // 音视频与脚本数据各用独立的 chunk stream，连续同类消息才能压缩头部
+    uint32_t csid = mediaCsid(type);
+    // 负载直接引用文件映射，分片头部与负载以 iovec 交错排列，sendmsg 从页缓存写出；
+    // Chunk 不小于消息时线上是一个头部加一段连续文件区间，大消息交给 sendfile
+    if (fileFd >= 0) {
+        chunkWriter_.appendMessage(csid, timestamp, type, streamId, data, size, fileFd, static_cast<off_t>(fileOffset));
+    } else {
+        chunkWriter_.appendMessage(csid, timestamp, type, streamId, data, size);
+    }
+    return flushSend();
+}
+
+bool RtmpClient::sendDataCopy(const uint8_t* data, size_t size, uint32_t timestamp, uint8_t type) {
+    if (socket_ < 0 || state_ == STATE_FAILED) return false;
+    if (!adjustChunkSize(size)) return false;
+    uint32_t csid = mediaCsid(type);
+    chunkWriter_.appendMessageCopy(csid, timestamp, type, streamId_, data, size);
+    return flushSend();
+}
+
+bool RtmpClient::sendDataOwned(std::vector<uint8_t>&& payload, uint32_t timestamp, uint8_t type) {
+    if (socket_ < 0 || state_ == STATE_FAILED) return false;
+    if (!adjustChunkSize(payload.size())) return false;
+    uint32_t csid = mediaCsid(type);
+    chunkWriter_.appendMessage(csid, timestamp, type, streamId_, std::move(payload));
+    return flushSend();
+}
+
+bool RtmpClient::sendScriptData(const uint8_t* data, size_t size, uint32_t timestamp, uint32_t streamId, bool copy) {
+    if (!isOnMetaData(data, size)) {
+        if (!copy) return sendChunkedData(data, size, timestamp, 0x12, streamId);
+        if (socket_ < 0 || state_ == STATE_FAILED) return false;
+        if (!adjustChunkSize(size)) return false;
+        chunkWriter_.appendMessageCopy(CSID_DATA, timestamp, 0x12, streamId, data, size);
+        return flushSend();
+    }
+    if (socket_ < 0 || state_ == STATE_FAILED) return false;
+    if (!adjustChunkSize(size + 16)) return false;
+    // 元数据加上 @setDataFrame 前缀，服务端据此缓存并下发给后加入的播放端
+    uint8_t prefix[16];
+    Amf0Writer writer(prefix, sizeof(prefix));
+    writer.string("@setDataFrame");
+    chunkWriter_.appendMessageCopy(CSID_DATA, timestamp, 0x12, streamId, writer.data(), writer.size(), data, size);
+    return flushSend();
+}
+
+bool RtmpClient::openFlvFile(const std::string& filePath) {
+    closeInput();
+    mediaSource_.reset(MediaSource::create(filePath));
+    if (mediaSource_) {
+        input_ = INPUT_MEDIA;
+    } else if (FlvStreamReader::isStreamSource(filePath)) {
+        input_ = INPUT_LIVE;
+    } else {
+        input_ = INPUT_FILE;
+    }
+    if (input_ == INPUT_MEDIA) {
+        // 转换输入：无法由时长估算码率时按默认值
+        mediaSource_->setEnhancedRtmp(enhancedRtmp_);
+        if (!mediaSource_->open(filePath)) {
+            mediaSource_.reset();
+            return false;
         }
-        default:
-            VNSP_LOG(LOG_ERROR, "parseAmf0Value", "Unsupported AMF0 type: %d", type);
+        bitrate_ = mediaSource_->bitrate() > 0 ? mediaSource_->bitrate() : kDefaultBitrate;
+        waitKeyframe_ = false;
+    } else if (input_ == INPUT_LIVE) {
+        // 实时输入：Tag 随到随发，无法估算码率时按默认值设置套接字
+        if (!liveReader_.open(filePath)) return false;
+        if (!loop_->addFd(liveReader_.fd(), &inputHandler_, EPOLLIN | EPOLLRDHUP | EPOLLET)) {
+            VNSP_LOG(LOG_ERROR, "open", "Failed to watch input %s: %s", filePath.c_str(), strerror(errno));
+            liveReader_.close();
             return false;
+        }
+        bitrate_ = kDefaultBitrate;
+        waitKeyframe_ = true;
+    } else {
+        // 整个文件只读映射，Tag 数据不再逐个读入缓冲
+        if (!flvReader_.open(filePath)) return false;
+        uint32_t durationMs = flvReader_.durationMs();
+        bitrate_ = durationMs > 0 ? flvReader_.fileSize() * 8 * 1000 / durationMs : kDefaultBitrate;
+        waitKeyframe_ = false;
     }
+    filePath_ = filePath;
+    metadata_.clear();
+    videoConfig_.clear();
+    audioConfig_.clear();
+    keyframeOffset_ = 0;
+    tagPending_ = false;
+    firstTag_ = true;
+    lastSentTagOffset_ = 0;
+    mediaEnded_ = false;
+    tagsSent_ = false;
+    return true;
+}
+
+void RtmpClient::closeInput() {
+    if (liveReader_.isOpen()) {
+        loop_->removeFd(liveReader_.fd());
+        liveReader_.close();
+    }
+    flvReader_.close();
+    mediaSource_.reset();
+    retiredReader_.close();
+    nextAsset_.reset();
+    waitingAsset_ = false;
+}
+
+bool RtmpClient::inputEnded() const {
+    // 播放列表还有下一项时当前文件读完不算结束
+    if (hasNextAsset()) return false;
+    if (input_ == INPUT_MEDIA) return mediaEnded_;
+    return input_ == INPUT_LIVE ? liveReader_.eof() : flvReader_.eof();
 }
 
-bool RtmpClient::parseAmf0Response(const std::vector<uint8_t>& response, Amf0Value& result) {
-    size_t pos = 12; // 跳过 RTMP 头部
-    result.type = Amf0Value::ARRAY;
-    while (pos < response.size()) {
-        Amf0Value value;
-        if (!parseAmf0Value(response, pos, value)) return false;
-        result.array.push_back(value);
+bool RtmpClient::readNextTag() {
+    bool ok;
+    if (input_ == INPUT_MEDIA) {
+        ok = mediaSource_ && mediaSource_->readTag(tag_, tagPayload_);
+        if (!ok) mediaEnded_ = true;
+    } else {
+        ok = input_ == INPUT_LIVE ? liveReader_.readTag(tag_) : flvReader_.readTag(tag_);
     }
+    if (!ok) return false;
+    if (playlistMode()) rewriteTimestamp();
+    tagPending_ = true;
     return true;
 }
 
-bool RtmpClient::sendChunkedData(const std::vector<uint8_t>& data, uint32_t timestamp, uint8_t type, uint32_t streamId, size_t chunkSize) {
-    size_t sent = 0;
-    bool firstChunk = true;
-    while (sent < data.size()) {
-        std::vector<uint8_t> packet;
-        size_t chunkDataSize = std::min(chunkSize, data.size() - sent);
-
-        // RTMP Chunk 头部
-        if (firstChunk) {
-            // Type 0: 完整头部
-            packet.push_back(0x00 | 0x03); // Chunk Stream ID = 3
-            packet.push_back((timestamp >> 16) & 0xFF);
-            packet.push_back((timestamp >> 8) & 0xFF);
-            packet.push_back(timestamp & 0xFF);
-            size_t length = data.size();
-            packet.push_back((length >> 16) & 0xFF);
-            packet.push_back((length >> 8) & 0xFF);
-            packet.push_back(length & 0xFF);
-            packet.push_back(type); // Message Type ID (8: Audio, 9: Video)
-            packet.push_back(streamId & 0xFF);
-            packet.push_back((streamId >> 8) & 0xFF);
-            packet.push_back((streamId >> 16) & 0xFF);
-            packet.push_back((streamId >> 24) & 0xFF);
-            firstChunk = false;
-        } else {
-            // Type 3: 续传头部
-            packet.push_back(0xC0 | 0x03); // Chunk Stream ID = 3, Type 3
-        }
+void RtmpClient::InputHandler::handleIoEvent(uint32_t /*events*/) {
+    owner->onInputReadable();
+}
 
-        // 数据
-        packet.insert(packet.end(), data.begin() + sent, data.begin() + sent + chunkDataSize);
-        sent += chunkDataSize;
+void RtmpClient::onInputReadable() {
+    if (!pushing_) return;
+    if (state_ == STATE_PUBLISHING) {
+        // 积压时不读，EPOLLOUT 消化积压后由 pumpFlv 继续读到 EAGAIN
+        if (!waitingDrain_) pumpFlv();
+        return;
+    }
+    // 首次发布前不读，数据留在管道中，发布开始后从头发送
+    if (!tagsSent_) return;
+    // 重连期间照常读走输入，编码器不会因管道写满而阻塞；
+    // 只保留元数据与序列头，发布开始后补发，视频从下一个关键帧开始
+    tagPending_ = false;
+    while (readNextTag()) {
+        tagPending_ = false;
+        rememberResumeState();
+        if (tag_.type == 0x09 && !isVideoSequenceHeader(tag_.data, tag_.size)) {
+            ++stats_.droppedFrames;
+        }
+    }
+    if (liveReader_.failed() || liveReader_.eof()) {
+        VNSP_LOG(LOG_ERROR, "input", "Input %s ended while stream %s/%s was not publishing", filePath_.c_str(),
+                 app_.c_str(), stream_.c_str());
+        finish(false);
+    }
+}
 
-        if (!sendPacket(packet)) return false;
+void RtmpClient::rememberResumeState() {
+    const uint8_t* data = tag_.data;
+    size_t size = tag_.size;
+    if (tag_.type == 0x09) {
+        if (isVideoSequenceHeader(data, size)) {
+            videoConfig_.assign(data, data + size);
+        } else if (isVideoKeyframe(data, size)) {
+            keyframeOffset_ = tag_.offset;
+        }
+    } else if (tag_.type == 0x08) {
+        if (isAudioSequenceHeader(data, size)) {
+            audioConfig_.assign(data, data + size);
+        }
+    } else if (tag_.type == 0x12 && isOnMetaData(data, size)) {
+        metadata_.assign(data, data + size);
     }
+}
+
+bool RtmpClient::replayStreamHeaders(uint32_t timestamp) {
+    if (metadata_.empty() && videoConfig_.empty() && audioConfig_.empty()) return true;
+    // 缓存可能在排队期间被新的序列头替换，复制进发送队列
+    if (!metadata_.empty() && !sendScriptData(metadata_.data(), metadata_.size(), timestamp, streamId_, true)) return false;
+    if (!videoConfig_.empty() && !sendDataCopy(videoConfig_.data(), videoConfig_.size(), timestamp, 0x09)) return false;
+    if (!audioConfig_.empty() && !sendDataCopy(audioConfig_.data(), audioConfig_.size(), timestamp, 0x08)) return false;
+    VNSP_LOG(LOG_INFO, "publish", "Stream %s/%s resumed after offset %" PRIu64 " with cached %s%s%s", app_.c_str(),
+             stream_.c_str(), tag_.offset, metadata_.empty() ? "" : "metadata ", videoConfig_.empty() ? "" : "video-config ",
+             audioConfig_.empty() ? "" : "audio-config");
     return true;
 }
 
-bool RtmpClient::readAndSendFlv(const std::string& filePath) {
-    std::ifstream file(filePath, std::ios::binary);
-    if (!file.is_open()) {
-        VNSP_LOG(LOG_ERROR, "readAndSendFlv", "Failed to open FLV file: %s", filePath.c_str());
-        return false;
+int64_t RtmpClient::sendBacklogMs() {
+    uint64_t bytes = chunkWriter_.pendingBytes();
+    // 可写时内核未发数据不超过 TCP_NOTSENT_LOWAT，只在拥塞（不可写）时才多一次 ioctl 查询
+    if (!writable_ && socket_ >= 0) {
+        int unsent = 0;
+        ++stats_.syscalls;
+        if (ioctl(socket_, SIOCOUTQNSD, &unsent) == 0 && unsent > 0) {
+            bytes += unsent;
+        }
     }
+    uint64_t bytesPerSec = std::max<uint64_t>(bitrate_ / 8, 1);
+    return static_cast<int64_t>(bytes * 1000 / bytesPerSec);
+}
 
-    // 跳到上次推流的位置
-    file.seekg(fileOffset_);
+void RtmpClient::pumpFlv() {
+    while (pushing_ && state_ == STATE_PUBLISHING) {
+        if (chunkWriter_.pendingBytes() > kMaxPendingSendBytes) {
+            // 积压过多时停止读取，EPOLLOUT 消化积压后继续
+            waitingDrain_ = true;
+            return;
+        }
+        if (!tagPending_ && !readNextTag()) {
+            // 列表中的文件出错时跳到下一项
+            bool failed = (input_ == INPUT_LIVE && liveReader_.failed()) || (input_ == INPUT_MEDIA && mediaSource_->failed());
+            if (failed && !hasNextAsset()) {
+                finish(false);
+                return;
+            }
+            // 实时输入暂无完整 Tag，等待 EPOLLIN
+            if (input_ == INPUT_LIVE && !liveReader_.eof()) return;
+            // 播放列表：换到下一个文件继续读，会话与发送节奏不中断
+            if (hasNextAsset()) {
+                if (!switchAsset()) return;
+                continue;
+            }
+            // 输入结束，待发送队列写空后结束推流；队列仍引用映射，此时不能解除映射
+            if (chunkWriter_.empty()) {
+                finish(true);
+            }
+            return;
+        }
+        // 换到下一个文件时，与正在使用的相同的序列头与元数据不再重发
+        if (playlistMode() && isRepeatedHeader()) {
+            tagPending_ = false;
+            continue;
+        }
 
-    // 跳过 FLV 头部 (9 字节)
-    if (fileOffset_ == 0) {
-        char header[9];
-        file.read(header, 9);
-        if (!file || std::string(header, 3) != "FLV") {
-            VNSP_LOG(LOG_ERROR, "readAndSendFlv", "Invalid FLV file: %s", filePath.c_str());
-            return false;
+        // 实时输入的节奏由到达决定，完整即发；文件与转换输入按时间戳节奏发送
+        int64_t lateUs = 0;
+        if (input_ != INPUT_LIVE) {
+            // 设置基准时间戳
+            if (firstTag_) {
+                baseTimestamp_ = tag_.timestamp;
+                startTime_ = std::chrono::steady_clock::now();
+                firstTag_ = false;
+            }
+
+            // 未到发送时间则按绝对时刻挂入时间轮，由事件循环与同一 tick 到期的其他会话一起唤醒；
+            // 以推流开始时间为基准计算，不会累积误差
+            auto due = startTime_ + std::chrono::milliseconds(tag_.timestamp - baseTimestamp_);
+            auto now = std::chrono::steady_clock::now();
+            if (due > now) {
+                pacingTimer_ = loop_->addTimerAt(due, [this] {
+                    pacingTimer_ = 0;
+                    pumpFlv();
+                });
+                return;
+            }
+            lateUs = std::chrono::duration_cast<std::chrono::microseconds>(now - due).count();
         }
-        fileOffset_ = 9;
-    }
 
-    // 读取第一个 PreviousTagSize
-    uint32_t prevTagSize;
-    file.read(reinterpret_cast<char*>(&prevTagSize), 4);
-    fileOffset_ += 4;
-    if (!file) return true; // 文件结束
+        // 新的发布上视频从关键帧开始，之前的帧间帧无法解码
+        if (waitKeyframe_ && tag_.type == 0x09 && !isVideoSequenceHeader(tag_.data, tag_.size)) {
+            if (!isVideoKeyframe(tag_.data, tag_.size)) {
+                ++stats_.droppedFrames;
+                tagPending_ = false;
+                continue;
+            }
+            waitKeyframe_ = false;
+        }
+        if (tag_.type == 0x09 && frameDropper_.enabled()) {
+            // 该帧到达网络时的延迟 = 已经晚发的时间 + 排在它前面的积压
+            int64_t lagMs = lateUs / 1000 + sendBacklogMs();
+            if (frameDropper_.shouldDrop(tag_.data, tag_.size, lagMs)) {
+                ++stats_.droppedFrames;
+                tagPending_ = false;
+                continue;
+            }
+        }
+        stats_.lateSumUs += lateUs;
+        stats_.lateMaxUs = std::max(stats_.lateMaxUs, lateUs);
+        ++stats_.tags;
+        stats_.payloadBytes += tag_.size;
+
+        // 发送 Tag 数据（分片），失败由 setFailed 触发重连
+        lastSentTagOffset_ = tag_.offset;
+        tagsSent_ = true;
+        tagPending_ = false;
+        rememberResumeState();
+        if (tag_.type == 0x12) {
+            // 只有文件映射在发送期间保持不变；实时输入的读缓冲与转换输入的 tagPayload_ 随后复用，须复制
+            if (!sendScriptData(tag_.data, tag_.size, tag_.timestamp, streamId_, input_ != INPUT_FILE)) return;
+        } else if (input_ == INPUT_MEDIA) {
+            // 转换时已复制进 tagPayload_，缓冲整个移交发送队列，换回队列回收的缓冲
+            if (!sendDataOwned(std::move(tagPayload_), tag_.timestamp, tag_.type)) return;
+        } else if (input_ == INPUT_LIVE) {
+            // 读缓冲随后复用，数据复制进发送队列
+            if (!sendDataCopy(tag_.data, tag_.size, tag_.timestamp, tag_.type)) return;
+        } else if (!sendChunkedData(tag_.data, tag_.size, tag_.timestamp, tag_.type, streamId_,
+                                    flvReader_.fd(), flvReader_.fileOffsetOf(tag_.data))) {
+            return;
+        }
+    }
+}
 
-    bool firstTag = true;
-    while (file) {
-        // 读取 Tag 头部 (11 字节)
-        char tagHeader[11];
-        file.read(tagHeader, 11);
-        if (!file) break;
-        fileOffset_ += 11;
+void RtmpClient::resetPlaylist(const std::vector<std::string>& playlist, bool loop) {
+    playlist_ = playlist;
+    loopPlaylist_ = loop;
+    playlistIndex_ = 0;
+    nextIndex_ = loop ? 1 % playlist.size() : 1;
+    failedAssets_ = 0;
+    nextAsset_.reset();
+    waitingAsset_ = false;
+    timelineOffset_ = 0;
+    timelineEnd_ = 0;
+    assetBaseSet_ = false;
+    for (int i = 0; i < 2; ++i) {
+        lastTimestamp_[i] = 0;
+        frameInterval_[i] = kDefaultFrameIntervalMs;
+    }
+}
 
-        uint8_t tagType = tagHeader[0];
-        uint32_t dataSize = (tagHeader[1] << 16) | (tagHeader[2] << 8) | tagHeader[3];
-        uint32_t timestamp = (tagHeader[4] << 16) | (tagHeader[5] << 8) | tagHeader[6];
-        timestamp |= (tagHeader[7] << 24); // Timestamp Extended
+void RtmpClient::startPrefetch() {
+    if (prefetching_ || nextAsset_ || !hasNextAsset()) return;
+    // 上一个预取线程已交回结果，只差退出
+    joinPrefetch();
+    pendingAsset_.reset(new PrefetchedAsset());
+    PrefetchedAsset* asset = pendingAsset_.get();
+    asset->owner = this;
+    asset->loop = loop_;
+    asset->token = lifeToken_;
+    asset->index = nextIndex_;
+    asset->path = playlist_[nextIndex_];
+    asset->enhancedRtmp = enhancedRtmp_;
+    prefetching_ = true;
 
-        // 读取 Tag 数据
-        std::vector<uint8_t> tagData(dataSize);
-        file.read(reinterpret_cast<char*>(tagData.data()), dataSize);
-        if (!file) break;
-        fileOffset_ += dataSize;
+    if (pthread_create(&prefetchThread_, NULL, OnPrefetchThread, asset) != 0) {
+        // 无法创建线程时就地打开，结果同样经 runInLoop 交回
+        VNSP_LOG(LOG_WARN, "playlist", "Failed to create prefetch thread for %s, opening inline", asset->path.c_str());
+        OnPrefetchThread(asset);
+        return;
+    }
+    prefetchJoinable_ = true;
+}
 
-        // 读取 PreviousTagSize
-        file.read(reinterpret_cast<char*>(&prevTagSize), 4);
-        if (!file) break;
-        fileOffset_ += 4;
+void RtmpClient::joinPrefetch() {
+    if (!prefetchJoinable_) return;
+    pthread_join(prefetchThread_, NULL);
+    prefetchJoinable_ = false;
+}
 
-        // 设置基准时间戳
-        if (firstTag) {
-            baseTimestamp_ = timestamp;
-            startTime_ = std::chrono::steady_clock::now();
-            firstTag = false;
+void* RtmpClient::OnPrefetchThread(void* pParam) {
+    PrefetchedAsset* asset = static_cast<PrefetchedAsset*>(pParam);
+    asset->mediaSource.reset(MediaSource::create(asset->path));
+    if (asset->mediaSource) {
+        // 转换输入在 open 中建立样本索引或解析整个文件，耗时的部分都在这里完成
+        asset->mediaSource->setEnhancedRtmp(asset->enhancedRtmp);
+        asset->ok = asset->mediaSource->open(asset->path);
+        if (asset->ok) {
+            asset->bitrate = asset->mediaSource->bitrate();
+        } else {
+            asset->mediaSource.reset();
         }
+    } else if (FlvStreamReader::isStreamSource(asset->path)) {
+        VNSP_LOG(LOG_ERROR, "playlist", "Live input %s cannot be used in a playlist", asset->path.c_str());
+    } else if (asset->flvReader.open(asset->path)) {
+        // 由时长估算码率，并把开头一段读入映射，切换后的前几秒不在循环线程上缺页
+        uint32_t durationMs = asset->flvReader.durationMs();
+        asset->bitrate = durationMs > 0 ? asset->flvReader.fileSize() * 8 * 1000 / durationMs : 0;
+        asset->flvReader.prefault(kPrefetchBytes);
+        asset->ok = true;
+    }
+    // 结果由会话的 pendingAsset_ 持有，任务只是通知：会话已析构或任务未执行就被丢弃都不会泄漏
+    RtmpClient* owner = asset->owner;
+    std::weak_ptr<int> token = asset->token;
+    asset->loop->runInLoop([owner, token] {
+        if (token.expired()) return;
+        owner->onAssetPrefetched();
+    });
+    return NULL;
+}
 
-        // 计算相对时间戳
-        uint32_t relativeTimestamp = timestamp - baseTimestamp_;
-        auto now = std::chrono::steady_clock::now();
-        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - startTime_).count();
-        if (relativeTimestamp > elapsed) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(relativeTimestamp - elapsed));
+void RtmpClient::onAssetPrefetched() {
+    std::unique_ptr<PrefetchedAsset> owned(std::move(pendingAsset_));
+    if (!owned) return;
+    PrefetchedAsset* asset = owned.get();
+    joinPrefetch();
+    prefetching_ = false;
+    if (!pushing_) return;
+    if (!asset->ok) {
+        VNSP_LOG(LOG_ERROR, "playlist", "Skipping playlist entry %zu (%s) of stream %s/%s", asset->index,
+                 asset->path.c_str(), app_.c_str(), stream_.c_str());
+        if (++failedAssets_ >= playlist_.size()) {
+            finish(false);
+            return;
         }
+        nextIndex_ = loopPlaylist_ ? (nextIndex_ + 1) % playlist_.size() : nextIndex_ + 1;
+        startPrefetch();
+    } else {
+        failedAssets_ = 0;
+        nextAsset_ = std::move(owned);
+    }
+    // 当前文件已读完时继续；列表已无后续项时由 pumpFlv 结束推流
+    if (waitingAsset_ && !prefetching_) {
+        waitingAsset_ = false;
+        if (state_ == STATE_PUBLISHING) pumpFlv();
+    }
+}
 
-        // 发送 Tag 数据（分片）
-        if (!sendChunkedData(tagData, timestamp, tagType, streamId_)) {
-            std::cerr << "Failed to send Tag data, retrying..." << std::endl;
-            if (reconnect()) {
-                file.seekg(fileOffset_ - (11 + dataSize + 4)); // 回退到当前 Tag
-                continue;
-            }
+bool RtmpClient::switchAsset() {
+    if (!nextAsset_) {
+        waitingAsset_ = true;
+        startPrefetch();
+        return false;
+    }
+    if (retiredReader_.isOpen()) {
+        // 上一次切换前的 Tag 仍在发送队列中引用其映射，写出后 onWritable 恢复
+        if (!chunkWriter_.writtenThrough(retiredMark_)) {
+            waitingDrain_ = true;
             return false;
         }
+        retiredReader_.close();
+    }
+    if (input_ == INPUT_FILE) {
+        // 发送队列可能仍引用当前文件的映射（及 sendfile 的 fd），写过切换点之前不能解除
+        retiredReader_.swap(flvReader_);
+        retiredMark_ = chunkWriter_.mark();
+    }
+    PrefetchedAsset& next = *nextAsset_;
+    flvReader_.swap(next.flvReader);
+    mediaSource_ = std::move(next.mediaSource);
+    input_ = mediaSource_ ? INPUT_MEDIA : INPUT_FILE;
+    filePath_ = next.path;
+    playlistIndex_ = next.index;
+    nextIndex_ = loopPlaylist_ ? (playlistIndex_ + 1) % playlist_.size() : playlistIndex_ + 1;
+    uint64_t bitrate = next.bitrate > 0 ? next.bitrate : kDefaultBitrate;
+    nextAsset_.reset();
+    if (bitrate != bitrate_) {
+        bitrate_ = bitrate;
+        if (socket_ >= 0) applySocketProfile();
     }
 
-    file.close();
+    // 新文件接在已读出内容之后；缓存的序列头与元数据保留，用于去重与重连补发
+    timelineOffset_ = timelineEnd_;
+    assetBaseSet_ = false;
+    if (!firstTag_) {
+        // 节奏基准移到新文件起点，时间线超过 32 位毫秒回绕后差值仍然正确
+        startTime_ += std::chrono::milliseconds(timelineOffset_ - baseTimestamp_);
+        baseTimestamp_ = timelineOffset_;
+    }
+    keyframeOffset_ = 0;
+    lastSentTagOffset_ = flvReader_.offset();
+    mediaEnded_ = false;
+    VNSP_LOG(LOG_INFO, "playlist", "Stream %s/%s switched to entry %zu (%s) at %u ms", app_.c_str(), stream_.c_str(),
+             playlistIndex_, filePath_.c_str(), timelineOffset_);
+    startPrefetch();
     return true;
-}
\ No newline at end of file
+}
+
+void RtmpClient::rewriteTimestamp() {
+    if (!assetBaseSet_) {
+        assetBaseTimestamp_ = tag_.timestamp;
+        assetBaseSet_ = true;
+    }
+    uint32_t elapsed = tag_.timestamp > assetBaseTimestamp_ ? tag_.timestamp - assetBaseTimestamp_ : 0;
+    tag_.timestamp = timelineOffset_ + elapsed;
+    if (tag_.type != 0x08 && tag_.type != 0x09) return;
+    // 音视频各自记录帧间隔，下一个文件从最后一帧再过一个间隔开始，不与本文件的最后一帧重叠
+    int track = tag_.type == 0x09 ? 1 : 0;
+    uint32_t delta = tag_.timestamp - lastTimestamp_[track];
+    if (delta > 0 && delta <= kMaxFrameIntervalMs) frameInterval_[track] = delta;
+    lastTimestamp_[track] = tag_.timestamp;
+    uint32_t end = tag_.timestamp + frameInterval_[track];
+    if (static_cast<int32_t>(end - timelineEnd_) > 0) timelineEnd_ = end;
+}
+
+bool RtmpClient::isRepeatedHeader() const {
+    const std::vector<uint8_t>* cached = nullptr;
+    if (tag_.type == 0x09 && isVideoSequenceHeader(tag_.data, tag_.size)) {
+        cached = &videoConfig_;
+    } else if (tag_.type == 0x08 && isAudioSequenceHeader(tag_.data, tag_.size)) {
+        cached = &audioConfig_;
+    } else if (tag_.type == 0x12 && isOnMetaData(tag_.data, tag_.size)) {
+        cached = &metadata_;
+    }
+    return cached != nullptr && !cached->empty() && cached->size() == tag_.size &&
+           memcmp(cached->data(), tag_.data, tag_.size) == 0;
+}
@@ -4,67 +4,344 @@
 #include <string>
 #include <vector>
 #include <cstdint>
-#include <map>
 #include <chrono>
+#include <functional>
+#include <memory>
+#include <pthread.h>
+#include "EventLoop.h"
+#include "ChunkWriter.h"
+#include "ChunkReader.h"
+#include "FlvReader.h"
+#include "FlvStreamReader.h"
+#include "MediaSource.h"
+#include "Amf0Writer.h"
+#include "Amf0Reader.h"
+#include "RtmpHandshake.h"
+#include "Resolver.h"
+#include "TcpConnector.h"
+#include "FrameDropper.h"
 #include "Vnsp_WriteLog.h"
 
-class RtmpClient {
+// RTMP 推流会话，内部是由事件循环驱动的非阻塞状态机。
+// 独立模式自带事件循环，可使用阻塞接口 connect()/pushFlvFile()；
+// 共享模式挂在外部事件循环上，只能使用异步接口 start()，且所有调用都须在该循环线程
+class RtmpClient : public IoHandler {
 public:
+    // 推流结束回调，ok 表示文件已完整推送
+    typedef std::function<void(RtmpClient* client, bool ok)> FinishCallback;
+
+    // 推流统计，跨重连累计
+    struct PushStats {
+        uint64_t tags; // 已发出的 Tag 数
+        uint64_t payloadBytes; // 已发出的 Tag 数据字节数
+        uint64_t syscalls; // 本连接的收发系统调用次数
+        int64_t lateSumUs; // Tag 实际入队时间相对应发时间的累计延迟（微秒）
+        int64_t lateMaxUs; // 最大延迟（微秒）
+        uint64_t droppedFrames; // 拥塞时丢弃的视频帧数
+        PushStats() : tags(0), payloadBytes(0), syscalls(0), lateSumUs(0), lateMaxUs(0), droppedFrames(0) {}
+    };
+
+    // 套接字参数。缓冲按流的码率换算成字节：内核只保留少量待发数据，其余留在应用的发送队列，
+    // 由 EPOLLOUT 驱动写出，拥塞时积压对应用可见。时长为 0 表示该项使用系统默认
+    struct SocketProfile {
+        bool noDelay; // TCP_NODELAY，小的音频 chunk 不等 Nagle
+        int sendBufferMs; // SO_SNDBUF 容纳的码流时长
+        int notSentLowatMs; // TCP_NOTSENT_LOWAT：内核未发出数据低于该时长的码流时才报告可写
+        int pacingPercent; // SO_MAX_PACING_RATE 为码率的百分比，0 表示不限速
+        SocketProfile() : noDelay(true), sendBufferMs(1000), notSentLowatMs(100), pacingPercent(0) {}
+    };
+
     RtmpClient(const std::string& server, int port, const std::string& app, const std::string& stream);
+    RtmpClient(EventLoop* loop, const std::string& server, int port, const std::string& app, const std::string& stream);
     ~RtmpClient();
 
-    // 初始化并连接到 RTMP 服务器
+    // 初始化并连接到 RTMP 服务器（阻塞，仅独立模式）
     bool connect();
-    // 推送 FLV 文件
+    // 推送 FLV 文件（阻塞，仅独立模式）
     bool pushFlvFile(const std::string& filePath);
+    // 异步连接并推送 FLV 文件，断线自动重连，结束时回调。filePath 为 "-"、"unix:路径"、FIFO 或套接字文件时
+    // 按实时输入处理：增量解析，Tag 到达即发送；断线期间输入照常读走，重连后视频从关键帧继续。
+    // filePath 为 MediaSource 支持的其他输入（如 H.264/HEVC、AAC 裸流）时转换后按时间戳节奏发送
+    bool start(const std::string& filePath, const FinishCallback& callback);
+    // 异步推送播放列表，按顺序推送各文件，loop 为 true 时循环播放直到 close()。整个列表在同一个 RTMP 会话上发送：
+    // 时间戳接续为单调递增，与已发出的相同的序列头与元数据不再重发；下一个文件在后台线程预先打开并建立索引，
+    // 切换时不重连、不打断发送节奏。列表项可以是 FLV 文件或 MediaSource 支持的输入，不能是实时输入；
+    // 打不开的列表项被跳过，全部失败时结束推流
+    bool start(const std::vector<std::string>& playlist, bool loop, const FinishCallback& callback);
     // 关闭连接
     void close();
+    const std::string& streamName() const { return stream_; }
+    PushStats stats() const;
+    // 设置输出 chunk 大小上限（128 ~ 0xFFFFFF），实际大小按观察到的 Tag 大小自动选取
+    void setMaxChunkSize(size_t maxChunkSize);
+    // 是否流水线发送 connect/createStream/publish（默认开启），服务端拒绝时自动退回逐条应答模式
+    void setPipelined(bool pipelined) { pipelined_ = pipelined; }
+    // 是否以 TCP Fast Open 建连（默认关闭），C0+C1 随 SYN 发出，需服务端开启 TFO
+    void setFastOpen(bool fastOpen) { fastOpen_ = fastOpen; }
+    // 是否使用复杂（digest）握手（默认开启），服务端 S1 不带摘要时按简单握手继续
+    void setComplexHandshake(bool complex) { complexHandshake_ = complex; }
+    // 是否使用 Enhanced RTMP（默认开启）：connect 声明 fourCcList，转换输入的 HEVC/AV1 以扩展视频头部发送；
+    // 关闭时 HEVC 按编码 ID 12 发送，AV1 轨道被忽略。FLV 输入的 Tag 总是原样转发
+    void setEnhancedRtmp(bool enhanced) { enhancedRtmp_ = enhanced; }
+    // 设置套接字参数，下次建连时生效
+    void setSocketProfile(const SocketProfile& profile) { socketProfile_ = profile; }
+    // 推流相对实时的延迟预算（毫秒），拥塞超出时按帧类型丢弃视频帧；0 表示不丢帧（默认）
+    void setMaxLatencyMs(int maxLatencyMs) { frameDropper_.setMaxLatencyMs(maxLatencyMs); }
+    // 套接字就绪事件回调，由 EventLoop 调用
+    void handleIoEvent(uint32_t events) override;
 
 private:
+    // 连接状态机
+    enum State {
+        STATE_IDLE,              // 未连接
+        STATE_RESOLVING,         // 解析主机名中
+        STATE_CONNECTING,        // TCP 连接中
+        STATE_HANDSHAKE,         // 已发送 C0+C1，等待 S0+S1+S2（收到 S1 即回 C2）
+        STATE_CONNECT_SENT,      // 已发送 connect，等待 _result
+        STATE_CREATESTREAM_SENT, // 已发送 createStream，等待 _result
+        STATE_PUBLISH_SENT,      // 已发送 publish，等待 onStatus
+        STATE_PUBLISHING,        // 推流中
+        STATE_CLOSING,           // 已发出释放流的命令，写空后半关闭，等待服务端关闭或超时
+        STATE_FAILED             // 连接出错
+    };
+
+    // 解析主机名并发起非阻塞 TCP 连接，后续流程由事件推进
+    bool startConnect();
+    bool connectTo(const std::vector<SocketAddress>& addresses);
+    void onConnected(int fd, int error);
+    // 按 socketProfile_ 与流码率设置已连接的套接字
+    void applySocketProfile();
+    // 关闭当前连接，推流中则按间隔重连
+    void scheduleRetry();
+    void onPublishStarted();
+    void finish(bool ok);
+    // 发送队列写空后半关闭连接
+    void shutdownSend();
+    // 释放套接字与输入，通知推流结束
+    void completeFinish();
+    void closeSocket();
+    void cancelTimers();
     // RTMP 握手
     bool handshake();
+    // 处理已收到的握手数据
+    bool handleHandshakeInput();
     // 发送 RTMP 命令
     bool sendConnect();
     bool sendCreateStream();
     bool sendPublish();
+    // 流水线模式：connect 之后不等应答，按预期流 ID 连续发出建流与 publish 命令
+    bool sendPipelinedCommands();
+    // 正常结束时通知服务端释放流
+    bool sendUnpublish();
+    // 处理握手后的 chunk 数据：组装消息、处理协议控制、按窗口回 Acknowledgement
+    bool handleChunkInput();
+    bool handleMessage(const RtmpMessage& msg);
+    bool handleUserControl(const std::vector<uint8_t>& payload);
+    bool handleCommand(const RtmpMessage& msg);
     // 发送 RTMP 数据消息
     bool sendData(const std::vector<uint8_t>& data, uint32_t timestamp, uint8_t type);
-    // 读取 FLV 文件并推送
-    bool readAndSendFlv(const std::string& filePath);
-    // 网络操作
-    bool sendPacket(const std::vector<uint8_t>& packet, int retryCount = 3);
-    bool receivePacket(std::vector<uint8_t>& buffer, size_t size, int retryCount = 3);
-    // AMF0 编码
-    std::vector<uint8_t> encodeAmf0Connect();
-    std::vector<uint8_t> encodeAmf0CreateStream();
-    std::vector<uint8_t> encodeAmf0Publish();
-    // AMF0 解析
-    struct Amf0Value {
-        enum Type { NUMBER, BOOLEAN, STRING, OBJECT, NULL_TYPE, ARRAY };
-        Type type;
-        int64_t number;
-        bool boolean;
-        std::string string;
-        std::map<std::string, Amf0Value> object;
-        std::vector<Amf0Value> array;
+    // 读取 FLV 文件并按时间戳节奏推送，实时输入随到随发
+    bool openFlvFile(const std::string& filePath);
+    void closeInput();
+    bool readNextTag();
+    void pumpFlv();
+    // 实时输入可读
+    void onInputReadable();
+    bool inputEnded() const;
+    // 记录重连恢复所需的状态：最近的序列头、元数据与关键帧位置
+    void rememberResumeState();
+    // 重连后补发缓存的元数据与序列头
+    bool replayStreamHeaders(uint32_t timestamp);
+    // 播放列表：是否按列表推送（多于一项或循环），是否还有下一个列表项
+    bool playlistMode() const { return loopPlaylist_ || playlist_.size() > 1; }
+    bool hasNextAsset() const { return nextIndex_ < playlist_.size(); }
+    void resetPlaylist(const std::vector<std::string>& playlist, bool loop);
+    // 在后台线程打开下一个列表项，完成后经 runInLoop 通知 onAssetPrefetched
+    void startPrefetch();
+    static void* OnPrefetchThread(void* pParam);
+    void onAssetPrefetched();
+    // 等待预取线程退出；析构时调用，保证线程不再访问会话与事件循环
+    void joinPrefetch();
+    // 切换到已预取的下一个列表项；尚未就绪或上一个文件的映射仍被发送队列引用时返回 false，就绪后继续 pumpFlv
+    bool switchAsset();
+    // 把当前 Tag 的时间戳换算到列表的连续时间线上
+    void rewriteTimestamp();
+    // 当前 Tag 是否为与正在使用的完全相同的序列头或元数据
+    bool isRepeatedHeader() const;
+    // 发送积压折算成的码流时长（毫秒）：应用发送队列，加上套接字不可写时内核中尚未发出的数据
+    int64_t sendBacklogMs();
+    // 网络操作：数据先进入 chunkWriter_ 发送队列，由 EPOLLOUT 驱动写出
+    // 命令编码函数，事务 ID 取 transactionId_
+    typedef void (RtmpClient::*CommandEncoder)(Amf0Writer& writer);
+    // 分配新的事务 ID，编码并发送 AMF0 命令消息
+    bool sendCommand(CommandEncoder encoder, uint32_t streamId);
+    // 发送协议控制消息
+    bool sendControl(uint8_t type, std::vector<uint8_t>&& payload);
+    bool flushSend();
+    void onReadable();
+    void onWritable();
+    void setFailed(const char* reason);
+    // 驱动自带事件循环直到 done() 为真或超时，返回 done() 的结果（仅独立模式）
+    bool runLoopUntil(const std::function<bool()>& done, int timeoutMs);
+    // 驱动事件循环直到发送队列低于 limit 字节
+    bool waitForSendBuffer(size_t limit);
+    // AMF0 命令编码
+    void encodeConnect(Amf0Writer& writer);
+    void encodeReleaseStream(Amf0Writer& writer);
+    void encodeFCPublish(Amf0Writer& writer);
+    void encodeCreateStream(Amf0Writer& writer);
+    void encodePublish(Amf0Writer& writer);
+    void encodeFCUnpublish(Amf0Writer& writer);
+    void encodeDeleteStream(Amf0Writer& writer);
+    // 命令消息中会话关心的字段，由 SAX 解码直接提取，不建树；字符串指向消息缓冲
+    struct CommandInfo : public Amf0Visitor {
+        Amf0String name; // 命令名
+        double transactionId; // 事务 ID
+        bool hasNumber; // 事务 ID 之后是否出现过数字参数
+        double number; // 事务 ID 之后的第一个数字参数（createStream 返回的流 ID）
+        Amf0String level; // 信息对象的 level
+        Amf0String code; // 信息对象的 code
+        Amf0String description; // 信息对象的 description
+        int position; // 已解码的顶层值个数
+        CommandInfo() : transactionId(0), hasNumber(false), number(0), position(0) {}
+        bool onValue(int depth, const Amf0Item& item) override;
     };
-    bool parseAmf0Response(const std::vector<uint8_t>& response, Amf0Value& result);
-    bool parseAmf0Value(const std::vector<uint8_t>& data, size_t& pos, Amf0Value& value);
+    // 处理命令响应
+    bool handleConnectResponse(const CommandInfo& info);
+    bool handleCreateStreamResponse(const CommandInfo& info);
+    bool handlePublishResponse(const CommandInfo& info);
+    bool handlePublishingStatus(const CommandInfo& info);
+    // 流水线模式下按事务 ID 匹配应答
+    bool handlePipelinedResponse(const RtmpMessage& msg, const CommandInfo& info);
     // 分片机制
-    bool sendChunkedData(const std::vector<uint8_t>& data, uint32_t timestamp, uint8_t type, uint32_t streamId, size_t chunkSize = 128);
-    // 重试连接
-    bool reconnect();
+    bool sendSetChunkSize(size_t chunkSize);
+    bool adjustChunkSize(size_t messageSize);
+    // data 需保持有效直到写出（Tag 视图由文件映射保证）；fileFd >= 0 时 data 是该文件
+    // fileOffset 处的内容，单 chunk 的大消息可经 sendfile 发送
+    bool sendChunkedData(const uint8_t* data, size_t size, uint32_t timestamp, uint8_t type, uint32_t streamId,
+                         int fileFd = -1, uint64_t fileOffset = 0);
+    // 复制数据进发送队列后发送，用于生命周期不受队列约束的数据
+    bool sendDataCopy(const uint8_t* data, size_t size, uint32_t timestamp, uint8_t type);
+    // 接管 payload 的所有权后发送，payload 换回发送队列回收的缓冲
+    bool sendDataOwned(std::vector<uint8_t>&& payload, uint32_t timestamp, uint8_t type);
+    // 发送脚本 Tag，onMetaData 加上 @setDataFrame 前缀（总是复制）；
+    // 其他脚本 Tag 在 copy 为 false 时直接引用 data，调用方须保证其在写出前有效
+    bool sendScriptData(const uint8_t* data, size_t size, uint32_t timestamp, uint32_t streamId, bool copy);
 
     std::string server_; // RTMP 服务器地址
     int port_; // 服务器端口
     std::string app_; // RTMP 应用名
     std::string stream_; // 流名称
     int socket_; // TCP 套接字
+    std::unique_ptr<EventLoop> ownedLoop_; // 独立模式下自带的事件循环
+    EventLoop* loop_; // 驱动本连接 I/O 的事件循环
+    State state_; // 连接状态
+    bool writable_; // 套接字当前是否可写（边沿触发下由 EPOLLOUT 置位）
+    ChunkWriter chunkWriter_; // 输出分片与发送队列
+    std::vector<uint8_t> recvBuf_; // 握手阶段已接收但尚未处理的数据
+    bool c2Sent_; // 本次握手是否已回送 C2
+    bool complexHandshake_; // 是否使用复杂握手
+    bool enhancedRtmp_; // 是否使用 Enhanced RTMP
+    bool serverDigest_; // 本次握手的 S1 是否带有有效摘要，是则需校验 S2
+    uint8_t c1Digest_[RtmpHandshake::kDigestSize]; // 本次 C1 的摘要
+    bool fastOpen_; // 是否以 TCP Fast Open 建连
+    TcpConnector connector_; // 多地址竞速建连
+    uint64_t resolveRequest_; // 进行中的解析请求
+    std::shared_ptr<int> lifeToken_; // 异步回调持有其 weak_ptr，会话析构后回调失效
+    SocketProfile socketProfile_; // 套接字参数
+    uint64_t bitrate_; // 流码率（bit/s），由文件大小与时长估算
+    ChunkReader chunkReader_; // 握手后的输入解复用
+    RtmpMessage inMessage_; // 复用的输入消息
+    uint64_t bytesReceived_; // 握手后累计接收字节数
+    uint64_t lastAckedBytes_; // 上次回 Acknowledgement 时的接收字节数
+    uint32_t inAckWindow_; // 服务端要求的确认窗口（Window Acknowledgement Size）
+    uint32_t outAckWindow_; // 已向服务端声明的确认窗口
     uint32_t streamId_; // 流 ID
-    uint64_t fileOffset_; // 文件偏移，用于重连恢复
+    uint32_t transactionId_; // 最近一次命令的事务 ID
+    uint32_t createStreamTransaction_; // createStream 的事务 ID
+    uint32_t publishTransaction_; // 最近一次 publish 的事务 ID
+    bool pipelined_; // 是否启用流水线命令发送
+    bool pipelining_; // 当前连接的命令是否以流水线方式发出且尚未开始推流
+    bool serialFallback_; // 服务端拒绝过流水线序列，此后改为逐条等待应答
     uint32_t baseTimestamp_; // 第一个 Tag 的时间戳
     std::chrono::steady_clock::time_point startTime_; // 推流开始时间
-    size_t chunkSize_; // Chunk 大小
+    size_t chunkSize_; // 当前输出 Chunk 大小
+    size_t maxChunkSize_; // 输出 Chunk 大小上限
+    size_t largestMessageSize_; // 本流观察到的最大媒体消息，重连后直接按它选取 Chunk 大小
+    bool pushing_; // 是否处于推流任务中（断线会重连）
+    bool finished_; // 推流任务是否已结束
+    bool finishOk_; // 推流任务结果
+    bool waitingDrain_; // 是否因发送积压暂停读取
+    FinishCallback finishCallback_; // 推流结束回调
+    std::string filePath_; // 正在推送的 FLV 文件
+    FlvReader flvReader_; // FLV 文件映射
+    bool firstTag_; // 下一个 Tag 是否为首个 Tag
+    bool tagPending_; // 是否有已读出但尚未发送的 Tag
+    FlvTag tag_; // 待发送的 Tag，数据指向文件映射
+    uint64_t lastSentTagOffset_; // 最后发出的 Tag 的偏移，用于重连恢复
+    uint64_t keyframeOffset_; // 最近发出的视频关键帧的偏移，重连后从这里继续
+    std::vector<uint8_t> metadata_; // 最近发出的 onMetaData
+    std::vector<uint8_t> videoConfig_; // 最近发出的 AVC/HEVC 序列头
+    std::vector<uint8_t> audioConfig_; // 最近发出的 AAC 序列头
+    // 实时输入的就绪事件转发给所属会话
+    struct InputHandler : public IoHandler {
+        RtmpClient* owner; // 所属会话
+        void handleIoEvent(uint32_t events) override;
+    };
+    // 输入类型
+    enum InputKind {
+        INPUT_FILE,  // FLV 文件，Tag 直接引用文件映射
+        INPUT_LIVE,  // 实时 FLV 流，增量解析
+        INPUT_MEDIA  // 其他封装或裸流，由 MediaSource 转换
+    };
+    InputKind input_; // 当前输入类型
+    // 后台预取的列表项，由预取线程打开后交回循环线程
+    struct PrefetchedAsset {
+        RtmpClient* owner; // 所属会话，token 有效时才可访问
+        EventLoop* loop; // 会话所在的事件循环，会话析构前会等待预取线程退出，线程内始终有效
+        std::weak_ptr<int> token; // 会话的 lifeToken_
+        size_t index; // 列表位置
+        std::string path; // 文件路径
+        bool enhancedRtmp; // 转换输入是否使用 Enhanced RTMP
+        FlvReader flvReader; // FLV 文件
+        std::unique_ptr<MediaSource> mediaSource; // 非 FLV 输入
+        uint64_t bitrate; // 估算的码率，0 表示未知
+        bool ok; // 是否打开成功
+        PrefetchedAsset() : owner(nullptr), loop(nullptr), index(0), enhancedRtmp(true), bitrate(0), ok(false) {}
+    };
+    std::vector<std::string> playlist_; // 播放列表，单文件推送时只有一项
+    bool loopPlaylist_; // 是否循环播放
+    size_t playlistIndex_; // 正在推送的列表项
+    size_t nextIndex_; // 下一个列表项，等于列表长度表示没有
+    size_t failedAssets_; // 连续打开失败的列表项数
+    bool prefetching_; // 是否有预取在进行
+    std::unique_ptr<PrefetchedAsset> pendingAsset_; // 预取线程正在打开的列表项，由会话持有
+    pthread_t prefetchThread_; // 预取线程
+    bool prefetchJoinable_; // 预取线程是否尚未回收
+    bool waitingAsset_; // 当前文件已读完，等待下一个列表项预取完成
+    std::unique_ptr<PrefetchedAsset> nextAsset_; // 已预取的下一个列表项
+    FlvReader retiredReader_; // 已切换走的 FLV 文件，发送队列写过 retiredMark_ 后关闭
+    uint64_t retiredMark_; // 切换时的发送队列标记
+    uint32_t timelineOffset_; // 当前文件第一个 Tag 在列表时间线上的时间戳
+    uint32_t timelineEnd_; // 已读出内容在时间线上的结束点（最后一帧再加一个帧间隔）
+    uint32_t assetBaseTimestamp_; // 当前文件第一个 Tag 的原始时间戳
+    bool assetBaseSet_; // assetBaseTimestamp_ 是否已取得
+    uint32_t lastTimestamp_[2]; // 音频、视频最近一个 Tag 在时间线上的时间戳
+    uint32_t frameInterval_[2]; // 音频、视频最近的帧间隔（毫秒）
+    FlvStreamReader liveReader_; // 实时输入的增量解析器
+    std::unique_ptr<MediaSource> mediaSource_; // 非 FLV 输入
+    std::vector<uint8_t> tagPayload_; // 非 FLV 输入的 Tag 数据，发送时整个移交发送队列
+    bool mediaEnded_; // 非 FLV 输入是否已读完
+    bool tagsSent_; // 本次推流是否已发出过 Tag
+    InputHandler inputHandler_; // 实时输入的事件处理
+    bool waitKeyframe_; // 视频是否等待关键帧才开始发送（实时输入新的发布）
+    FrameDropper frameDropper_; // 拥塞丢帧策略
+    uint64_t setupTimer_; // 连接建立超时定时器
+    uint64_t pacingTimer_; // 发送节奏定时器
+    uint64_t retryTimer_; // 重连定时器
+    uint64_t closeTimer_; // 正常结束时等待服务端关闭的定时器
+    int reconnectAttempts_; // 连续重连次数
+    PushStats stats_; // 推流统计（发送系统调用由 chunkWriter_ 计数）
 };
 
 #endif // RTMP_CLIENT_H
\ No newline at end of file
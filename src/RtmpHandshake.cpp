@@ -0,0 +1,96 @@
+#include "RtmpHandshake.h"
+#include "Sha256.h"
+#include <cstring>
+
+namespace {
+// Adobe 公开的握手密钥：前 30/36 字节为文本部分，后 32 字节为公共随机部分
+const uint8_t kGenuineFpKey[62] = {
+    'G', 'e', 'n', 'u', 'i', 'n', 'e', ' ', 'A', 'd', 'o', 'b', 'e', ' ', 'F', 'l', 'a', 's', 'h', ' ',
+    'P', 'l', 'a', 'y', 'e', 'r', ' ', '0', '0', '1',
+    0xF0, 0xEE, 0xC2, 0x4A, 0x80, 0x68, 0xBE, 0xE8, 0x2E, 0x00, 0xD0, 0xD1, 0x02, 0x9E, 0x7E, 0x57,
+    0x6E, 0xEC, 0x5D, 0x2D, 0x29, 0x80, 0x6F, 0xAB, 0x93, 0xB8, 0xE6, 0x36, 0xCF, 0xEB, 0x31, 0xAE
+};
+const uint8_t kGenuineFmsKey[68] = {
+    'G', 'e', 'n', 'u', 'i', 'n', 'e', ' ', 'A', 'd', 'o', 'b', 'e', ' ', 'F', 'l', 'a', 's', 'h', ' ',
+    'M', 'e', 'd', 'i', 'a', ' ', 'S', 'e', 'r', 'v', 'e', 'r', ' ', '0', '0', '1',
+    0xF0, 0xEE, 0xC2, 0x4A, 0x80, 0x68, 0xBE, 0xE8, 0x2E, 0x00, 0xD0, 0xD1, 0x02, 0x9E, 0x7E, 0x57,
+    0x6E, 0xEC, 0x5D, 0x2D, 0x29, 0x80, 0x6F, 0xAB, 0x93, 0xB8, 0xE6, 0x36, 0xCF, 0xEB, 0x31, 0xAE
+};
+const size_t kFpKeyTextSize = 30;
+const size_t kFmsKeyTextSize = 36;
+// C1 版本字段，非零表示使用复杂握手（与 librtmp 相同的 Flash Player 版本号）
+const uint8_t kClientVersion[4] = {0x0A, 0x00, 0x2D, 0x02};
+const size_t kSignedSize = RtmpHandshake::kPacketSize - RtmpHandshake::kDigestSize;
+
+// 固定密钥的 HMAC：内外层填充分组在首次使用时压缩一次，之后每次握手直接复用
+const HmacSha256& fpTextHmac() {
+    static const HmacSha256 hmac(kGenuineFpKey, kFpKeyTextSize);
+    return hmac;
+}
+const HmacSha256& fmsTextHmac() {
+    static const HmacSha256 hmac(kGenuineFmsKey, kFmsKeyTextSize);
+    return hmac;
+}
+const HmacSha256& fpFullHmac() {
+    static const HmacSha256 hmac(kGenuineFpKey, sizeof(kGenuineFpKey));
+    return hmac;
+}
+const HmacSha256& fmsFullHmac() {
+    static const HmacSha256 hmac(kGenuineFmsKey, sizeof(kGenuineFmsKey));
+    return hmac;
+}
+
+// 摘要位置：schema 0 由第 8~11 字节决定，位于前半部分；schema 1 由第 772~775 字节决定，位于后半部分
+size_t digestOffset(const uint8_t* packet, int schema) {
+    size_t base = schema == 0 ? 8 : 772;
+    size_t sum = packet[base] + packet[base + 1] + packet[base + 2] + packet[base + 3];
+    return sum % 728 + base + 4;
+}
+
+// 对去掉摘要的 1504 字节计算 HMAC，摘要前后两段分别输入，不复制
+void packetDigest(const HmacSha256& hmac, const uint8_t* packet, size_t offset, uint8_t digest[RtmpHandshake::kDigestSize]) {
+    hmac.compute(packet, offset, packet + offset + RtmpHandshake::kDigestSize,
+                 RtmpHandshake::kPacketSize - offset - RtmpHandshake::kDigestSize, digest);
+}
+
+// C2/S2 签名：密钥 = HMAC(完整密钥, 对方摘要)，签名 = HMAC(密钥, 前 1504 字节)
+void packetSignature(const HmacSha256& fullKey, const uint8_t* packet, const uint8_t peerDigest[RtmpHandshake::kDigestSize],
+                     uint8_t signature[RtmpHandshake::kDigestSize]) {
+    uint8_t key[RtmpHandshake::kDigestSize];
+    fullKey.compute(peerDigest, RtmpHandshake::kDigestSize, key);
+    HmacSha256 hmac(key, sizeof(key));
+    hmac.compute(packet, kSignedSize, signature);
+}
+}
+
+void RtmpHandshake::signC1(uint8_t* c1, uint8_t digest[kDigestSize]) {
+    memcpy(c1 + 4, kClientVersion, sizeof(kClientVersion));
+    size_t offset = digestOffset(c1, 0);
+    packetDigest(fpTextHmac(), c1, offset, digest);
+    memcpy(c1 + offset, digest, kDigestSize);
+}
+
+bool RtmpHandshake::verifyS1(const uint8_t* s1, uint8_t digest[kDigestSize]) {
+    // 服务端版本字段为零表示只支持简单握手
+    if (s1[4] == 0 && s1[5] == 0 && s1[6] == 0 && s1[7] == 0) return false;
+    for (int schema = 0; schema < 2; ++schema) {
+        size_t offset = digestOffset(s1, schema);
+        uint8_t expected[kDigestSize];
+        packetDigest(fmsTextHmac(), s1, offset, expected);
+        if (memcmp(expected, s1 + offset, kDigestSize) == 0) {
+            memcpy(digest, expected, kDigestSize);
+            return true;
+        }
+    }
+    return false;
+}
+
+void RtmpHandshake::signC2(uint8_t* c2, const uint8_t s1Digest[kDigestSize]) {
+    packetSignature(fpFullHmac(), c2, s1Digest, c2 + kSignedSize);
+}
+
+bool RtmpHandshake::verifyS2(const uint8_t* s2, const uint8_t c1Digest[kDigestSize]) {
+    uint8_t signature[kDigestSize];
+    packetSignature(fmsFullHmac(), s2, c1Digest, signature);
+    return memcmp(signature, s2 + kSignedSize, kDigestSize) == 0;
+}
@@ -0,0 +1,26 @@
+#ifndef RTMP_HANDSHAKE_H
+#define RTMP_HANDSHAKE_H
+
+#include <cstdint>
+#include <cstddef>
+
+// RTMP 复杂握手（Flash Player 9 起的 digest 握手）的摘要计算。
+// C1/S1 的 1536 字节中有一段 32 字节的 HMAC-SHA256 摘要，位置由包内 4 个字节决定（两种 schema）；
+// C2/S2 的最后 32 字节是以对方摘要派生的密钥计算的签名。固定密钥的 HMAC 状态进程内只计算一次
+class RtmpHandshake {
+public:
+    static const size_t kPacketSize = 1536; // C1/S1/C2/S2 长度
+    static const size_t kDigestSize = 32; // 摘要长度
+
+    // 填写 C1 的版本字段并写入客户端摘要；c1 除前 4 字节时间戳外应已填好随机数据。
+    // digest 返回写入的摘要，用于校验 S2
+    static void signC1(uint8_t* c1, uint8_t digest[kDigestSize]);
+    // 按两种 schema 查找并校验 S1 中的服务端摘要，成功时 digest 返回该摘要
+    static bool verifyS1(const uint8_t* s1, uint8_t digest[kDigestSize]);
+    // 以 S1 摘要派生的密钥签名 C2；c2 前 kPacketSize - kDigestSize 字节应已填好随机数据
+    static void signC2(uint8_t* c2, const uint8_t s1Digest[kDigestSize]);
+    // 以 C1 摘要派生的密钥校验 S2 末尾的签名
+    static bool verifyS2(const uint8_t* s2, const uint8_t c1Digest[kDigestSize]);
+};
+
+#endif // RTMP_HANDSHAKE_H
@@ -0,0 +1,142 @@
+#include "SessionManager.h"
+#include "Vnsp_WriteLog.h"
+#include <unistd.h>
+#include <algorithm>
+
+SessionManager::SessionManager(int threadCount)
+    : threadCount_(threadCount), nextWorker_(0), running_(false), activeSessions_(0), failedSessions_(0) {
+    if (threadCount_ <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threadCount_ = cpus > 0 ? static_cast<int>(cpus) : 1;
+    }
+    pthread_mutex_init(&doneMutex_, NULL);
+    pthread_cond_init(&doneCond_, NULL);
+}
+
+SessionManager::~SessionManager() {
+    stop();
+    pthread_cond_destroy(&doneCond_);
+    pthread_mutex_destroy(&doneMutex_);
+}
+
+bool SessionManager::start() {
+    if (running_) return true;
+    for (int i = 0; i < threadCount_; ++i) {
+        Worker* worker = new Worker();
+        worker->manager = this;
+        if (pthread_create(&worker->threadId, NULL, OnWorkerThread, worker) != 0) {
+            VNSP_LOG(LOG_ERROR, "SessionManager", "Failed to create event loop thread %d", i);
+            delete worker;
+            break;
+        }
+        workers_.push_back(worker);
+    }
+    running_ = !workers_.empty();
+    VNSP_LOG(LOG_INFO, "SessionManager", "Started %zu event loop threads", workers_.size());
+    return running_;
+}
+
+void* SessionManager::OnWorkerThread(void* pParam) {
+    Worker* worker = static_cast<Worker*>(pParam);
+    prctl(PR_SET_NAME, "rtmp_loop");
+    worker->loop.run();
+    return NULL;
+}
+
+void SessionManager::addSession(const PushTask& task) {
+    if (!running_) return;
+    Worker* worker = NULL;
+    {
+        AutoMutex lock(&lock_);
+        worker = workers_[nextWorker_];
+        nextWorker_ = (nextWorker_ + 1) % workers_.size();
+    }
+    ++activeSessions_;
+    worker->loop.runInLoop([this, worker, task] { startSession(worker, task); });
+}
+
+void SessionManager::startSession(Worker* worker, const PushTask& task) {
+    RtmpClient* client = new RtmpClient(&worker->loop, task.server, task.port, task.app, task.stream);
+    if (task.maxChunkSize > 0) {
+        client->setMaxChunkSize(task.maxChunkSize);
+    }
+    client->setPipelined(task.pipelined);
+    client->setFastOpen(task.fastOpen);
+    client->setComplexHandshake(task.complexHandshake);
+    client->setSocketProfile(task.socketProfile);
+    client->setMaxLatencyMs(task.maxLatencyMs);
+    client->setEnhancedRtmp(task.enhancedRtmp);
+    worker->sessions.insert(client);
+    std::vector<std::string> playlist = task.playlist.empty() ? std::vector<std::string>(1, task.filePath) : task.playlist;
+    VNSP_LOG(LOG_INFO, "SessionManager", "Starting push %s:%d/%s/%s from %s%s", task.server.c_str(), task.port,
+             task.app.c_str(), task.stream.c_str(), playlist[0].c_str(),
+             playlist.size() > 1 || task.loop ? (task.loop ? " (looping playlist)" : " (playlist)") : "");
+    if (!client->start(playlist, task.loop,
+                       [this, worker](RtmpClient* c, bool ok) { onSessionFinished(worker, c, ok); })) {
+        onSessionFinished(worker, client, false);
+    }
+}
+
+void SessionManager::onSessionFinished(Worker* worker, RtmpClient* client, bool ok) {
+    if (worker->sessions.erase(client) == 0) return;
+    addStats(worker->stats, client->stats());
+    if (!ok) {
+        ++failedSessions_;
+    }
+    releaseSession();
+    // 回调仍在会话自身的调用栈上，延后到本轮事件处理之后再释放
+    worker->loop.runInLoop([client] { delete client; });
+}
+
+void SessionManager::releaseSession() {
+    pthread_mutex_lock(&doneMutex_);
+    if (--activeSessions_ <= 0) {
+        pthread_cond_broadcast(&doneCond_);
+    }
+    pthread_mutex_unlock(&doneMutex_);
+}
+
+void SessionManager::waitAll() {
+    pthread_mutex_lock(&doneMutex_);
+    while (activeSessions_ > 0) {
+        pthread_cond_wait(&doneCond_, &doneMutex_);
+    }
+    pthread_mutex_unlock(&doneMutex_);
+}
+
+void SessionManager::stop() {
+    if (!running_) return;
+    running_ = false;
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        Worker* worker = workers_[i];
+        // 在循环线程内释放剩余会话，然后退出循环
+        worker->loop.runInLoop([worker] {
+            for (std::set<RtmpClient*>::iterator it = worker->sessions.begin(); it != worker->sessions.end(); ++it) {
+                addStats(worker->stats, (*it)->stats());
+                delete *it;
+            }
+            worker->sessions.clear();
+            worker->loop.stop();
+        });
+    }
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        pthread_join(workers_[i]->threadId, NULL);
+        addStats(totalStats_, workers_[i]->stats);
+        totalStats_.syscalls += workers_[i]->loop.syscalls();
+        delete workers_[i];
+    }
+    workers_.clear();
+    pthread_mutex_lock(&doneMutex_);
+    activeSessions_ = 0;
+    pthread_cond_broadcast(&doneCond_);
+    pthread_mutex_unlock(&doneMutex_);
+}
+
+void SessionManager::addStats(RtmpClient::PushStats& total, const RtmpClient::PushStats& stats) {
+    total.tags += stats.tags;
+    total.payloadBytes += stats.payloadBytes;
+    total.syscalls += stats.syscalls;
+    total.lateSumUs += stats.lateSumUs;
+    total.lateMaxUs = std::max(total.lateMaxUs, stats.lateMaxUs);
+    total.droppedFrames += stats.droppedFrames;
+}
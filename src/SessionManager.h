@@ -0,0 +1,86 @@
+#ifndef SESSION_MANAGER_H
+#define SESSION_MANAGER_H
+
+#include <string>
+#include <vector>
+#include <set>
+#include <atomic>
+#include <pthread.h>
+#include "EventLoop.h"
+#include "AutoLock.h"
+#include "RtmpClient.h"
+
+// 单路推流任务
+struct PushTask {
+    std::string server; // RTMP 服务器地址
+    int port; // 服务器端口
+    std::string app; // RTMP 应用名
+    std::string stream; // 流名称
+    std::string filePath; // 推送的 FLV 文件
+    std::vector<std::string> playlist; // 播放列表，非空时代替 filePath，依次在同一个会话上推送
+    bool loop; // 是否循环播放，开启后推流不会结束
+    size_t maxChunkSize; // 输出 Chunk 大小上限，0 表示默认
+    bool pipelined; // 是否流水线发送建流命令
+    bool fastOpen; // 是否以 TCP Fast Open 建连
+    bool complexHandshake; // 是否使用复杂（digest）握手
+    RtmpClient::SocketProfile socketProfile; // 套接字参数
+    int maxLatencyMs; // 延迟预算，拥塞超出时丢弃视频帧，0 表示不丢帧
+    bool enhancedRtmp; // 是否使用 Enhanced RTMP 扩展视频头部发送 HEVC/AV1
+    PushTask()
+        : port(1935), loop(false), maxChunkSize(0), pipelined(true), fastOpen(false), complexHandshake(true),
+          maxLatencyMs(0), enhancedRtmp(true) {}
+};
+
+// 推流会话管理：固定数量的事件循环线程承载任意数量的推流会话，
+// 每个会话只是挂在某个循环上的非阻塞状态机，不独占线程
+class SessionManager {
+public:
+    // threadCount 为事件循环线程数，<= 0 时按 CPU 核数
+    explicit SessionManager(int threadCount);
+    ~SessionManager();
+
+    // 启动事件循环线程
+    bool start();
+    // 添加推流会话，按轮询分配到事件循环线程；可在任意线程调用
+    void addSession(const PushTask& task);
+    // 阻塞直到所有会话结束
+    void waitAll();
+    // 关闭所有会话并停止线程
+    void stop();
+
+    int activeSessions() const { return activeSessions_; }
+    int failedSessions() const { return failedSessions_; }
+    // 所有会话的累计统计，syscalls 含事件循环自身的系统调用；stop() 之后读取
+    const RtmpClient::PushStats& totalStats() const { return totalStats_; }
+
+private:
+    // 一个事件循环线程及其上的会话
+    struct Worker {
+        SessionManager* manager; // 所属管理器
+        EventLoop loop; // 事件循环
+        pthread_t threadId; // 线程 ID
+        std::set<RtmpClient*> sessions; // 挂在本循环上的会话，仅在循环线程访问
+        RtmpClient::PushStats stats; // 已结束会话的累计统计，仅在循环线程访问
+    };
+
+    static void* OnWorkerThread(void* pParam);
+    // 在循环线程中创建并启动会话
+    void startSession(Worker* worker, const PushTask& task);
+    void onSessionFinished(Worker* worker, RtmpClient* client, bool ok);
+    // 活跃会话数减一，归零时唤醒 waitAll
+    void releaseSession();
+    static void addStats(RtmpClient::PushStats& total, const RtmpClient::PushStats& stats);
+
+    int threadCount_; // 事件循环线程数
+    std::vector<Worker*> workers_; // 事件循环线程
+    size_t nextWorker_; // 轮询分配位置
+    LockMutex lock_; // 保护 nextWorker_
+    bool running_; // 线程是否已启动
+    std::atomic<int> activeSessions_; // 未结束的会话数
+    std::atomic<int> failedSessions_; // 失败结束的会话数
+    pthread_mutex_t doneMutex_; // 与 doneCond_ 配合，保护活跃会话数归零的判断
+    pthread_cond_t doneCond_; // 活跃会话数归零时广播
+    RtmpClient::PushStats totalStats_; // stop() 时汇总的统计
+};
+
+#endif // SESSION_MANAGER_H
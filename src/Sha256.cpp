@@ -0,0 +1,246 @@
+#include "Sha256.h"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define SHA256_HAVE_SHANI 1
+#endif
+
+namespace {
+const uint32_t kInitState[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+const uint32_t kRoundConstants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+typedef void (*CompressFunc)(uint32_t state[8], const uint8_t* data, size_t blocks);
+
+inline uint32_t rotr(uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+inline uint32_t loadBe32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+// 可移植实现，消息调度用 16 个字的环形缓冲
+void compressPortable(uint32_t state[8], const uint8_t* data, size_t blocks) {
+    while (blocks-- > 0) {
+        uint32_t w[16];
+        for (int i = 0; i < 16; ++i) {
+            w[i] = loadBe32(data + i * 4);
+        }
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 64; ++i) {
+            if (i >= 16) {
+                uint32_t w15 = w[(i - 15) & 15];
+                uint32_t w2 = w[(i - 2) & 15];
+                uint32_t s0 = rotr(w15, 7) ^ rotr(w15, 18) ^ (w15 >> 3);
+                uint32_t s1 = rotr(w2, 17) ^ rotr(w2, 19) ^ (w2 >> 10);
+                w[i & 15] += s0 + w[(i - 7) & 15] + s1;
+            }
+            uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) +
+                          kRoundConstants[i] + w[i & 15];
+            uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+        data += Sha256::kBlockSize;
+    }
+}
+
+#ifdef SHA256_HAVE_SHANI
+// SHA-NI 实现：状态按 sha256rnds2 要求排成 ABEF/CDGH 两个寄存器，每次迭代处理 4 轮
+__attribute__((target("sha,sse4.1")))
+void compressShaNi(uint32_t state[8], const uint8_t* data, size_t blocks) {
+    const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    __m128i tmp = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[0]));
+    __m128i state1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[4]));
+    tmp = _mm_shuffle_epi32(tmp, 0xB1); // CDAB
+    state1 = _mm_shuffle_epi32(state1, 0x1B); // EFGH
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8); // ABEF
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0); // CDGH
+
+    while (blocks-- > 0) {
+        __m128i abefSave = state0;
+        __m128i cdghSave = state1;
+        __m128i msg[4];
+        for (int i = 0; i < 4; ++i) {
+            msg[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i * 16)), byteSwap);
+        }
+        for (int i = 0; i < 16; ++i) {
+            __m128i k = _mm_add_epi32(msg[i & 3], _mm_loadu_si128(reinterpret_cast<const __m128i*>(&kRoundConstants[i * 4])));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, k);
+            if (i < 12) {
+                // W[t..t+3] = σ1(W[t-2]) + W[t-7] + σ0(W[t-15]) + W[t-16]，覆盖 4 组之前已用完的消息字
+                __m128i next = _mm_sha256msg1_epu32(msg[i & 3], msg[(i + 1) & 3]);
+                next = _mm_add_epi32(next, _mm_alignr_epi8(msg[(i + 3) & 3], msg[(i + 2) & 3], 4));
+                msg[i & 3] = _mm_sha256msg2_epu32(next, msg[(i + 3) & 3]);
+            }
+            k = _mm_shuffle_epi32(k, 0x0E);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, k);
+        }
+        state0 = _mm_add_epi32(state0, abefSave);
+        state1 = _mm_add_epi32(state1, cdghSave);
+        data += Sha256::kBlockSize;
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B); // FEBA
+    state1 = _mm_shuffle_epi32(state1, 0xB1); // DCHG
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0); // DCBA
+    state1 = _mm_alignr_epi8(state1, tmp, 8); // HGFE
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), state0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[4]), state1);
+}
+
+bool cpuHasShaNi() {
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+    bool sse41 = (ecx & bit_SSE4_1) != 0;
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) return false;
+    return sse41 && (ebx & bit_SHA) != 0;
+}
+#endif
+
+CompressFunc selectCompress() {
+#ifdef SHA256_HAVE_SHANI
+    if (cpuHasShaNi()) return compressShaNi;
+#endif
+    return compressPortable;
+}
+
+bool g_forcePortable = false; // 见 Sha256::forcePortable
+
+// 进程内只检测一次 CPU 特性
+CompressFunc compressFunc() {
+    static const CompressFunc func = selectCompress();
+    return g_forcePortable ? compressPortable : func;
+}
+}
+
+Sha256::Sha256() : bufferSize_(0), totalSize_(0) {
+    memcpy(state_, kInitState, sizeof(state_));
+}
+
+void Sha256::update(const uint8_t* data, size_t size) {
+    totalSize_ += size;
+    if (bufferSize_ > 0) {
+        size_t take = kBlockSize - bufferSize_;
+        if (take > size) take = size;
+        memcpy(buffer_ + bufferSize_, data, take);
+        bufferSize_ += take;
+        data += take;
+        size -= take;
+        if (bufferSize_ < kBlockSize) return;
+        compressFunc()(state_, buffer_, 1);
+        bufferSize_ = 0;
+    }
+    // 完整分组直接从输入压缩，不经过 buffer_
+    size_t blocks = size / kBlockSize;
+    if (blocks > 0) {
+        compressFunc()(state_, data, blocks);
+        data += blocks * kBlockSize;
+        size -= blocks * kBlockSize;
+    }
+    if (size > 0) {
+        memcpy(buffer_, data, size);
+        bufferSize_ = size;
+    }
+}
+
+void Sha256::final(uint8_t digest[kDigestSize]) {
+    uint64_t bits = totalSize_ * 8;
+    // 填充：0x80，补零到 56 字节，再写 64 位大端长度
+    buffer_[bufferSize_++] = 0x80;
+    if (bufferSize_ > kBlockSize - 8) {
+        memset(buffer_ + bufferSize_, 0, kBlockSize - bufferSize_);
+        compressFunc()(state_, buffer_, 1);
+        bufferSize_ = 0;
+    }
+    memset(buffer_ + bufferSize_, 0, kBlockSize - 8 - bufferSize_);
+    for (int i = 0; i < 8; ++i) {
+        buffer_[kBlockSize - 1 - i] = static_cast<uint8_t>(bits >> (i * 8));
+    }
+    compressFunc()(state_, buffer_, 1);
+    bufferSize_ = 0;
+    for (int i = 0; i < 8; ++i) {
+        digest[i * 4] = state_[i] >> 24;
+        digest[i * 4 + 1] = (state_[i] >> 16) & 0xFF;
+        digest[i * 4 + 2] = (state_[i] >> 8) & 0xFF;
+        digest[i * 4 + 3] = state_[i] & 0xFF;
+    }
+}
+
+void Sha256::hash(const uint8_t* data, size_t size, uint8_t digest[kDigestSize]) {
+    Sha256 sha;
+    sha.update(data, size);
+    sha.final(digest);
+}
+
+bool Sha256::hardwareAccelerated() {
+    return compressFunc() != compressPortable;
+}
+
+void Sha256::forcePortable(bool portable) {
+    g_forcePortable = portable;
+}
+
+HmacSha256::HmacSha256(const uint8_t* key, size_t keySize) {
+    // 超过分组长度的密钥先哈希
+    uint8_t block[Sha256::kBlockSize];
+    memset(block, 0, sizeof(block));
+    if (keySize > Sha256::kBlockSize) {
+        Sha256::hash(key, keySize, block);
+    } else {
+        memcpy(block, key, keySize);
+    }
+    uint8_t pad[Sha256::kBlockSize];
+    for (size_t i = 0; i < sizeof(pad); ++i) pad[i] = block[i] ^ 0x36;
+    inner_.update(pad, sizeof(pad));
+    for (size_t i = 0; i < sizeof(pad); ++i) pad[i] = block[i] ^ 0x5c;
+    outer_.update(pad, sizeof(pad));
+}
+
+void HmacSha256::compute(const uint8_t* data, size_t size, uint8_t mac[Sha256::kDigestSize]) const {
+    compute(data, size, nullptr, 0, mac);
+}
+
+void HmacSha256::compute(const uint8_t* head, size_t headSize, const uint8_t* tail, size_t tailSize,
+                         uint8_t mac[Sha256::kDigestSize]) const {
+    // 从预先吸收了填充分组的状态复制出来继续计算
+    Sha256 inner = inner_;
+    inner.update(head, headSize);
+    if (tailSize > 0) inner.update(tail, tailSize);
+    uint8_t innerDigest[Sha256::kDigestSize];
+    inner.final(innerDigest);
+    Sha256 outer = outer_;
+    outer.update(innerDigest, sizeof(innerDigest));
+    outer.final(mac);
+}
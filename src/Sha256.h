@@ -0,0 +1,48 @@
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <cstdint>
+#include <cstddef>
+
+// SHA-256。压缩函数在首次使用时选定：x86 上 CPU 支持 SHA 扩展时用 SHA-NI 指令，否则用可移植实现
+class Sha256 {
+public:
+    static const size_t kDigestSize = 32;
+    static const size_t kBlockSize = 64;
+
+    Sha256();
+
+    void update(const uint8_t* data, size_t size);
+    // 输出摘要，之后对象不可再 update
+    void final(uint8_t digest[kDigestSize]);
+
+    static void hash(const uint8_t* data, size_t size, uint8_t digest[kDigestSize]);
+    // 当前进程是否使用 SHA-NI 压缩函数
+    static bool hardwareAccelerated();
+    // 强制使用可移植压缩函数，供测试在有 SHA-NI 的机器上覆盖两条路径；非线程安全
+    static void forcePortable(bool portable);
+
+private:
+    uint32_t state_[8]; // 中间哈希值
+    uint8_t buffer_[kBlockSize]; // 不足一个分组的输入
+    size_t bufferSize_; // buffer_ 中的字节数
+    uint64_t totalSize_; // 已输入的总字节数
+};
+
+// HMAC-SHA256。构造时把 (K ^ ipad)、(K ^ opad) 两个分组压缩成内外层初始状态，
+// 之后每次计算只需处理消息本身与外层的一个分组；固定密钥构造一次即可反复使用，可多线程共享
+class HmacSha256 {
+public:
+    HmacSha256(const uint8_t* key, size_t keySize);
+
+    void compute(const uint8_t* data, size_t size, uint8_t mac[Sha256::kDigestSize]) const;
+    // 消息由两段拼接而成（如去掉中间 digest 的 RTMP 握手包），无需先复制到连续缓冲
+    void compute(const uint8_t* head, size_t headSize, const uint8_t* tail, size_t tailSize,
+                 uint8_t mac[Sha256::kDigestSize]) const;
+
+private:
+    Sha256 inner_; // 已吸收 K ^ ipad 的状态
+    Sha256 outer_; // 已吸收 K ^ opad 的状态
+};
+
+#endif // SHA256_H
@@ -0,0 +1,183 @@
+#include "TcpConnector.h"
+#include "Vnsp_WriteLog.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+#ifndef TCP_FASTOPEN_CONNECT
+#define TCP_FASTOPEN_CONNECT 30 // Linux 4.11
+#endif
+
+namespace {
+const int kAttemptDelayMs = 250; // RFC 8305 建议的竞速间隔
+}
+
+TcpConnector::TcpConnector(EventLoop* loop)
+    : loop_(loop), nextAddress_(0), fastOpen_(false), lifeToken_(new int(0)), delayTimer_(0), lastError_(0) {}
+
+TcpConnector::~TcpConnector() {
+    cancel();
+    // 延后释放的任务可能不会再执行（独立模式的事件循环随会话一起析构）
+    freeRetired();
+}
+
+void TcpConnector::start(const std::vector<SocketAddress>& addresses, int port, bool fastOpen,
+                         const ConnectCallback& callback) {
+    cancel();
+    // 以第一个地址（getaddrinfo 已按 RFC 6724 排好）的协议族开头，两个协议族交替
+    std::vector<SocketAddress> first, second;
+    for (size_t i = 0; i < addresses.size(); ++i) {
+        (addresses[i].family() == addresses[0].family() ? first : second).push_back(addresses[i]);
+    }
+    addresses_.clear();
+    for (size_t i = 0; i < first.size() || i < second.size(); ++i) {
+        if (i < first.size()) addresses_.push_back(first[i]);
+        if (i < second.size()) addresses_.push_back(second[i]);
+    }
+    for (size_t i = 0; i < addresses_.size(); ++i) {
+        addresses_[i].setPort(port);
+    }
+    nextAddress_ = 0;
+    fastOpen_ = fastOpen;
+    lastError_ = EHOSTUNREACH;
+    callback_ = callback;
+    startNextAttempt();
+}
+
+void TcpConnector::cancel() {
+    if (delayTimer_ != 0) {
+        loop_->cancelTimer(delayTimer_);
+        delayTimer_ = 0;
+    }
+    for (size_t i = 0; i < attempts_.size(); ++i) {
+        releaseAttempt(attempts_[i]);
+    }
+    attempts_.clear();
+}
+
+void TcpConnector::startNextAttempt() {
+    while (nextAddress_ < addresses_.size()) {
+        const SocketAddress& address = addresses_[nextAddress_++];
+        int fd = socket(address.family(), SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            lastError_ = errno;
+            VNSP_LOG(LOG_ERROR, "connect", "Failed to create socket: %s", strerror(errno));
+            continue;
+        }
+        if (fastOpen_) {
+            int on = 1;
+            if (setsockopt(fd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, &on, sizeof(on)) != 0) {
+                VNSP_LOG(LOG_WARN, "connect", "TCP Fast Open unavailable: %s", strerror(errno));
+            }
+        }
+        if (::connect(fd, address.get(), address.length) == 0) {
+            // TCP Fast Open 把连接延迟到首次写入，connect 直接成功
+            cancel();
+            ConnectCallback callback = callback_;
+            callback(fd, 0);
+            return;
+        }
+        if (errno != EINPROGRESS) {
+            lastError_ = errno;
+            VNSP_LOG(LOG_ERROR, "connect", "Failed to connect to %s: %s", address.toString().c_str(), strerror(errno));
+            ::close(fd);
+            continue;
+        }
+        Attempt* attempt = new Attempt();
+        attempt->owner = this;
+        attempt->fd = fd;
+        attempt->address = address;
+        if (!loop_->addFd(fd, attempt, EPOLLOUT | EPOLLET)) {
+            lastError_ = errno;
+            ::close(fd);
+            delete attempt;
+            continue;
+        }
+        attempts_.push_back(attempt);
+        // 在该尝试完成前到时就并行发起下一个
+        if (nextAddress_ < addresses_.size()) {
+            delayTimer_ = loop_->addTimer(kAttemptDelayMs, [this] {
+                delayTimer_ = 0;
+                startNextAttempt();
+            });
+        }
+        return;
+    }
+    if (attempts_.empty()) {
+        fail();
+    }
+}
+
+void TcpConnector::Attempt::handleIoEvent(uint32_t events) {
+    if (fd < 0) return;
+    int err = 0;
+    socklen_t len = sizeof(err);
+    getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len);
+    if (err == 0 && (events & (EPOLLERR | EPOLLHUP))) {
+        err = ECONNREFUSED;
+    }
+    if (err == 0 && !(events & EPOLLOUT)) return;
+    owner->onAttemptDone(this, err);
+}
+
+void TcpConnector::onAttemptDone(Attempt* attempt, int error) {
+    if (error == 0) {
+        // 胜出：套接字移交调用方，其余尝试全部关闭
+        int fd = attempt->fd;
+        loop_->removeFd(fd);
+        attempt->fd = -1;
+        cancel();
+        ConnectCallback callback = callback_;
+        callback(fd, 0);
+        return;
+    }
+    lastError_ = error;
+    VNSP_LOG(LOG_ERROR, "connect", "Failed to connect to %s: %s", attempt->address.toString().c_str(), strerror(error));
+    for (size_t i = 0; i < attempts_.size(); ++i) {
+        if (attempts_[i] == attempt) {
+            attempts_.erase(attempts_.begin() + i);
+            break;
+        }
+    }
+    releaseAttempt(attempt);
+    // 失败后不必等竞速间隔，立即尝试下一个地址
+    if (delayTimer_ != 0) {
+        loop_->cancelTimer(delayTimer_);
+        delayTimer_ = 0;
+    }
+    startNextAttempt();
+}
+
+void TcpConnector::releaseAttempt(Attempt* attempt) {
+    if (attempt->fd >= 0) {
+        loop_->removeFd(attempt->fd);
+        ::close(attempt->fd);
+        attempt->fd = -1;
+    }
+    retired_.push_back(attempt);
+    if (retired_.size() == 1) {
+        std::weak_ptr<int> token = lifeToken_;
+        loop_->runInLoop([this, token] {
+            if (token.expired()) return;
+            freeRetired();
+        });
+    }
+}
+
+void TcpConnector::freeRetired() {
+    for (size_t i = 0; i < retired_.size(); ++i) {
+        delete retired_[i];
+    }
+    retired_.clear();
+}
+
+void TcpConnector::fail() {
+    cancel();
+    ConnectCallback callback = callback_;
+    if (callback) {
+        callback(-1, lastError_);
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef TCP_CONNECTOR_H
+#define TCP_CONNECTOR_H
+
+#include <vector>
+#include <functional>
+#include <memory>
+#include "EventLoop.h"
+#include "Resolver.h"
+
+// 非阻塞 TCP 建连，按 Happy Eyeballs（RFC 8305）在多个地址间竞速：
+// 地址按 IPv6/IPv4 交替排列，前一个尝试 kAttemptDelayMs 内未完成就并行发起下一个，
+// 最先连上的胜出，其余尝试关闭。所有调用都须在 loop 线程
+class TcpConnector {
+public:
+    // 建连结果：fd >= 0 为已连接的非阻塞套接字（已从事件循环注销，归调用方所有），
+    // fd < 0 表示全部地址失败，error 为最后一个错误码
+    typedef std::function<void(int fd, int error)> ConnectCallback;
+
+    explicit TcpConnector(EventLoop* loop);
+    // 须在事件分发之外析构（与持有它的会话相同），尚未释放的尝试在此直接释放
+    ~TcpConnector();
+
+    // 发起建连，进行中的上一次建连会被取消。fastOpen 时套接字设置 TCP_FASTOPEN_CONNECT，
+    // connect 立即成功，真正的 SYN 随首次写入发出，因此不竞速，直接使用第一个地址
+    void start(const std::vector<SocketAddress>& addresses, int port, bool fastOpen, const ConnectCallback& callback);
+    // 取消进行中的建连，不回调
+    void cancel();
+    bool active() const { return !attempts_.empty() || delayTimer_ != 0; }
+
+private:
+    // 一个地址上的连接尝试
+    struct Attempt : public IoHandler {
+        TcpConnector* owner; // 所属建连
+        int fd; // 套接字，关闭后为 -1
+        SocketAddress address; // 目标地址
+        void handleIoEvent(uint32_t events) override;
+    };
+
+    // 向下一个地址发起尝试并安排下一次竞速，没有可用地址且无进行中的尝试时回调失败
+    void startNextAttempt();
+    void onAttemptDone(Attempt* attempt, int error);
+    // 关闭尝试的套接字；对象延后到本轮事件处理之后释放，同批就绪事件仍可能指向它
+    void releaseAttempt(Attempt* attempt);
+    void freeRetired();
+    void fail();
+
+    EventLoop* loop_; // 所在事件循环
+    std::vector<SocketAddress> addresses_; // 按竞速顺序排列的地址
+    size_t nextAddress_; // 下一个尝试的地址
+    bool fastOpen_; // 是否使用 TCP Fast Open
+    std::vector<Attempt*> attempts_; // 进行中的尝试
+    std::vector<Attempt*> retired_; // 已关闭、等待释放的尝试
+    std::shared_ptr<int> lifeToken_; // 延后释放的任务持有其 weak_ptr，析构后任务失效
+    uint64_t delayTimer_; // 发起下一个尝试的定时器
+    int lastError_; // 最后一个失败尝试的错误码
+    ConnectCallback callback_; // 建连结果回调
+};
+
+#endif // TCP_CONNECTOR_H
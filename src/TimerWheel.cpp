@@ -0,0 +1,178 @@
+#include "TimerWheel.h"
+
+TimerWheel::TimerWheel(int64_t tickUs, int64_t nowUs)
+    : tickUs_(tickUs > 0 ? tickUs : 1), currentTick_(0), freeHead_(kNil), workHead_(0), count_(0) {
+    currentTick_ = nowUs / tickUs_;
+    // 前 kLevels * kSlots 个节点是槽哨兵，其后一个是工作链表哨兵
+    nodes_.resize(kLevels * kSlots + 1);
+    for (uint32_t i = 0; i < nodes_.size(); ++i) {
+        nodes_[i].prev = i;
+        nodes_[i].next = i;
+        nodes_[i].expire = 0;
+        nodes_[i].generation = 0;
+        nodes_[i].active = false;
+    }
+    workHead_ = kLevels * kSlots;
+}
+
+uint32_t TimerWheel::allocNode() {
+    if (freeHead_ != kNil) {
+        uint32_t index = freeHead_;
+        freeHead_ = nodes_[index].next;
+        return index;
+    }
+    nodes_.push_back(Node());
+    Node& node = nodes_.back();
+    node.generation = 0;
+    node.active = false;
+    return static_cast<uint32_t>(nodes_.size() - 1);
+}
+
+void TimerWheel::freeNode(uint32_t index) {
+    Node& node = nodes_[index];
+    node.active = false;
+    ++node.generation;
+    node.next = freeHead_;
+    freeHead_ = index;
+}
+
+void TimerWheel::linkTail(uint32_t head, uint32_t index) {
+    uint32_t tail = nodes_[head].prev;
+    nodes_[index].prev = tail;
+    nodes_[index].next = head;
+    nodes_[tail].next = index;
+    nodes_[head].prev = index;
+}
+
+void TimerWheel::unlink(uint32_t index) {
+    Node& node = nodes_[index];
+    nodes_[node.prev].next = node.next;
+    nodes_[node.next].prev = node.prev;
+    node.prev = index;
+    node.next = index;
+}
+
+void TimerWheel::place(uint32_t index) {
+    int64_t expire = nodes_[index].expire;
+    int64_t diff = expire - currentTick_;
+    if (diff < 0) {
+        // 已经到期，放入当前槽，本轮推进即触发
+        linkTail(slotHead(0, currentTick_ & (kSlots - 1)), index);
+        return;
+    }
+    for (int level = 0; level < kLevels; ++level) {
+        if (diff < (int64_t(1) << (kSlotBits * (level + 1)))) {
+            linkTail(slotHead(level, (expire >> (kSlotBits * level)) & (kSlots - 1)), index);
+            return;
+        }
+    }
+    // 超出时间轮范围：先放在最高层最远的槽，下放时重新计算位置
+    int64_t farthest = currentTick_ + (int64_t(1) << (kSlotBits * kLevels)) - 1;
+    linkTail(slotHead(kLevels - 1, (farthest >> (kSlotBits * (kLevels - 1))) & (kSlots - 1)), index);
+}
+
+uint64_t TimerWheel::add(int64_t deadlineUs, const Task& task) {
+    uint32_t index = allocNode();
+    Node& node = nodes_[index];
+    node.task = task;
+    // 向上取整到 tick，保证不早于 deadline 触发
+    node.expire = (deadlineUs + tickUs_ - 1) / tickUs_;
+    node.active = true;
+    place(index);
+    ++count_;
+    return (static_cast<uint64_t>(node.generation + 1) << 32) | index;
+}
+
+void TimerWheel::cancel(uint64_t timerId) {
+    uint32_t index = static_cast<uint32_t>(timerId & 0xFFFFFFFF);
+    uint32_t generation = static_cast<uint32_t>(timerId >> 32) - 1;
+    if (index < workHead_ + 1 || index >= nodes_.size()) return;
+    Node& node = nodes_[index];
+    if (!node.active || node.generation != generation) return;
+    unlink(index);
+    Task().swap(node.task);
+    freeNode(index);
+    --count_;
+}
+
+int TimerWheel::cascade(int level) {
+    int slot = (currentTick_ >> (kSlotBits * level)) & (kSlots - 1);
+    uint32_t head = slotHead(level, slot);
+    // 先摘下整条链表再逐个重新放置，放置时不会回到同一个槽
+    uint32_t index = nodes_[head].next;
+    nodes_[head].next = head;
+    nodes_[head].prev = head;
+    while (index != head) {
+        uint32_t next = nodes_[index].next;
+        place(index);
+        index = next;
+    }
+    return slot;
+}
+
+void TimerWheel::advance(int64_t nowUs) {
+    int64_t nowTick = nowUs / tickUs_;
+    while (currentTick_ <= nowTick) {
+        if (count_ == 0) {
+            // 没有定时器，直接跳到当前时刻
+            currentTick_ = nowTick + 1;
+            return;
+        }
+        int slot = currentTick_ & (kSlots - 1);
+        // 第 0 层转完一圈时从上层下放，逐层进位
+        if (slot == 0) {
+            for (int level = 1; level < kLevels && cascade(level) == 0; ++level) {
+            }
+        }
+        uint32_t head = slotHead(0, slot);
+        ++currentTick_;
+        if (nodes_[head].next == head) continue;
+
+        // 整个槽移到工作链表后批量触发，回调中新增的定时器进入后续的槽
+        uint32_t first = nodes_[head].next;
+        uint32_t last = nodes_[head].prev;
+        nodes_[head].next = head;
+        nodes_[head].prev = head;
+        nodes_[workHead_].next = first;
+        nodes_[workHead_].prev = last;
+        nodes_[first].prev = workHead_;
+        nodes_[last].next = workHead_;
+        while (nodes_[workHead_].next != workHead_) {
+            uint32_t index = nodes_[workHead_].next;
+            unlink(index);
+            Task task;
+            task.swap(nodes_[index].task);
+            freeNode(index);
+            --count_;
+            task();
+        }
+    }
+}
+
+int64_t TimerWheel::nextDeadline() const {
+    if (count_ == 0) return -1;
+    // 第 0 层按 tick 精确查找
+    int64_t best = -1;
+    for (int i = 0; i < kSlots; ++i) {
+        int64_t tick = currentTick_ + i;
+        uint32_t head = slotHead(0, tick & (kSlots - 1));
+        if (nodes_[head].next != head) {
+            best = tick;
+            break;
+        }
+    }
+    // 上层只能给出下放时刻，到时下放后再精确计算；下放可能早于第 0 层找到的 tick
+    for (int level = 1; level < kLevels; ++level) {
+        int shift = kSlotBits * level;
+        int64_t block = currentTick_ >> shift;
+        for (int j = 1; j <= kSlots; ++j) {
+            uint32_t head = slotHead(level, (block + j) & (kSlots - 1));
+            if (nodes_[head].next != head) {
+                int64_t tick = (block + j) << shift;
+                if (best < 0 || tick < best) best = tick;
+                break;
+            }
+        }
+    }
+    return best < 0 ? -1 : best * tickUs_;
+}
@@ -0,0 +1,63 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <functional>
+
+// 分层时间轮：4 层、每层 64 个槽，第 0 层一个槽对应一个 tick。
+// 插入与取消都是 O(1)（侵入式双向链表），推进时按槽整批触发到期定时器，
+// 远期定时器在所在层的槽轮到时逐级下放到低层
+class TimerWheel {
+public:
+    typedef std::function<void()> Task;
+
+    // tickUs 为第 0 层槽的精度（微秒），nowUs 为当前单调时钟
+    TimerWheel(int64_t tickUs, int64_t nowUs);
+
+    // 添加一次性定时器，deadlineUs 为单调时钟绝对时间，返回定时器 ID（不为 0）
+    uint64_t add(int64_t deadlineUs, const Task& task);
+    // 取消定时器，已触发或已取消的 ID 被忽略
+    void cancel(uint64_t timerId);
+    // 推进到 nowUs，执行所有到期定时器；回调中可以安全地增删定时器
+    void advance(int64_t nowUs);
+    // 下一次需要推进的时刻（不晚于最早的到期时间），没有定时器时为 -1
+    int64_t nextDeadline() const;
+    size_t size() const { return count_; }
+
+private:
+    static const int kLevels = 4;
+    static const int kSlotBits = 6;
+    static const int kSlots = 1 << kSlotBits;
+    static const uint32_t kNil = 0xFFFFFFFF;
+
+    // 定时器节点，槽头与工作链表头也是节点（哨兵），链表为循环双向链表
+    struct Node {
+        Task task; // 回调
+        int64_t expire; // 到期 tick
+        uint32_t prev; // 前驱节点下标
+        uint32_t next; // 后继节点下标（空闲节点用作空闲链表）
+        uint32_t generation; // 节点复用代数，防止取消已复用的节点
+        bool active; // 是否在时间轮中
+    };
+
+    uint32_t slotHead(int level, int slot) const { return level * kSlots + slot; }
+    uint32_t allocNode();
+    void freeNode(uint32_t index);
+    void linkTail(uint32_t head, uint32_t index);
+    void unlink(uint32_t index);
+    // 按到期 tick 把节点放入对应层的槽
+    void place(uint32_t index);
+    // 把第 level 层当前槽的定时器下放，返回该层的槽位置
+    int cascade(int level);
+
+    int64_t tickUs_; // tick 精度（微秒）
+    int64_t currentTick_; // 下一个待处理的 tick
+    std::vector<Node> nodes_; // 槽哨兵、工作链表哨兵与定时器节点
+    uint32_t freeHead_; // 空闲节点链表
+    uint32_t workHead_; // 正在触发的一批定时器
+    size_t count_; // 定时器数量
+};
+
+#endif // TIMER_WHEEL_H
@@ -0,0 +1,549 @@
+#include "TsSource.h"
+#include "Vnsp_WriteLog.h"
+#include <cstring>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define TS_HAVE_SIMD 1
+#endif
+
+namespace {
+const size_t kTsPacketSize = 188; // TS 包长（不含 M2TS 前缀与 RS 校验）
+const uint8_t kSyncByte = 0x47;
+const size_t kMaxQueuedFrames = 256; // 另一路迟迟没有数据时，单路最多缓存的消息数
+const size_t kMaxPooledBuffers = 64; // 缓冲池上限
+const uint64_t kPcrScanBytes = 1024 * 1024; // 估算码率时在文件首尾查找 PCR 的范围
+// PMT 中的流类型
+const uint8_t kStreamTypeAac = 0x0F;
+const uint8_t kStreamTypeH264 = 0x1B;
+const uint8_t kStreamTypeHevc = 0x24;
+
+typedef const uint8_t* (*SyncFunc)(const uint8_t* p, const uint8_t* end, size_t stride);
+
+// p 处及其后两个包的位置（在范围内时）都是同步字节
+bool isSync(const uint8_t* p, const uint8_t* end, size_t stride) {
+    if (p[0] != kSyncByte) return false;
+    if (end - p > static_cast<ptrdiff_t>(stride) && p[stride] != kSyncByte) return false;
+    if (end - p > static_cast<ptrdiff_t>(2 * stride) && p[2 * stride] != kSyncByte) return false;
+    return true;
+}
+
+const uint8_t* syncPortable(const uint8_t* p, const uint8_t* end, size_t stride) {
+    for (; p < end; ++p) {
+        p = static_cast<const uint8_t*>(memchr(p, kSyncByte, end - p));
+        if (p == nullptr) return end;
+        if (isSync(p, end, stride)) return p;
+    }
+    return end;
+}
+
+#ifdef TS_HAVE_SIMD
+// 每轮比较 16 个起点：起点及其后两个包的对应位置同时为 0x47 才算同步
+__attribute__((target("sse2")))
+const uint8_t* syncSse2(const uint8_t* p, const uint8_t* end, size_t stride) {
+    const __m128i sync = _mm_set1_epi8(static_cast<char>(kSyncByte));
+    while (end - p >= static_cast<ptrdiff_t>(2 * stride + 16)) {
+        __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + stride));
+        __m128i b2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 2 * stride));
+        __m128i hit = _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(b0, sync), _mm_cmpeq_epi8(b1, sync)),
+                                    _mm_cmpeq_epi8(b2, sync));
+        int mask = _mm_movemask_epi8(hit);
+        if (mask != 0) return p + __builtin_ctz(mask);
+        p += 16;
+    }
+    return syncPortable(p, end, stride);
+}
+
+__attribute__((target("avx2")))
+const uint8_t* syncAvx2(const uint8_t* p, const uint8_t* end, size_t stride) {
+    const __m256i sync = _mm256_set1_epi8(static_cast<char>(kSyncByte));
+    while (end - p >= static_cast<ptrdiff_t>(2 * stride + 32)) {
+        __m256i b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + stride));
+        __m256i b2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 2 * stride));
+        __m256i hit = _mm256_and_si256(_mm256_and_si256(_mm256_cmpeq_epi8(b0, sync), _mm256_cmpeq_epi8(b1, sync)),
+                                       _mm256_cmpeq_epi8(b2, sync));
+        unsigned int mask = static_cast<unsigned int>(_mm256_movemask_epi8(hit));
+        if (mask != 0) return p + __builtin_ctz(mask);
+        p += 32;
+    }
+    return syncSse2(p, end, stride);
+}
+
+bool cpuHasAvx2() {
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+    if ((ecx & bit_OSXSAVE) == 0 || (ecx & bit_AVX) == 0) return false;
+    unsigned int xcr0Low, xcr0High;
+    __asm__("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+    if ((xcr0Low & 0x6) != 0x6) return false;
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) return false;
+    return (ebx & bit_AVX2) != 0;
+}
+
+bool cpuHasSse2() {
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+    return (edx & bit_SSE2) != 0;
+}
+#endif
+
+SyncFunc selectSync() {
+#ifdef TS_HAVE_SIMD
+    if (cpuHasAvx2()) return syncAvx2;
+    if (cpuHasSse2()) return syncSse2;
+#endif
+    return syncPortable;
+}
+
+// 查找 [p, end) 中第一个同步位置，没有时返回 end；进程内只检测一次 CPU 特性
+const uint8_t* findSync(const uint8_t* p, const uint8_t* end, size_t stride) {
+    static const SyncFunc func = selectSync();
+    return func(p, end, stride);
+}
+
+// 读取 PES 头部中的 33 位时间戳
+uint64_t readTimestamp(const uint8_t* p) {
+    return (static_cast<uint64_t>((p[0] >> 1) & 0x07) << 30) | (p[1] << 22) | ((p[2] >> 1) << 15) | (p[3] << 7) |
+           (p[4] >> 1);
+}
+
+// 包的自适应字段带 PCR 时取出其 90 kHz 部分
+bool readPcr(const uint8_t* packet, uint64_t& pcr) {
+    if ((packet[3] & 0x20) == 0 || packet[4] < 7 || (packet[5] & 0x10) == 0) return false;
+    pcr = (static_cast<uint64_t>(packet[6]) << 25) | (packet[7] << 17) | (packet[8] << 9) | (packet[9] << 1) |
+          (packet[10] >> 7);
+    return true;
+}
+
+// 33 位时间戳之差，按最近的方向取符号
+int64_t timestampDelta(uint64_t to, uint64_t from) {
+    const int64_t wrap = 1LL << 33;
+    int64_t delta = static_cast<int64_t>((to - from) & (wrap - 1));
+    return delta >= wrap / 2 ? delta - wrap : delta;
+}
+}
+
+TsSource::Stream::Stream()
+    : pid(-1), continuity(-1), inPes(false), havePts(false), pts(0), dts(0), lastTs(-1), offset(0),
+      lengthPos(std::string::npos), adtsHeader(), adtsHeaderSize(0), adtsRemain(0), adtsDts(0), framesInPes(0) {}
+
+TsSource::TsSource()
+    : pos_(nullptr), packetSize_(kTsPacketSize), pmtPid_(-1), havePmt_(false), origin_(-1), eof_(false),
+      bitrate_(0), failed_(false) {}
+
+bool TsSource::isTsPath(const std::string& path) {
+    std::string ext = extensionOf(path);
+    return ext == "ts" || ext == "m2ts" || ext == "mts";
+}
+
+bool TsSource::open(const std::string& path) {
+    if (!file_.open(path)) {
+        failed_ = true;
+        return false;
+    }
+    // 按连续 5 个同步字节确定包长：188（TS）、192（M2TS 带 4 字节前缀）、204（带 RS 校验）
+    const uint8_t* begin = file_.data();
+    const uint8_t* end = file_.end();
+    const size_t strides[] = {188, 192, 204};
+    pos_ = nullptr;
+    for (size_t i = 0; i < sizeof(strides) / sizeof(strides[0]) && pos_ == nullptr; ++i) {
+        const uint8_t* limit = std::min(end, begin + 16 * strides[i]);
+        for (const uint8_t* p = findSync(begin, limit, strides[i]); p < limit; p = findSync(p + 1, limit, strides[i])) {
+            if (end - p >= static_cast<ptrdiff_t>(4 * strides[i] + 1) && p[3 * strides[i]] == kSyncByte &&
+                p[4 * strides[i]] == kSyncByte) {
+                pos_ = p;
+                packetSize_ = strides[i];
+                break;
+            }
+        }
+    }
+    if (pos_ == nullptr) {
+        VNSP_LOG(LOG_ERROR, "TsSource", "No MPEG-TS sync found in %s", path.c_str());
+        failed_ = true;
+        return false;
+    }
+
+    // 由首尾 PCR 估算码率
+    uint64_t firstPcr = 0, lastPcr = 0, pcr;
+    const uint8_t* firstAt = nullptr;
+    const uint8_t* lastAt = nullptr;
+    const uint8_t* headEnd = std::min<const uint8_t*>(end, pos_ + kPcrScanBytes);
+    for (const uint8_t* p = pos_; p + kTsPacketSize <= headEnd && p[0] == kSyncByte; p += packetSize_) {
+        if (readPcr(p, pcr)) {
+            firstPcr = pcr;
+            firstAt = p;
+            break;
+        }
+    }
+    const uint8_t* tail = file_.size() > kPcrScanBytes ? end - kPcrScanBytes : pos_;
+    for (const uint8_t* p = findSync(tail, end, packetSize_); p + kTsPacketSize <= end && p[0] == kSyncByte;
+         p += packetSize_) {
+        if (readPcr(p, pcr)) {
+            lastPcr = pcr;
+            lastAt = p;
+        }
+    }
+    if (firstAt != nullptr && lastAt > firstAt) {
+        int64_t ticks = timestampDelta(lastPcr, firstPcr);
+        if (ticks > 0) bitrate_ = static_cast<uint64_t>(lastAt - firstAt) * 8 * 90000 / ticks;
+    }
+    file_.advise(pos_);
+    VNSP_LOG(LOG_INFO, "TsSource", "Opened %s: %zu-byte packets, estimated bitrate %llu bps", path.c_str(),
+             packetSize_, static_cast<unsigned long long>(bitrate_));
+    return true;
+}
+
+bool TsSource::parsePacket() {
+    const uint8_t* end = file_.end();
+    if (end - pos_ < static_cast<ptrdiff_t>(kTsPacketSize)) return false;
+    if (!isSync(pos_, end, packetSize_)) {
+        const uint8_t* sync = findSync(pos_ + 1, end, packetSize_);
+        VNSP_LOG(LOG_WARN, "TsSource", "Lost sync at offset %llu, skipped %lld bytes",
+                 static_cast<unsigned long long>(pos_ - file_.data()), static_cast<long long>(sync - pos_));
+        pos_ = sync;
+        // 跳过的数据里可能有任意一路的包，正在组装的帧都不完整
+        video_.inPes = false;
+        video_.continuity = -1;
+        resetAudio(audio_);
+        audio_.continuity = -1;
+        if (end - pos_ < static_cast<ptrdiff_t>(kTsPacketSize)) return false;
+    }
+    const uint8_t* packet = pos_;
+    pos_ = end - pos_ > static_cast<ptrdiff_t>(packetSize_) ? pos_ + packetSize_ : end;
+    file_.advise(pos_);
+
+    // transport_error_indicator
+    if (packet[1] & 0x80) return true;
+    int pid = ((packet[1] & 0x1F) << 8) | packet[2];
+    bool unitStart = (packet[1] & 0x40) != 0;
+    int adaptation = (packet[3] >> 4) & 0x03;
+    if ((adaptation & 0x01) == 0) return true;
+    const uint8_t* payload = packet + 4;
+    if (adaptation & 0x02) payload += 1 + packet[4];
+    if (payload >= packet + kTsPacketSize) return true;
+    size_t size = packet + kTsPacketSize - payload;
+
+    if (pid == 0) {
+        if (unitStart) parsePat(payload, size);
+    } else if (pid == pmtPid_) {
+        if (unitStart) parsePmt(payload, size);
+    } else if (pid == video_.pid || pid == audio_.pid) {
+        Stream& stream = pid == video_.pid ? video_ : audio_;
+        int continuity = packet[3] & 0x0F;
+        if (stream.continuity >= 0 && continuity == stream.continuity) return true; // 重复包
+        if (stream.continuity >= 0 && continuity != ((stream.continuity + 1) & 0x0F)) {
+            VNSP_LOG(LOG_WARN, "TsSource", "Continuity error on PID %d at offset %llu", pid,
+                     static_cast<unsigned long long>(packet - file_.data()));
+            if (&stream == &video_) {
+                stream.inPes = false;
+            } else {
+                resetAudio(stream);
+            }
+        }
+        stream.continuity = continuity;
+        parsePes(stream, packet, payload, size, unitStart);
+    }
+    return true;
+}
+
+void TsSource::parsePat(const uint8_t* payload, size_t size) {
+    // 全部按整数下标比较，指针只在确认范围之后才形成：pointer_field 最大 255，可远超一个 TS 包
+    if (size < 1) return;
+    size_t start = 1 + payload[0];
+    if (start + 8 > size || payload[start] != 0x00) return;
+    const uint8_t* section = payload + start;
+    size_t sectionLength = ((section[1] & 0x0F) << 8) | section[2];
+    // 表头 5 字节之后才是节目表，最后 4 字节是 CRC
+    if (sectionLength < 9) return;
+    size_t entriesEnd = std::min(size - start, 3 + sectionLength - 4);
+    for (size_t i = 8; i + 4 <= entriesEnd; i += 4) {
+        const uint8_t* p = section + i;
+        int program = (p[0] << 8) | p[1];
+        // 节目号 0 是网络信息表
+        if (program != 0) {
+            pmtPid_ = ((p[2] & 0x1F) << 8) | p[3];
+            return;
+        }
+    }
+}
+
+void TsSource::parsePmt(const uint8_t* payload, size_t size) {
+    if (havePmt_) return;
+    if (size < 1) return;
+    size_t start = 1 + payload[0];
+    if (start + 12 > size || payload[start] != 0x02) return;
+    const uint8_t* section = payload + start;
+    size_t sectionLength = ((section[1] & 0x0F) << 8) | section[2];
+    // 表头 9 字节之后才是节目信息与流表，最后 4 字节是 CRC
+    if (sectionLength < 13) return;
+    size_t programInfoLength = ((section[10] & 0x0F) << 8) | section[11];
+    size_t entriesEnd = std::min(size - start, 3 + sectionLength - 4);
+    for (size_t i = 12 + programInfoLength; i + 5 <= entriesEnd;) {
+        const uint8_t* p = section + i;
+        uint8_t type = p[0];
+        int pid = ((p[1] & 0x1F) << 8) | p[2];
+        size_t infoLength = ((p[3] & 0x0F) << 8) | p[4];
+        if ((type == kStreamTypeH264 || type == kStreamTypeHevc) && video_.pid < 0) {
+            video_.pid = pid;
+            videoPacketizer_.reset(new VideoPacketizer(type == kStreamTypeHevc ? VideoPacketizer::CODEC_HEVC
+                                                                               : VideoPacketizer::CODEC_H264));
+            videoPacketizer_->setEnhanced(enhancedRtmp_);
+        } else if (type == kStreamTypeAac && audio_.pid < 0) {
+            audio_.pid = pid;
+        } else {
+            VNSP_LOG(LOG_DEBUG, "TsSource", "Ignoring stream type 0x%02x on PID %d", type, pid);
+        }
+        i += 5 + infoLength;
+    }
+    havePmt_ = true;
+    if (video_.pid < 0 && audio_.pid < 0) {
+        VNSP_LOG(LOG_ERROR, "TsSource", "No H.264/HEVC or AAC stream in program map");
+        failed_ = true;
+        return;
+    }
+    VNSP_LOG(LOG_INFO, "TsSource", "Program map: video PID %d, audio PID %d", video_.pid, audio_.pid);
+}
+
+const uint8_t* TsSource::parsePesHeader(Stream& stream, const uint8_t* payload, const uint8_t* end) {
+    if (end - payload < 9 || payload[0] != 0 || payload[1] != 0 || payload[2] != 1) return nullptr;
+    const uint8_t* data = payload + 9 + payload[8];
+    if (data > end) return nullptr;
+    int flags = payload[7] >> 6;
+    stream.havePts = false;
+    if ((flags & 0x02) && payload[8] >= 5) {
+        stream.pts = unwrap(stream, readTimestamp(payload + 9));
+        stream.dts = stream.pts;
+        if (flags == 0x03 && payload[8] >= 10) stream.dts = unwrap(stream, readTimestamp(payload + 14));
+        stream.havePts = true;
+    }
+    return data;
+}
+
+void TsSource::parsePes(Stream& stream, const uint8_t* packet, const uint8_t* payload, size_t size, bool unitStart) {
+    const uint8_t* end = payload + size;
+    bool video = &stream == &video_;
+    if (unitStart) {
+        // 视频一个 PES 是一个访问单元；音频的 ADTS 帧可能跨 PES，继续组装
+        if (video) flushVideo(stream);
+        const uint8_t* data = parsePesHeader(stream, payload, end);
+        if (data == nullptr) {
+            VNSP_LOG(LOG_WARN, "TsSource", "Bad PES header on PID %d at offset %llu", stream.pid,
+                     static_cast<unsigned long long>(packet - file_.data()));
+            stream.inPes = false;
+            return;
+        }
+        // 没有时间戳的 PES 沿用上一个
+        stream.inPes = stream.havePts || stream.lastTs >= 0;
+        if (!stream.inPes) return;
+        stream.offset = packet - file_.data();
+        if (video) {
+            takeBuffer(stream.frame);
+            stream.frame.resize(videoPacketizer_->headerSize());
+            stream.lengthPos = std::string::npos;
+        } else if (stream.havePts) {
+            stream.framesInPes = 0;
+        }
+        payload = data;
+    }
+    if (!stream.inPes) return;
+    if (video) {
+        appendVideo(stream, payload, end);
+    } else {
+        appendAudio(stream, payload, end);
+    }
+}
+
+void TsSource::appendVideo(Stream& stream, const uint8_t* p, const uint8_t* end) {
+    std::vector<uint8_t>& frame = stream.frame;
+    // 起始码可能跨包：帧尾已有的零与本段开头的 01 / 00 01 拼成 00 00 01
+    size_t body = stream.lengthPos == std::string::npos ? videoPacketizer_->headerSize() : stream.lengthPos + 4;
+    size_t zeros = 0;
+    while (zeros < 2 && frame.size() - zeros > body && frame[frame.size() - zeros - 1] == 0) ++zeros;
+    if (p < end && zeros == 2 && p[0] == 1) {
+        beginNalu(stream);
+        p += 1;
+    } else if (end - p >= 2 && zeros >= 1 && p[0] == 0 && p[1] == 1) {
+        beginNalu(stream);
+        p += 2;
+    }
+    // 起始码之间的数据直接复制进帧缓冲，这是帧数据唯一的一次复制
+    while (p < end) {
+        const uint8_t* start = AnnexB::findStartCode(p, end);
+        frame.insert(frame.end(), p, start);
+        if (start == end) break;
+        beginNalu(stream);
+        p = start + 3;
+    }
+}
+
+void TsSource::beginNalu(Stream& stream) {
+    endNalu(stream);
+    stream.lengthPos = stream.frame.size();
+    stream.frame.resize(stream.lengthPos + 4);
+}
+
+void TsSource::endNalu(Stream& stream) {
+    std::vector<uint8_t>& frame = stream.frame;
+    if (stream.lengthPos == std::string::npos) {
+        // 第一个起始码之前的数据不属于任何 NALU
+        frame.resize(videoPacketizer_->headerSize());
+        return;
+    }
+    // 4 字节起始码的前导零与 trailing_zero_8bits 不计入 NALU
+    size_t body = stream.lengthPos + 4;
+    size_t last = frame.size();
+    while (last > body && frame[last - 1] == 0) --last;
+    frame.resize(last);
+    size_t size = last - body;
+    if (size == 0) {
+        frame.resize(stream.lengthPos);
+    } else {
+        frame[stream.lengthPos] = (size >> 24) & 0xFF;
+        frame[stream.lengthPos + 1] = (size >> 16) & 0xFF;
+        frame[stream.lengthPos + 2] = (size >> 8) & 0xFF;
+        frame[stream.lengthPos + 3] = size & 0xFF;
+    }
+    stream.lengthPos = std::string::npos;
+}
+
+void TsSource::flushVideo(Stream& stream) {
+    if (!stream.inPes) return;
+    stream.inPes = false;
+    endNalu(stream);
+    int64_t cts = std::max<int64_t>(stream.pts - stream.dts, 0) / 90;
+    bool ok = videoPacketizer_->packetizeInPlace(stream.frame, static_cast<int32_t>(cts));
+    std::vector<uint8_t> header;
+    if (videoPacketizer_->takeSequenceHeader(header)) enqueue(stream, 9, stream.dts, header);
+    if (ok) {
+        enqueue(stream, 9, stream.dts, stream.frame);
+    } else {
+        // 参数集之前的帧无法解码，丢弃
+        stream.frame.clear();
+    }
+}
+
+void TsSource::appendAudio(Stream& stream, const uint8_t* p, const uint8_t* end) {
+    while (p < end) {
+        if (stream.adtsRemain == 0) {
+            // 收集 ADTS 头部，头部可能跨包；有 CRC 时头部为 9 字节
+            size_t want = stream.adtsHeaderSize >= 2 ? AudioPacketizer::adtsHeaderSize(stream.adtsHeader) : 7;
+            if (stream.adtsHeaderSize < want) {
+                size_t n = std::min<size_t>(want - stream.adtsHeaderSize, end - p);
+                memcpy(stream.adtsHeader + stream.adtsHeaderSize, p, n);
+                stream.adtsHeaderSize += n;
+                p += n;
+                continue;
+            }
+            size_t frameSize = AudioPacketizer::adtsFrameSize(stream.adtsHeader, stream.adtsHeaderSize);
+            takeBuffer(stream.frame);
+            if (frameSize == 0 || !audioPacketizer_.beginFrame(stream.adtsHeader, stream.frame)) {
+                // 不是 ADTS 头部：丢掉一个字节继续找同步字
+                memmove(stream.adtsHeader, stream.adtsHeader + 1, --stream.adtsHeaderSize);
+                continue;
+            }
+            // PES 时间戳属于其中开始的第一个 ADTS 帧，之后的帧按样本数顺延
+            stream.adtsDts = stream.pts + static_cast<int64_t>(stream.framesInPes) *
+                                              audioPacketizer_.samplesPerFrame() * 90000 /
+                                              audioPacketizer_.sampleRate();
+            ++stream.framesInPes;
+            stream.adtsRemain = frameSize - stream.adtsHeaderSize;
+            stream.adtsHeaderSize = 0;
+            stream.frame.reserve(2 + stream.adtsRemain);
+        } else {
+            size_t n = std::min<size_t>(stream.adtsRemain, end - p);
+            stream.frame.insert(stream.frame.end(), p, p + n);
+            stream.adtsRemain -= n;
+            p += n;
+            if (stream.adtsRemain == 0) {
+                std::vector<uint8_t> header;
+                if (audioPacketizer_.takeSequenceHeader(header)) enqueue(stream, 8, stream.adtsDts, header);
+                enqueue(stream, 8, stream.adtsDts, stream.frame);
+            }
+        }
+    }
+}
+
+void TsSource::resetAudio(Stream& stream) {
+    stream.inPes = false;
+    stream.adtsHeaderSize = 0;
+    stream.adtsRemain = 0;
+    stream.frame.clear();
+}
+
+int64_t TsSource::unwrap(Stream& stream, uint64_t ts) {
+    // 第一个时间戳相对另一路展开，两路在同一时间轴上
+    const Stream& other = &stream == &video_ ? audio_ : video_;
+    int64_t reference = stream.lastTs >= 0 ? stream.lastTs : other.lastTs;
+    int64_t value = reference >= 0 ? reference + timestampDelta(ts, static_cast<uint64_t>(reference))
+                                   : static_cast<int64_t>(ts);
+    stream.lastTs = value;
+    return value;
+}
+
+void TsSource::enqueue(Stream& stream, uint8_t type, int64_t dts, std::vector<uint8_t>& data) {
+    stream.queue.push_back(Frame());
+    Frame& frame = stream.queue.back();
+    frame.type = type;
+    frame.dts = dts;
+    frame.offset = stream.offset;
+    frame.data.swap(data);
+}
+
+void TsSource::takeBuffer(std::vector<uint8_t>& buffer) {
+    if (!pool_.empty() && buffer.capacity() == 0) {
+        buffer.swap(pool_.back());
+        pool_.pop_back();
+    }
+    buffer.clear();
+}
+
+bool TsSource::ready() const {
+    if (eof_ || failed_) return true;
+    if (!havePmt_) return false;
+    if (video_.queue.size() >= kMaxQueuedFrames || audio_.queue.size() >= kMaxQueuedFrames) return true;
+    return (video_.pid < 0 || !video_.queue.empty()) && (audio_.pid < 0 || !audio_.queue.empty());
+}
+
+uint32_t TsSource::toMs(int64_t ts) const {
+    return ts > origin_ ? static_cast<uint32_t>((ts - origin_) / 90) : 0;
+}
+
+bool TsSource::readTag(FlvTag& tag, std::vector<uint8_t>& payload) {
+    while (!ready()) {
+        if (!parsePacket()) {
+            // 最后一个访问单元以文件结束为界；不完整的 ADTS 帧丢弃
+            flushVideo(video_);
+            eof_ = true;
+        }
+    }
+    if (failed_) return false;
+    // 两路中 DTS 小的先发，相同时先发视频
+    Stream* stream = nullptr;
+    if (!video_.queue.empty()) stream = &video_;
+    if (!audio_.queue.empty() && (stream == nullptr || audio_.queue.front().dts < video_.queue.front().dts)) {
+        stream = &audio_;
+    }
+    if (stream == nullptr) return false;
+    if (origin_ < 0) {
+        // 时间零点取两路首个 DTS 中较早的一个
+        origin_ = stream->queue.front().dts;
+    }
+    Frame& frame = stream->queue.front();
+    tag.type = frame.type;
+    tag.timestamp = toMs(frame.dts);
+    tag.offset = frame.offset;
+    payload.swap(frame.data);
+    // 换回的是发送队列回收的缓冲，留给后面的帧复用
+    if (frame.data.capacity() > 0 && pool_.size() < kMaxPooledBuffers) {
+        pool_.push_back(std::vector<uint8_t>());
+        pool_.back().swap(frame.data);
+    }
+    stream->queue.pop_front();
+    tag.data = payload.data();
+    tag.size = static_cast<uint32_t>(payload.size());
+    return true;
+}
@@ -0,0 +1,100 @@
+#ifndef TS_SOURCE_H
+#define TS_SOURCE_H
+
+#include <deque>
+#include <memory>
+#include "MediaSource.h"
+#include "MediaPacketizer.h"
+#include "MappedFile.h"
+
+// MPEG-TS 文件输入（.ts/.m2ts/.mts，188/192/204 字节包）。取 PMT 中第一路 H.264/HEVC 视频与
+// 第一路 ADTS AAC 音频，PES 负载从文件映射直接复制进帧缓冲：视频边复制边把起始码改写成
+// 4 字节长度前缀，音频按 ADTS 帧拆开并去掉头部，每帧只复制一次。PTS/DTS 换算成毫秒时间戳
+// （处理 33 位回绕），视频的 PTS - DTS 作为 CompositionTime。失步时按连续的 0x47 重新同步
+class TsSource : public MediaSource {
+public:
+    TsSource();
+
+    // 路径是否为 TS 文件
+    static bool isTsPath(const std::string& path);
+
+    bool open(const std::string& path) override;
+    bool readTag(FlvTag& tag, std::vector<uint8_t>& payload) override;
+    bool failed() const override { return failed_; }
+    uint64_t bitrate() const override { return bitrate_; }
+
+private:
+    // 待输出的一条消息
+    struct Frame {
+        uint8_t type; // 8 音频 / 9 视频
+        int64_t dts; // 展开回绕后的 DTS（90 kHz）
+        uint64_t offset; // 所在 PES 起始包在文件中的偏移
+        std::vector<uint8_t> data; // 消息数据
+    };
+
+    // 一路基本流的解复用状态
+    struct Stream {
+        int pid; // PID，-1 表示没有这一路
+        int continuity; // 上一个包的连续计数，-1 表示未知
+        bool inPes; // 是否在一个 PES 中（见过起始包且未出错）
+        bool havePts; // 当前 PES 是否带时间戳
+        int64_t pts; // 当前 PES 的 PTS（展开回绕）
+        int64_t dts; // 当前 PES 的 DTS（展开回绕）
+        int64_t lastTs; // 上一个时间戳（展开回绕），-1 表示还没有
+        uint64_t offset; // 当前 PES 起始包的偏移
+        std::vector<uint8_t> frame; // 正在组装的帧
+        // 视频：frame 中当前 NALU 长度字段的位置，npos 表示还没遇到起始码
+        size_t lengthPos;
+        // 音频：正在收集的 ADTS 头部与当前帧剩余的原始数据长度
+        uint8_t adtsHeader[9];
+        size_t adtsHeaderSize;
+        size_t adtsRemain;
+        int64_t adtsDts; // 当前 ADTS 帧的时间戳
+        int framesInPes; // 当前 PES 中已开始的 ADTS 帧数
+        std::deque<Frame> queue; // 已组装、等待输出的消息
+        Stream();
+    };
+
+    // 解析下一个 TS 包，没有更多数据时返回 false
+    bool parsePacket();
+    void parsePat(const uint8_t* payload, size_t size);
+    void parsePmt(const uint8_t* payload, size_t size);
+    void parsePes(Stream& stream, const uint8_t* packet, const uint8_t* payload, size_t size, bool unitStart);
+    // 解析 PES 头部，返回 PES 负载的起点，头部无效时返回 nullptr
+    const uint8_t* parsePesHeader(Stream& stream, const uint8_t* payload, const uint8_t* end);
+    // 视频 PES 负载追加进帧缓冲，起始码就地改写成长度前缀
+    void appendVideo(Stream& stream, const uint8_t* p, const uint8_t* end);
+    // 开始一个新的 NALU：结束上一个 NALU 并留出长度字段
+    void beginNalu(Stream& stream);
+    void endNalu(Stream& stream);
+    // 当前访问单元结束，打包入队
+    void flushVideo(Stream& stream);
+    // 音频 PES 负载按 ADTS 帧拆分入队
+    void appendAudio(Stream& stream, const uint8_t* p, const uint8_t* end);
+    void resetAudio(Stream& stream);
+    // 33 位时间戳按该流上一个时间戳展开回绕
+    int64_t unwrap(Stream& stream, uint64_t ts);
+    void enqueue(Stream& stream, uint8_t type, int64_t dts, std::vector<uint8_t>& data);
+    // 从缓冲池取出一个空缓冲
+    void takeBuffer(std::vector<uint8_t>& buffer);
+    // 是否可以输出队首时间戳最小的消息：各路都有待输出的消息，或输入已读完
+    bool ready() const;
+    uint32_t toMs(int64_t ts) const;
+
+    MappedFile file_; // TS 文件映射
+    const uint8_t* pos_; // 下一个包的同步字节位置
+    size_t packetSize_; // 包长（188/192/204），从同步字节算起的步长
+    int pmtPid_; // PMT 的 PID，-1 表示尚未从 PAT 得到
+    bool havePmt_; // 是否已解析 PMT
+    Stream video_; // 视频流
+    Stream audio_; // 音频流
+    std::unique_ptr<VideoPacketizer> videoPacketizer_; // 视频打包
+    AudioPacketizer audioPacketizer_; // 音频打包
+    std::vector<std::vector<uint8_t>> pool_; // 回收的帧缓冲
+    int64_t origin_; // 时间戳零点（第一个 DTS），-1 表示还没有
+    bool eof_; // 文件是否已解析完
+    uint64_t bitrate_; // 由首尾 PCR 估算的码率
+    bool failed_; // 是否出错
+};
+
+#endif // TS_SOURCE_H
@@ -0,0 +1,147 @@
+#include "VideoTag.h"
+
+namespace {
+const uint8_t kExHeaderFlag = 0x80; // 首字节最高位：IsExHeader
+const int kFrameTypeCommand = 5; // 视频信息/命令帧
+// 传统头部的编码 ID
+const uint8_t kCodecIdAvc = 7;
+const uint8_t kCodecIdHevc = 12; // 国内 CDN 通行的 HEVC 扩展
+// 多轨类型：单轨、多轨同编码、多轨各自编码
+const int kOneTrack = 0;
+const int kManyTracksManyCodecs = 2;
+
+uint32_t readU32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+int32_t readSi24(const uint8_t* p) {
+    int32_t v = (p[0] << 16) | (p[1] << 8) | p[2];
+    return (v & 0x800000) ? v - 0x1000000 : v;
+}
+
+void putSi24(uint8_t* p, int32_t v) {
+    p[0] = (v >> 16) & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = v & 0xFF;
+}
+}
+
+bool VideoTag::parse(const uint8_t* data, size_t size, VideoTagInfo& info) {
+    info = VideoTagInfo();
+    if (size < 1) return false;
+    info.headerSize = 1;
+    if ((data[0] & kExHeaderFlag) == 0) {
+        info.frameType = data[0] >> 4;
+        int codec = data[0] & 0x0F;
+        if (info.frameType == kFrameTypeCommand || (codec != kCodecIdAvc && codec != kCodecIdHevc)) {
+            // 其他传统编码没有包类型，整条消息就是帧数据
+            info.packetType = CODED_FRAMES_X;
+            info.bodySize = size - 1;
+            return true;
+        }
+        if (size < 5) return false;
+        info.fourCc = codec == kCodecIdAvc ? FOURCC_AVC : FOURCC_HEVC;
+        info.packetType = data[1];
+        info.cts = readSi24(data + 2);
+        info.headerSize = 5;
+        info.bodySize = size - 5;
+        return true;
+    }
+
+    info.enhanced = true;
+    info.frameType = (data[0] >> 4) & 0x07;
+    int packetType = data[0] & 0x0F;
+    const uint8_t* p = data + 1;
+    const uint8_t* end = data + size;
+    // 修饰扩展：跳过扩展数据，其后一个字节的低 4 位是真实包类型
+    while (packetType == MOD_EX) {
+        if (p >= end) return false;
+        size_t modExSize = *p++ + 1;
+        if (modExSize == 256) {
+            if (end - p < 2) return false;
+            modExSize = ((p[0] << 8) | p[1]) + 1;
+            p += 2;
+        }
+        if (static_cast<size_t>(end - p) < modExSize + 1) return false;
+        p += modExSize;
+        packetType = *p++ & 0x0F;
+    }
+    info.packetType = packetType;
+    if (info.frameType == kFrameTypeCommand && packetType != METADATA) {
+        // 命令帧只有一个字节的命令，没有 FourCC
+        info.headerSize = p - data;
+        info.bodySize = end - p;
+        return true;
+    }
+    int multitrackType = -1;
+    size_t trackSize = 0;
+    if (packetType == MULTITRACK) {
+        if (p >= end) return false;
+        multitrackType = *p >> 4;
+        info.packetType = *p & 0x0F;
+        ++p;
+    }
+    // 各轨道编码不同时 FourCC 在每条轨道之前
+    if (multitrackType != kManyTracksManyCodecs) {
+        if (end - p < 4) return false;
+        info.fourCc = readU32(p);
+        p += 4;
+    }
+    if (multitrackType >= 0) {
+        if (multitrackType == kManyTracksManyCodecs) {
+            if (end - p < 4) return false;
+            info.fourCc = readU32(p);
+            p += 4;
+        }
+        if (p >= end) return false;
+        info.trackId = *p++;
+        // 多于一条轨道时每条之前有 3 字节长度，这里只看第一条
+        if (multitrackType != kOneTrack) {
+            if (end - p < 3) return false;
+            trackSize = (p[0] << 16) | (p[1] << 8) | p[2];
+            p += 3;
+        }
+    }
+    const uint8_t* trackStart = p;
+    if (info.packetType == CODED_FRAMES && isNaluCodec(info.fourCc)) {
+        if (end - p < 3) return false;
+        info.cts = readSi24(p);
+        p += 3;
+    }
+    info.headerSize = p - data;
+    info.bodySize = end - p;
+    if (trackSize > 0) {
+        // 轨道长度包含 CompositionTime
+        size_t used = p - trackStart;
+        if (trackSize < used || trackSize - used > info.bodySize) return false;
+        info.bodySize = trackSize - used;
+    }
+    return true;
+}
+
+size_t VideoTag::writeHeader(uint8_t* out, bool enhanced, int frameType, int packetType, uint32_t fourCc,
+                             int32_t cts) {
+    if (!enhanced) {
+        out[0] = static_cast<uint8_t>((frameType << 4) | (fourCc == FOURCC_HEVC ? kCodecIdHevc : kCodecIdAvc));
+        out[1] = static_cast<uint8_t>(packetType == CODED_FRAMES_X ? CODED_FRAMES : packetType);
+        putSi24(out + 2, cts);
+        return 5;
+    }
+    out[0] = static_cast<uint8_t>(kExHeaderFlag | (frameType << 4) | packetType);
+    out[1] = (fourCc >> 24) & 0xFF;
+    out[2] = (fourCc >> 16) & 0xFF;
+    out[3] = (fourCc >> 8) & 0xFF;
+    out[4] = fourCc & 0xFF;
+    if (packetType != CODED_FRAMES || !isNaluCodec(fourCc)) return 5;
+    putSi24(out + 5, cts);
+    return 8;
+}
+
+size_t VideoTag::headerSize(bool enhanced, int packetType, uint32_t fourCc) {
+    return enhanced && packetType == CODED_FRAMES && isNaluCodec(fourCc) ? 8 : 5;
+}
+
+bool VideoTag::isConfig(const VideoTagInfo& info) {
+    return info.frameType == kFrameTypeCommand ||
+           (info.packetType != CODED_FRAMES && info.packetType != CODED_FRAMES_X);
+}
@@ -0,0 +1,60 @@
+#ifndef VIDEO_TAG_H
+#define VIDEO_TAG_H
+
+#include <cstdint>
+#include <cstddef>
+
+// FLV/RTMP 视频消息头部的解析结果。传统头部的 AVC/HEVC 包类型 0/1/2 与扩展头部的
+// SequenceStart/CodedFrames/SequenceEnd 取值相同，统一按扩展包类型给出
+struct VideoTagInfo {
+    bool enhanced; // 是否为 Enhanced RTMP 扩展头部（ExVideoTagHeader）
+    int frameType; // 帧类型：1 关键帧，2 帧间帧，3 可丢弃帧，5 视频信息/命令帧
+    int packetType; // 包类型，见 VideoTag::PacketType
+    uint32_t fourCc; // 编码：扩展头部的 FourCC，传统 AVC/HEVC 映射为 avc1/hvc1，其他传统编码为 0
+    int32_t cts; // CompositionTime（毫秒），没有时为 0
+    int trackId; // 多轨消息中的轨道 ID，单轨为 0
+    size_t headerSize; // 头部长度，其后是配置记录或帧数据
+    size_t bodySize; // 配置记录或帧数据的长度，多轨时只算第一条轨道
+};
+
+// FLV/RTMP 视频消息头部工具：识别传统头部（编码 ID 7/12）与 Enhanced RTMP 扩展头部
+// （首字节最高位 IsExHeader，低 4 位包类型，随后 FourCC），按扩展头部写出 HEVC/AV1
+class VideoTag {
+public:
+    // 扩展头部包类型
+    enum PacketType {
+        SEQUENCE_START = 0, // 解码配置记录（avcC/hvcC/av1C）
+        CODED_FRAMES = 1, // 帧数据，AVC/HEVC 带 CompositionTime
+        SEQUENCE_END = 2, // 序列结束
+        CODED_FRAMES_X = 3, // 帧数据，CompositionTime 为 0 时省去该字段
+        METADATA = 4, // AMF 编码的 HDR 等元数据
+        MPEG2TS_SEQUENCE_START = 5, // AV1 的 MPEG-2 TS 描述符形式配置
+        MULTITRACK = 6, // 多轨，真实包类型在下一个字节
+        MOD_EX = 7 // 修饰扩展，真实包类型在扩展数据之后
+    };
+
+    // 支持的 FourCC
+    enum FourCc {
+        FOURCC_AVC = 0x61766331, // 'avc1'
+        FOURCC_HEVC = 0x68766331, // 'hvc1'
+        FOURCC_AV1 = 0x61763031 // 'av01'
+    };
+
+    // 扩展头部的最大长度：首字节 + FourCC + CompositionTime
+    static const size_t kMaxHeaderSize = 8;
+
+    // 解析 data 开头的视频头部；数据不足或结构无效时返回 false。
+    // 多轨消息给出第一条轨道，之后的轨道不影响关键帧与序列头的判断
+    static bool parse(const uint8_t* data, size_t size, VideoTagInfo& info);
+    // 在 out 写入视频头部，返回长度（不超过 kMaxHeaderSize）。enhanced 为 false 时写传统头部，只适用于 AVC/HEVC；
+    // 扩展头部的 CODED_FRAMES 只有 AVC/HEVC 带 CompositionTime
+    static size_t writeHeader(uint8_t* out, bool enhanced, int frameType, int packetType, uint32_t fourCc, int32_t cts);
+    // writeHeader 将写出的长度
+    static size_t headerSize(bool enhanced, int packetType, uint32_t fourCc);
+    // 配置记录或帧数据是否为 AVC/HEVC 的长度前缀 NALU
+    static bool isNaluCodec(uint32_t fourCc) { return fourCc == FOURCC_AVC || fourCc == FOURCC_HEVC; }
+    // 解码配置类消息（序列头、序列结束、元数据、命令帧），不含图像
+    static bool isConfig(const VideoTagInfo& info);
+};
+
+#endif // VIDEO_TAG_H
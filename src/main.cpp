@@ -1,34 +1,195 @@
 #include "RtmpClient.h"
+#include "SessionManager.h"
 #include <iostream>
 #include <Vnsp_WriteLog.h>
 
-int main(int argc, char* argv[]) {
-    Vnsp_WriteLog* m_pWriteLog;
-    m_pWriteLog = Vnsp_WriteLog::GetInstance();
+// 推流配置
+struct PushConfig {
+    int threadCount; // 事件循环线程数，0 表示按 CPU 核数
+    std::vector<PushTask> tasks; // 推流任务列表
+};
 
+// 读取推流配置文件，没有配置文件时使用默认的单路推流
+static void LoadPushConfig(const std::string& path, PushConfig& config)
+{
     // SRS 服务器地址、端口、应用名和流名
     std::string server = "127.0.0.1"; // 替换为你的 SRS 服务器地址
     int port = 1935; // SRS 默认 RTMP 端口
     std::string app = "live";
-    std::string stream = "mystream";
-    VNSP_LOG(LOG_INFO, "main", "Starting RTMP push to %s:%d/%s/%s", server.c_str(), port, app.c_str(), stream.c_str());
-    // 创建 RTMP 客户端
-    RtmpClient client(server, port, app, stream);
+    bool pipelined = true;
+    bool fastOpen = false;
+    bool complexHandshake = true;
+    size_t maxChunkSize = 0;
+    RtmpClient::SocketProfile socketProfile;
+    int maxLatencyMs = 0;
+    bool enhancedRtmp = true;
+    config.threadCount = 0;
+    config.tasks.clear();
 
-    // 连接到服务器
-    if (!client.connect()) {
-        VNSP_LOG(LOG_ERROR, "main", "Failed to connect to RTMP server %s:%d", server.c_str(), port);
-        return 1;
+    CMarkup xml;
+    if (xml.Load(path))
+    {
+        if (xml.FindChildElem("Server"))
+        {
+            server = xml.GetChildData();
+        }
+        xml.ResetChildPos();
+        if (xml.FindChildElem("Port"))
+        {
+            port = atoi(xml.GetChildData().c_str());
+        }
+        xml.ResetChildPos();
+        if (xml.FindChildElem("App"))
+        {
+            app = xml.GetChildData();
+        }
+        xml.ResetChildPos();
+        if (xml.FindChildElem("ThreadCount"))
+        {
+            config.threadCount = atoi(xml.GetChildData().c_str());
+        }
+        xml.ResetChildPos();
+        if (xml.FindChildElem("Pipelined"))
+        {
+            pipelined = atoi(xml.GetChildData().c_str()) != 0;
+        }
+        xml.ResetChildPos();
+        if (xml.FindChildElem("FastOpen"))
+        {
+            fastOpen = atoi(xml.GetChildData().c_str()) != 0;
+        }
+        xml.ResetChildPos();
+        if (xml.FindChildElem("ComplexHandshake"))
+        {
+            complexHandshake = atoi(xml.GetChildData().c_str()) != 0;
+        }
+        xml.ResetChildPos();
+        if (xml.FindChildElem("MaxChunkSize"))
+        {
+            maxChunkSize = strtoul(xml.GetChildData().c_str(), nullptr, 10);
+        }
+        xml.ResetChildPos();
+        if (xml.FindChildElem("Socket"))
+        {
+            // 未写的属性保持默认值
+            std::string value = xml.GetChildAttrib("NoDelay");
+            if (!value.empty()) socketProfile.noDelay = atoi(value.c_str()) != 0;
+            value = xml.GetChildAttrib("SendBufferMs");
+            if (!value.empty()) socketProfile.sendBufferMs = atoi(value.c_str());
+            value = xml.GetChildAttrib("NotSentLowatMs");
+            if (!value.empty()) socketProfile.notSentLowatMs = atoi(value.c_str());
+            value = xml.GetChildAttrib("PacingPercent");
+            if (!value.empty()) socketProfile.pacingPercent = atoi(value.c_str());
+        }
+        xml.ResetChildPos();
+        if (xml.FindChildElem("MaxLatencyMs"))
+        {
+            maxLatencyMs = atoi(xml.GetChildData().c_str());
+        }
+        xml.ResetChildPos();
+        if (xml.FindChildElem("EnhancedRtmp"))
+        {
+            enhancedRtmp = atoi(xml.GetChildData().c_str()) != 0;
+        }
+        // 每个 Stream 节点是一组推流，Count 大于 1 时流名追加 _序号
+        xml.ResetChildPos();
+        while (xml.FindChildElem("Stream"))
+        {
+            int count = atoi(xml.GetChildAttrib("Count").c_str());
+            if (count < 1)
+            {
+                count = 1;
+            }
+            bool loop = atoi(xml.GetChildAttrib("Loop").c_str()) != 0;
+            xml.IntoElem();
+            std::string name = xml.FindChildElem("Name") ? xml.GetChildData() : "";
+            // 多个 File 组成播放列表，按顺序在同一个会话上推送
+            std::vector<std::string> files;
+            xml.ResetChildPos();
+            while (xml.FindChildElem("File"))
+            {
+                std::string file = xml.GetChildData();
+                if (!file.empty())
+                {
+                    files.push_back(file);
+                }
+            }
+            xml.OutOfElem();
+            if (name.empty() || files.empty())
+            {
+                VNSP_LOG(LOG_WARN, "main", "Skip Stream without Name or File in %s", path.c_str());
+                continue;
+            }
+            for (int i = 0; i < count; ++i)
+            {
+                PushTask task;
+                task.server = server;
+                task.port = port;
+                task.app = app;
+                task.stream = count > 1 ? name + "_" + std::to_string(i) : name;
+                task.filePath = files[0];
+                task.playlist = files;
+                task.loop = loop;
+                task.pipelined = pipelined;
+                task.fastOpen = fastOpen;
+                task.complexHandshake = complexHandshake;
+                task.maxChunkSize = maxChunkSize;
+                task.socketProfile = socketProfile;
+                task.maxLatencyMs = maxLatencyMs;
+                task.enhancedRtmp = enhancedRtmp;
+                config.tasks.push_back(task);
+            }
+        }
     }
+    if (config.tasks.empty())
+    {
+        PushTask task;
+        task.server = server;
+        task.port = port;
+        task.app = app;
+        task.stream = "mystream";
+        task.filePath = "demo.flv";
+        task.pipelined = pipelined;
+        task.fastOpen = fastOpen;
+        task.complexHandshake = complexHandshake;
+        task.maxChunkSize = maxChunkSize;
+        task.socketProfile = socketProfile;
+        task.maxLatencyMs = maxLatencyMs;
+        task.enhancedRtmp = enhancedRtmp;
+        config.tasks.push_back(task);
+    }
+}
 
-    // 推送 FLV 文件
-    if (!client.pushFlvFile("demo.flv")) {
-        VNSP_LOG(LOG_ERROR, "main", "Failed to push FLV file demo.flv");
+int main(int argc, char* argv[]) {
+    Vnsp_WriteLog* m_pWriteLog;
+    m_pWriteLog = Vnsp_WriteLog::GetInstance();
+
+    PushConfig config;
+    LoadPushConfig("./pushConfig.xml", config);
+    VNSP_LOG(LOG_INFO, "main", "Starting %zu RTMP pushes to %s:%d/%s", config.tasks.size(),
+             config.tasks[0].server.c_str(), config.tasks[0].port, config.tasks[0].app.c_str());
+
+    // 所有推流会话共享固定数量的事件循环线程
+    SessionManager manager(config.threadCount);
+    if (!manager.start()) {
+        VNSP_LOG(LOG_ERROR, "main", "Failed to start session manager");
         return 1;
     }
+    for (size_t i = 0; i < config.tasks.size(); ++i) {
+        manager.addSession(config.tasks[i]);
+    }
 
-    // 关闭连接
-    client.close();
+    // 等待全部推流结束
+    manager.waitAll();
+    int failed = manager.failedSessions();
+    manager.stop();
+    const RtmpClient::PushStats& stats = manager.totalStats();
+    VNSP_LOG(LOG_INFO, "main", "Pushed %" PRIu64 " tags, %" PRIu64 " bytes, dropped %" PRIu64 " video frames", stats.tags,
+             stats.payloadBytes, stats.droppedFrames);
+    if (failed > 0) {
+        VNSP_LOG(LOG_ERROR, "main", "%d of %zu pushes failed", failed, config.tasks.size());
+        return 1;
+    }
     VNSP_LOG(LOG_INFO, "main", "Push completed successfully");
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,105 @@
+#include "Amf0Reader.h"
+#include "Amf0Writer.h"
+#include "TestUtil.h"
+
+namespace {
+bool keyIs(const Amf0Document& doc, uint32_t index, const char* key) {
+    return index != Amf0Document::npos && doc.node(index).item.key.equals(key);
+}
+
+// 服务器对 connect 的 _result：命令名、事务号、属性对象、信息对象（内嵌 ECMA Array）
+void testConnectResult() {
+    uint8_t buffer[512];
+    Amf0Writer writer(buffer, sizeof(buffer));
+    writer.string("_result").number(1);
+    writer.beginObject().property("fmsVer", "FMS/3,5,7,7009").property("capabilities", 31.0).endObject();
+    writer.beginObject()
+        .property("level", "status")
+        .property("code", "NetConnection.Connect.Success")
+        .property("description", "Connection succeeded.")
+        .property("objectEncoding", 0.0);
+    writer.key("data").beginEcmaArray(1).property("version", "3,5,7,7009").endEcmaArray();
+    writer.endObject();
+    CHECK(writer.ok());
+
+    Amf0Document doc;
+    CHECK(doc.parse(writer.data(), writer.size()));
+    uint32_t name = doc.root(0);
+    uint32_t transaction = doc.root(1);
+    uint32_t props = doc.root(2);
+    uint32_t info = doc.root(3);
+    CHECK(name != Amf0Document::npos && doc.node(name).item.string.equals("_result"));
+    CHECK(transaction != Amf0Document::npos && doc.node(transaction).item.number == 1);
+    CHECK(props != Amf0Document::npos && doc.node(props).item.type == Amf0Item::OBJECT);
+    CHECK(info != Amf0Document::npos && doc.node(info).item.type == Amf0Item::OBJECT);
+    CHECK(doc.root(4) == Amf0Document::npos);
+    if (info == Amf0Document::npos) return;
+
+    uint32_t code = doc.find(info, "code");
+    CHECK(code != Amf0Document::npos && doc.node(code).item.string.equals("NetConnection.Connect.Success"));
+    // 顶层值的属性不应在别的容器里被找到
+    CHECK(doc.find(info, "fmsVer") == Amf0Document::npos);
+    CHECK(doc.find(props, "code") == Amf0Document::npos);
+
+    // 按顺序遍历信息对象的成员，跳过 data 的子树
+    uint32_t child = doc.firstChild(info);
+    CHECK(keyIs(doc, child, "level"));
+    child = doc.nextSibling(info, child);
+    CHECK(keyIs(doc, child, "code"));
+    child = doc.nextSibling(info, child);
+    CHECK(keyIs(doc, child, "description"));
+    child = doc.nextSibling(info, child);
+    CHECK(keyIs(doc, child, "objectEncoding"));
+    child = doc.nextSibling(info, child);
+    CHECK(keyIs(doc, child, "data"));
+    uint32_t data = child;
+    CHECK(doc.nextSibling(info, child) == Amf0Document::npos);
+    if (data == Amf0Document::npos) return;
+
+    CHECK(doc.node(data).item.type == Amf0Item::ECMA_ARRAY);
+    uint32_t version = doc.find(data, "version");
+    CHECK(version != Amf0Document::npos && doc.node(version).item.string.equals("3,5,7,7009"));
+    CHECK(doc.nextSibling(data, version) == Amf0Document::npos);
+}
+
+// publish 的 onStatus：命令名、事务号 0、null、信息对象；同一文档对象复用
+void testPublishOnStatus() {
+    uint8_t buffer[256];
+    Amf0Writer writer(buffer, sizeof(buffer));
+    writer.string("onStatus").number(0).null();
+    writer.beginObject()
+        .property("level", "status")
+        .property("code", "NetStream.Publish.Start")
+        .property("description", "live/mystream is now published.")
+        .endObject();
+    CHECK(writer.ok());
+
+    Amf0Document doc;
+    uint8_t other[64];
+    Amf0Writer first(other, sizeof(other));
+    first.string("_result").number(4).null().number(1);
+    CHECK(doc.parse(first.data(), first.size()));
+    CHECK_EQ(doc.size(), 4);
+
+    CHECK(doc.parse(writer.data(), writer.size()));
+    CHECK(doc.node(doc.root(0)).item.string.equals("onStatus"));
+    CHECK(doc.node(doc.root(2)).item.type == Amf0Item::NULL_TYPE);
+    uint32_t info = doc.root(3);
+    CHECK(info != Amf0Document::npos);
+    if (info == Amf0Document::npos) return;
+    uint32_t code = doc.find(info, "code");
+    CHECK(code != Amf0Document::npos && doc.node(code).item.string.equals("NetStream.Publish.Start"));
+    uint32_t level = doc.firstChild(info);
+    CHECK(keyIs(doc, level, "level") && doc.node(level).item.string.equals("status"));
+    CHECK(doc.find(info, "missing") == Amf0Document::npos);
+
+    // 缺少 Object End 的截断消息解析失败
+    CHECK(!doc.parse(writer.data(), writer.size() - 3));
+}
+}
+
+int main() {
+    testConnectResult();
+    testPublishOnStatus();
+    return g_testFailures == 0 ? 0 : 1;
+}
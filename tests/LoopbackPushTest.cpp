@@ -0,0 +1,292 @@
+// 回环推流测试：进程内运行 RtmpSink，用 SessionManager 推送合成 FLV，
+// 核对握手、建流命令（流水线与串行）、小 Chunk 下的消息重组、实时输入的脚本 Tag 以及中途断开后的续推
+#include "SessionManager.h"
+#include "RtmpSink.h"
+#include "SyntheticFlv.h"
+#include "FlvReader.h"
+#include "TestUtil.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+// 文件中的音视频 Tag 数与数据字节数
+struct MediaTotals {
+    uint64_t messages;
+    uint64_t bytes;
+    MediaTotals() : messages(0), bytes(0) {}
+};
+
+MediaTotals countMedia(const std::string& path) {
+    MediaTotals totals;
+    FlvReader reader;
+    FlvTag tag;
+    if (!reader.open(path)) return totals;
+    while (reader.readTag(tag)) {
+        if (tag.type == 8 || tag.type == 9) {
+            ++totals.messages;
+            totals.bytes += tag.size;
+        }
+    }
+    return totals;
+}
+
+// 在独立线程中运行的回环接收端
+class LoopbackSink {
+public:
+    LoopbackSink() : sink_(&loop_), port_(0), started_(false) {}
+
+    bool start() {
+        int listenFd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t addrLen = sizeof(addr);
+        if (listenFd < 0 || bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+            listen(listenFd, 64) < 0 || getsockname(listenFd, reinterpret_cast<sockaddr*>(&addr), &addrLen) < 0 ||
+            !sink_.start(listenFd)) {
+            if (listenFd >= 0) ::close(listenFd);
+            return false;
+        }
+        port_ = ntohs(addr.sin_port);
+        started_ = pthread_create(&threadId_, NULL, OnSinkThread, this) == 0;
+        return started_;
+    }
+
+    // 停止接收端线程，之后可读取统计
+    void stop() {
+        if (!started_) return;
+        loop_.stop();
+        pthread_join(threadId_, NULL);
+        started_ = false;
+    }
+
+    int port() const { return port_; }
+    const SinkStats& stats() const { return sink_.stats(); }
+    // start() 之前调用：收到 messages 条音视频消息后断开一次
+    void setDropAfterMessages(uint64_t messages) { sink_.setDropAfterMessages(messages); }
+    // start() 之前调用：模拟慢速接收端
+    void setThrottle(size_t bytesPerRead, int pauseMs) { sink_.setThrottle(bytesPerRead, pauseMs); }
+
+private:
+    static void* OnSinkThread(void* pParam) {
+        static_cast<LoopbackSink*>(pParam)->loop_.run();
+        return NULL;
+    }
+
+    EventLoop loop_; // 接收端的事件循环
+    RtmpSink sink_; // 接收端
+    int port_; // 监听端口
+    bool started_; // 线程是否已启动
+    pthread_t threadId_; // 接收端线程
+};
+
+void appendTag(std::vector<uint8_t>& out, uint8_t type, uint32_t timestamp, const uint8_t* data, size_t size) {
+    uint8_t header[11] = {type, static_cast<uint8_t>(size >> 16), static_cast<uint8_t>(size >> 8),
+                          static_cast<uint8_t>(size), static_cast<uint8_t>(timestamp >> 16),
+                          static_cast<uint8_t>(timestamp >> 8), static_cast<uint8_t>(timestamp),
+                          static_cast<uint8_t>(timestamp >> 24), 0, 0, 0};
+    uint32_t tagSize = static_cast<uint32_t>(11 + size);
+    uint8_t prev[4] = {static_cast<uint8_t>(tagSize >> 24), static_cast<uint8_t>(tagSize >> 16),
+                       static_cast<uint8_t>(tagSize >> 8), static_cast<uint8_t>(tagSize)};
+    out.insert(out.end(), header, header + sizeof(header));
+    out.insert(out.end(), data, data + size);
+    out.insert(out.end(), prev, prev + sizeof(prev));
+}
+
+// 期望接收端收到的 onCuePoint 消息
+struct CuePoints {
+    uint64_t count;
+    uint64_t checksum;
+    CuePoints() : count(0), checksum(SinkStats::kChecksumBasis) {}
+};
+
+// 在 FLV 中每隔若干 Tag 插入一个 onCuePoint 脚本 Tag，负载内容各不相同，便于发现被覆盖的数据
+std::vector<uint8_t> withCuePoints(const std::string& path, CuePoints& cues) {
+    std::vector<uint8_t> out;
+    FlvReader reader;
+    FlvTag tag;
+    if (!reader.open(path)) return out;
+    static const uint8_t kFlvHeader[13] = {'F', 'L', 'V', 0x01, 0x05, 0, 0, 0, 0x09, 0, 0, 0, 0};
+    out.assign(kFlvHeader, kFlvHeader + sizeof(kFlvHeader));
+    for (int i = 0; reader.readTag(tag); ++i) {
+        appendTag(out, tag.type, tag.timestamp, tag.data, tag.size);
+        if (i % 10 != 5) continue;
+        std::vector<uint8_t> cue;
+        const char name[] = "onCuePoint";
+        cue.push_back(0x02);
+        cue.push_back(0);
+        cue.push_back(sizeof(name) - 1);
+        cue.insert(cue.end(), name, name + sizeof(name) - 1);
+        size_t textSize = 3000;
+        cue.push_back(0x02);
+        cue.push_back(static_cast<uint8_t>(textSize >> 8));
+        cue.push_back(static_cast<uint8_t>(textSize));
+        for (size_t j = 0; j < textSize; ++j) cue.push_back(static_cast<uint8_t>('a' + (i + j) % 26));
+        appendTag(out, 0x12, tag.timestamp, cue.data(), cue.size());
+        ++cues.count;
+        cues.checksum = SinkStats::checksum(cues.checksum, cue.data(), cue.size());
+    }
+    return out;
+}
+
+// 向 FIFO 写入实时 FLV 的线程
+struct FifoWriter {
+    std::string path;
+    std::vector<uint8_t> data;
+    static void* OnWriterThread(void* pParam) {
+        FifoWriter* writer = static_cast<FifoWriter*>(pParam);
+        FILE* fp = fopen(writer->path.c_str(), "wb");
+        if (fp == NULL) return NULL;
+        fwrite(writer->data.data(), 1, writer->data.size(), fp);
+        fclose(fp);
+        return NULL;
+    }
+};
+
+// 推送 streams 路，全部成功且接收端收齐每一条音视频消息
+void testPush(const std::string& filePath, const MediaTotals& totals, int streams, const PushTask& base) {
+    LoopbackSink sink;
+    CHECK(sink.start());
+    SessionManager manager(2);
+    CHECK(manager.start());
+    for (int i = 0; i < streams; ++i) {
+        PushTask task = base;
+        task.server = "127.0.0.1";
+        task.port = sink.port();
+        task.app = "live";
+        task.stream = "test_" + std::to_string(i);
+        task.filePath = filePath;
+        manager.addSession(task);
+    }
+    manager.waitAll();
+    CHECK_EQ(manager.failedSessions(), 0);
+    manager.stop();
+    sink.stop();
+
+    const SinkStats& stats = sink.stats();
+    CHECK_EQ(stats.connections, streams);
+    CHECK_EQ(stats.publishes, streams);
+    CHECK_EQ(stats.mediaMessages, totals.messages * streams);
+    CHECK_EQ(stats.mediaBytes, totals.bytes * streams);
+    CHECK_EQ(manager.totalStats().tags, totals.messages * streams);
+}
+
+// 实时输入经慢速接收端推送：发送队列积压期间读缓冲被后续 Tag 挪动，
+// onCuePoint 等脚本 Tag 必须以副本入队，接收端收到的内容与输入一致
+void testLiveScriptTags(const std::string& filePath, const MediaTotals& totals) {
+    std::string fifoPath = "/tmp/xrtc_loopbacktest_live_" + std::to_string(getpid()) + ".fifo";
+    unlink(fifoPath.c_str());
+    CHECK(mkfifo(fifoPath.c_str(), 0600) == 0);
+    CuePoints cues;
+    FifoWriter writer;
+    writer.path = fifoPath;
+    writer.data = withCuePoints(filePath, cues);
+    CHECK(cues.count > 0);
+
+    LoopbackSink sink;
+    sink.setThrottle(16384, 1);
+    CHECK(sink.start());
+    SessionManager manager(1);
+    CHECK(manager.start());
+    pthread_t writerThread;
+    CHECK(pthread_create(&writerThread, NULL, FifoWriter::OnWriterThread, &writer) == 0);
+    PushTask task;
+    task.server = "127.0.0.1";
+    task.port = sink.port();
+    task.app = "live";
+    task.stream = "live_cue";
+    task.filePath = fifoPath;
+    manager.addSession(task);
+    manager.waitAll();
+    pthread_join(writerThread, NULL);
+    CHECK_EQ(manager.failedSessions(), 0);
+    manager.stop();
+    sink.stop();
+    unlink(fifoPath.c_str());
+
+    const SinkStats& stats = sink.stats();
+    CHECK_EQ(stats.publishes, 1);
+    CHECK_EQ(stats.mediaMessages, totals.messages);
+    CHECK_EQ(stats.mediaBytes, totals.bytes);
+    CHECK_EQ(stats.dataMessages, cues.count);
+    CHECK(stats.dataChecksum == cues.checksum);
+}
+
+// 推流中途断开：重连后从最近的关键帧继续，节奏基准随之重建，回退的 GOP 按流速率发送，
+// 不会整段判为迟到而被丢帧预算丢弃
+void testResumeMidStream(const std::string& filePath) {
+    MediaTotals totals = countMedia(filePath);
+    LoopbackSink sink;
+    // 约 1.5 秒处断开，最近的关键帧在 0 秒
+    sink.setDropAfterMessages(totals.messages / 2);
+    CHECK(sink.start());
+    SessionManager manager(1);
+    CHECK(manager.start());
+    PushTask task;
+    task.server = "127.0.0.1";
+    task.port = sink.port();
+    task.app = "live";
+    task.stream = "resume";
+    task.filePath = filePath;
+    task.maxLatencyMs = 500;
+    manager.addSession(task);
+    manager.waitAll();
+    CHECK_EQ(manager.failedSessions(), 0);
+    manager.stop();
+    sink.stop();
+
+    const SinkStats& stats = sink.stats();
+    CHECK_EQ(stats.connections, 2);
+    CHECK_EQ(stats.publishes, 2);
+    // 回退重发的部分使接收端收到的消息多于文件中的
+    CHECK(stats.mediaMessages > totals.messages);
+    const RtmpClient::PushStats& pushStats = manager.totalStats();
+    CHECK_EQ(pushStats.droppedFrames, 0);
+    CHECK(pushStats.lateMaxUs < 200000);
+}
+}
+
+int main() {
+    std::string filePath = "/tmp/xrtc_loopbacktest_" + std::to_string(getpid()) + ".flv";
+    if (!writeSyntheticFlv(filePath, 1, 2000)) {
+        fprintf(stderr, "failed to write %s\n", filePath.c_str());
+        return 1;
+    }
+    Vnsp_WriteLog::GetInstance();
+    MediaTotals totals = countMedia(filePath);
+    CHECK(totals.messages > 0);
+
+    // 复杂握手 + 流水线建流，多路共用事件循环
+    PushTask pipelined;
+    testPush(filePath, totals, 4, pipelined);
+
+    // 简单握手 + 串行建流，Chunk 保持 128 字节，每个视频帧被拆成大量 Chunk 由接收端重组
+    PushTask serial;
+    serial.pipelined = false;
+    serial.complexHandshake = false;
+    serial.maxChunkSize = 128;
+    testPush(filePath, totals, 2, serial);
+
+    testLiveScriptTags(filePath, totals);
+
+    unlink(filePath.c_str());
+
+    // 3 秒文件，关键帧在 0 与 2 秒
+    std::string resumePath = "/tmp/xrtc_loopbacktest_resume_" + std::to_string(getpid()) + ".flv";
+    if (!writeSyntheticFlv(resumePath, 3, 2000)) {
+        fprintf(stderr, "failed to write %s\n", resumePath.c_str());
+        return 1;
+    }
+    testResumeMidStream(resumePath);
+    unlink(resumePath.c_str());
+    return g_testFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,104 @@
+#include "Sha256.h"
+#include "TestUtil.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace {
+std::string toHex(const uint8_t* data, size_t size) {
+    static const char kDigits[] = "0123456789abcdef";
+    std::string hex;
+    for (size_t i = 0; i < size; ++i) {
+        hex += kDigits[data[i] >> 4];
+        hex += kDigits[data[i] & 0x0F];
+    }
+    return hex;
+}
+
+std::string sha256Hex(const std::string& message) {
+    uint8_t digest[Sha256::kDigestSize];
+    Sha256::hash(reinterpret_cast<const uint8_t*>(message.data()), message.size(), digest);
+    return toHex(digest, sizeof(digest));
+}
+
+std::string hmacHex(const std::vector<uint8_t>& key, const std::string& message) {
+    HmacSha256 hmac(key.data(), key.size());
+    uint8_t mac[Sha256::kDigestSize];
+    hmac.compute(reinterpret_cast<const uint8_t*>(message.data()), message.size(), mac);
+    return toHex(mac, sizeof(mac));
+}
+
+// FIPS 180-2 附录 B 的示例，含跨两个分组的消息与一百万个 'a'
+void testSha256Vectors() {
+    CHECK(sha256Hex("") == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    CHECK(sha256Hex("abc") == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    CHECK(sha256Hex("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq") ==
+          "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+
+    // 按不对齐分组的长度分段输入，覆盖 update 的缓冲拼接
+    std::string million(1000000, 'a');
+    Sha256 sha;
+    for (size_t pos = 0; pos < million.size(); pos += 997) {
+        size_t size = std::min<size_t>(997, million.size() - pos);
+        sha.update(reinterpret_cast<const uint8_t*>(million.data()) + pos, size);
+    }
+    uint8_t digest[Sha256::kDigestSize];
+    sha.final(digest);
+    CHECK(toHex(digest, sizeof(digest)) == "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+}
+
+// RFC 4231 的 HMAC-SHA256 测试用例 1-4、6、7，含超过分组长度的密钥与消息
+void testHmacVectors() {
+    CHECK(hmacHex(std::vector<uint8_t>(20, 0x0b), "Hi There") ==
+          "b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7");
+    const char* jefe = "Jefe";
+    CHECK(hmacHex(std::vector<uint8_t>(jefe, jefe + 4), "what do ya want for nothing?") ==
+          "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843");
+    CHECK(hmacHex(std::vector<uint8_t>(20, 0xaa), std::string(50, '\xdd')) ==
+          "773ea91e36800e46854db8ebd09181a72959098b3ef8c122d9635514ced565fe");
+    std::vector<uint8_t> key4;
+    for (uint8_t i = 1; i <= 25; ++i) key4.push_back(i);
+    CHECK(hmacHex(key4, std::string(50, '\xcd')) ==
+          "82558a389a443c0ea4cc819899f2083a85f0faa3e578f8077a2e3ff46729665b");
+    std::vector<uint8_t> longKey(131, 0xaa);
+    CHECK(hmacHex(longKey, "Test Using Larger Than Block-Size Key - Hash Key First") ==
+          "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54");
+    CHECK(hmacHex(longKey, "This is a test using a larger than block-size key and a larger than block-size data. "
+                           "The key needs to be hashed before being used by the HMAC algorithm.") ==
+          "9b09ffa71b942fcb27635fbcd5b0e944bfdc63644f0713938a7f51535c3a35e2");
+}
+
+// 两段拼接的 compute 与整段输入结果一致，分割点落在分组内外都要成立
+void testHmacTwoPart() {
+    std::string message = "This is a test using a larger than block-size key and a larger than block-size data. "
+                          "The key needs to be hashed before being used by the HMAC algorithm.";
+    std::vector<uint8_t> longKey(131, 0xaa);
+    HmacSha256 hmac(longKey.data(), longKey.size());
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(message.data());
+    size_t splits[] = {0, 1, 63, 64, 65, 100, message.size()};
+    for (size_t i = 0; i < sizeof(splits) / sizeof(splits[0]); ++i) {
+        uint8_t mac[Sha256::kDigestSize];
+        hmac.compute(data, splits[i], data + splits[i], message.size() - splits[i], mac);
+        CHECK(toHex(mac, sizeof(mac)) == "9b09ffa71b942fcb27635fbcd5b0e944bfdc63644f0713938a7f51535c3a35e2");
+    }
+}
+
+void runAll() {
+    testSha256Vectors();
+    testHmacVectors();
+    testHmacTwoPart();
+}
+}
+
+int main() {
+    // 先跑进程选定的实现（有 SHA-NI 时即硬件路径），再强制可移植实现重跑
+    if (Sha256::hardwareAccelerated()) {
+        fprintf(stderr, "Sha256Test: checking SHA-NI path\n");
+        runAll();
+    }
+    Sha256::forcePortable(true);
+    CHECK(!Sha256::hardwareAccelerated());
+    runAll();
+    Sha256::forcePortable(false);
+    return g_testFailures == 0 ? 0 : 1;
+}
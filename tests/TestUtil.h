@@ -0,0 +1,28 @@
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+#include <cstdio>
+
+// 最小的测试断言：失败时打印位置并计数，main 以失败数作为退出码
+static int g_testFailures = 0;
+
+#define CHECK(cond)                                                                    \
+    do {                                                                               \
+        if (!(cond)) {                                                                 \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond);   \
+            ++g_testFailures;                                                          \
+        }                                                                              \
+    } while (0)
+
+#define CHECK_EQ(a, b)                                                                 \
+    do {                                                                               \
+        long long checkA = static_cast<long long>(a);                                  \
+        long long checkB = static_cast<long long>(b);                                  \
+        if (checkA != checkB) {                                                        \
+            fprintf(stderr, "%s:%d: CHECK_EQ failed: %s (%lld) != %s (%lld)\n",        \
+                    __FILE__, __LINE__, #a, checkA, #b, checkB);                       \
+            ++g_testFailures;                                                          \
+        }                                                                              \
+    } while (0)
+
+#endif // TEST_UTIL_H
@@ -0,0 +1,54 @@
+#include "TimerWheel.h"
+#include "TestUtil.h"
+
+namespace {
+const int64_t kTickUs = 100;
+
+// 上层定时器的下放时刻早于第 0 层最近的定时器时，nextDeadline 应给出下放时刻
+void testCascadeBeforeLevelZero() {
+    TimerWheel wheel(kTickUs, 0);
+    int fired = 0;
+    // tick 70 超出第 0 层范围，放在第 1 层，tick 64 下放
+    wheel.add(70 * kTickUs, [&fired] { fired = 70; });
+    wheel.advance(60 * kTickUs);
+    // tick 120 距当前不足 64 个 tick，放在第 0 层
+    wheel.add(120 * kTickUs, [&fired] { fired = 120; });
+    CHECK_EQ(wheel.nextDeadline(), 64 * kTickUs);
+
+    wheel.advance(64 * kTickUs);
+    CHECK_EQ(fired, 0);
+    CHECK_EQ(wheel.nextDeadline(), 70 * kTickUs);
+    wheel.advance(70 * kTickUs);
+    CHECK_EQ(fired, 70);
+    CHECK_EQ(wheel.nextDeadline(), 120 * kTickUs);
+    wheel.advance(120 * kTickUs);
+    CHECK_EQ(fired, 120);
+    CHECK_EQ(wheel.nextDeadline(), -1);
+}
+
+// 只有第 0 层定时器时按 tick 精确给出，取消后不再计入
+void testLevelZeroAndCancel() {
+    TimerWheel wheel(kTickUs, 0);
+    uint64_t early = wheel.add(5 * kTickUs, [] {});
+    wheel.add(30 * kTickUs, [] {});
+    CHECK_EQ(wheel.nextDeadline(), 5 * kTickUs);
+    wheel.cancel(early);
+    CHECK_EQ(wheel.nextDeadline(), 30 * kTickUs);
+    CHECK_EQ(wheel.size(), 1);
+}
+
+// 多个上层定时器取最早的下放时刻
+void testUpperLevels() {
+    TimerWheel wheel(kTickUs, 0);
+    wheel.add(5000 * kTickUs, [] {});
+    wheel.add(200 * kTickUs, [] {});
+    CHECK_EQ(wheel.nextDeadline(), 192 * kTickUs);
+}
+}
+
+int main() {
+    testCascadeBeforeLevelZero();
+    testLevelZeroAndCancel();
+    testUpperLevels();
+    return g_testFailures == 0 ? 0 : 1;
+}